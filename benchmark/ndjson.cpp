@@ -0,0 +1,150 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures how parse_ndjson() scales with the number of threads.
+// Usage: benchmark_ndjson [record count] [max thread count]
+
+#include "minijson_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+
+std::string generate_records(const std::size_t count)
+{
+    std::string result;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        result +=
+            "{\"id\":" + std::to_string(i) + ","
+            "\"name\":\"record \\u00e9 " + std::to_string(i * 7919) + "\","
+            "\"price\":" + std::to_string(i % 1000) + ".25,"
+            "\"tags\":[\"a\",\"b\",{\"nested\":[1,2,3]}],"
+            "\"active\":" + ((i % 2 == 0) ? "true" : "false") + "}\n";
+    }
+
+    return result;
+}
+
+double parse_record(minijson::const_buffer_context& context)
+{
+    double price = 0;
+    minijson::parse_object(
+        context,
+        [&](const std::string_view name, const minijson::value v)
+        {
+            if (name == "price")
+            {
+                v.to(price);
+            }
+            else
+            {
+                minijson::ignore(context);
+            }
+        });
+
+    return price;
+}
+
+template<typename Function>
+double measure(const Function& function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t record_count =
+        (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::size_t max_threads =
+        (argc > 2) ?
+            std::strtoull(argv[2], nullptr, 10) :
+            std::max(std::thread::hardware_concurrency(), 1U);
+
+    const std::string input = generate_records(record_count);
+    const double megabytes = input.size() / (1024.0 * 1024.0);
+
+    std::cout << std::fixed << std::setprecision(1)
+        << record_count << " records, " << megabytes << " MiB\n";
+
+    double sum = 0;
+    const double sequential = measure(
+        [&]
+        {
+            minijson::parse_ndjson(
+                input.data(),
+                input.size(),
+                [&](minijson::const_buffer_context& context)
+                {
+                    sum += parse_record(context);
+                });
+        });
+    std::cout << "sequential: " << megabytes / sequential << " MiB/s\n";
+
+    for (std::size_t threads = 1;; threads = std::min(threads * 2, max_threads))
+    {
+        minijson::thread_pool pool(threads);
+
+        const double parallel = measure(
+            [&]
+            {
+                minijson::parse_ndjson(
+                    pool,
+                    input.data(),
+                    input.size(),
+                    parse_record,
+                    [&](const double price) { sum += price; });
+            });
+
+        std::cout << std::setw(3) << threads << " threads: "
+            << megabytes / parallel << " MiB/s, speedup "
+            << std::setprecision(2) << sequential / parallel
+            << std::setprecision(1) << "x\n";
+
+        if (threads >= max_threads)
+        {
+            break;
+        }
+    }
+
+    // Prevents the parsing from being optimized away
+    return (sum == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
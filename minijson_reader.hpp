@@ -26,28 +26,55 @@
 #ifndef MINIJSON_READER_H
 #define MINIJSON_READER_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <cerrno>
 #include <charconv>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <forward_list>
 #include <functional>
 #include <istream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <stdexcept>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MJR_HAS_MMAP
+#endif
+
 #ifndef MJR_NESTING_LIMIT
 #define MJR_NESTING_LIMIT 32
 #endif
 
-#define MJR_STRINGIFY(S) MJR_STRINGIFY_HELPER(S)
-#define MJR_STRINGIFY_HELPER(S) #S
+#ifndef MJR_STRING_CHUNK_SIZE
+#define MJR_STRING_CHUNK_SIZE 4096
+#endif
+
+#ifndef MJR_VALIDATE_UTF8
+#define MJR_VALIDATE_UTF8 false
+#endif
 
 namespace minijson
 {
@@ -100,12 +127,57 @@ public:
         return m_nesting_level;
     }
 
+    std::size_t nesting_limit() const noexcept
+    {
+        return m_nesting_limit;
+    }
+
+    void set_nesting_limit(const std::size_t nesting_limit) noexcept
+    {
+        m_nesting_limit = nesting_limit;
+    }
+
+    // Whether the characters of strings (and field names) that are not part
+    // of escape sequences are checked to be well-formed UTF-8
+    bool validate_utf8() const noexcept
+    {
+        return m_validate_utf8;
+    }
+
+    void set_validate_utf8(const bool validate_utf8) noexcept
+    {
+        m_validate_utf8 = validate_utf8;
+    }
+
 protected:
-    explicit context_base() noexcept = default;
+    explicit context_base(const std::size_t nesting_level = 0) noexcept
+    : m_nesting_level(nesting_level)
+    {
+    }
+
+    // Used by context adapters to take over the nesting state (and the
+    // settings) of the context they wrap
+    void copy_nesting(const context_base& other) noexcept
+    {
+        m_nested_status = other.m_nested_status;
+        m_nesting_level = other.m_nesting_level;
+        m_nesting_limit = other.m_nesting_limit;
+        m_validate_utf8 = other.m_validate_utf8;
+    }
+
+    // Used when a context is reused to parse another message: the nesting
+    // limit and the other settings are preserved
+    void reset_nesting() noexcept
+    {
+        m_nested_status = NESTED_STATUS_NONE;
+        m_nesting_level = 0;
+    }
 
 private:
     context_nested_status m_nested_status = NESTED_STATUS_NONE;
     std::size_t m_nesting_level = 0;
+    std::size_t m_nesting_limit = MJR_NESTING_LIMIT;
+    bool m_validate_utf8 = MJR_VALIDATE_UTF8;
 }; // class context_base
 
 // Base for context classes backed by a buffer
@@ -158,6 +230,22 @@ public:
         return m_read_offset;
     }
 
+    const char* read_buffer() const noexcept
+    {
+        return m_read_buffer;
+    }
+
+    std::size_t read_buffer_length() const noexcept
+    {
+        return m_length;
+    }
+
+    // Consumes characters that were examined directly in the read buffer
+    void advance(const std::size_t count) noexcept
+    {
+        m_read_offset = std::min(m_length, m_read_offset + count);
+    }
+
     void begin_literal() noexcept
     {
         m_current_literal = m_write_buffer + m_write_offset;
@@ -215,8 +303,10 @@ protected:
     explicit buffer_context_base(
         const char* const read_buffer,
         char* const write_buffer,
-        const std::size_t length) noexcept
-    : m_read_buffer(read_buffer)
+        const std::size_t length,
+        const std::size_t nesting_level = 0) noexcept
+    : context_base(nesting_level)
+    , m_read_buffer(read_buffer)
     , m_write_buffer(write_buffer)
     , m_length(length)
     {
@@ -227,6 +317,20 @@ protected:
         return m_write_buffer;
     }
 
+    void reset(
+        const char* const read_buffer,
+        char* const write_buffer,
+        const std::size_t length) noexcept
+    {
+        reset_nesting();
+        m_read_buffer = read_buffer;
+        m_write_buffer = write_buffer;
+        m_length = length;
+        m_read_offset = 0;
+        m_write_offset = 0;
+        m_current_literal = m_write_buffer;
+    }
+
 private:
     const char* m_read_buffer;
     char* m_write_buffer;
@@ -298,6 +402,8 @@ public:
     buffer_context& operator=(buffer_context&&) = default;
 }; // class buffer_context
 
+class deferred_value;
+
 class const_buffer_context final : public detail::buffer_context_base
 {
 public:
@@ -306,18 +412,66 @@ public:
         const std::size_t length)
     : detail::buffer_context_base(buffer, new char[length], length)
     // don't worry about leaks, buffer_context_base can't throw
+    , m_capacity(length)
     {
     }
 
+    // Creates a context to parse a nested object or array previously captured
+    // by defer(), possibly on another thread
+    explicit const_buffer_context(const deferred_value& deferred);
+
     const_buffer_context(const const_buffer_context&) = delete;
-    const_buffer_context(const_buffer_context&&) = default;
+
+    const_buffer_context(const_buffer_context&& other) noexcept
+    : detail::buffer_context_base(std::move(other))
+    , m_capacity(std::exchange(other.m_capacity, 0))
+    {
+    }
+
     const_buffer_context& operator=(const const_buffer_context&) = delete;
-    const_buffer_context& operator=(const_buffer_context&&) = default;
+
+    const_buffer_context& operator=(const_buffer_context&& other) noexcept
+    {
+        // The write buffer we currently own is released by other
+        swap(other);
+        return *this;
+    }
 
     ~const_buffer_context() noexcept
     {
         delete[] write_buffer();
     }
+
+    // Makes the context ready to parse another buffer, as if it had just been
+    // constructed, while keeping the nesting limit. The write buffer is only
+    // reallocated if it is smaller than the new buffer.
+    void reset(const char* const buffer, const std::size_t length)
+    {
+        char* new_write_buffer = write_buffer();
+        if (length > m_capacity)
+        {
+            new_write_buffer = new char[length];
+            delete[] write_buffer();
+            m_capacity = length;
+        }
+        detail::buffer_context_base::reset(buffer, new_write_buffer, length);
+    }
+
+    void swap(const_buffer_context& other) noexcept
+    {
+        detail::buffer_context_base::swap(other);
+        std::swap(m_capacity, other.m_capacity);
+    }
+
+    friend void swap(
+        const_buffer_context& lhs,
+        const_buffer_context& rhs) noexcept
+    {
+        lhs.swap(rhs);
+    }
+
+private:
+    std::size_t m_capacity;
 }; // class const_buffer_context
 
 class istream_context final : public detail::context_base
@@ -385,1780 +539,7037 @@ private:
     std::forward_list<std::vector<char>> m_literals;
 }; // class istream_context
 
-class parse_error final : public std::exception
+// The sizes of the ring of blocks of a pipelined_istream_context
+struct pipeline_options final
+{
+    std::size_t block_size = 64 * 1024;
+    std::size_t block_count = 8;
+};
+
+namespace detail
+{
+
+// Single-producer/single-consumer ring of blocks: the producer fills and
+// publishes the block at the tail, the consumer reads and releases the block
+// at the head. Each index is only ever written by one thread, so that no locks
+// are taken unless one of the two has to wait for the other
+class block_ring final
 {
 public:
-    enum error_reason
+    explicit block_ring(const pipeline_options& options)
+    : m_block_size(std::max<std::size_t>(options.block_size, 1))
+    , m_block_count(std::max<std::size_t>(options.block_count, 1))
+    , m_data(m_block_size * m_block_count)
+    , m_sizes(m_block_count)
     {
-        UNKNOWN,
-        EXPECTED_OPENING_QUOTE,
-        EXPECTED_UTF16_LOW_SURROGATE,
-        INVALID_ESCAPE_SEQUENCE,
-        INVALID_UTF16_CHARACTER,
-        INVALID_VALUE,
-        UNTERMINATED_VALUE,
-        EXPECTED_OPENING_BRACKET,
-        EXPECTED_COLON,
-        EXPECTED_COMMA_OR_CLOSING_BRACKET,
-        NESTED_OBJECT_OR_ARRAY_NOT_PARSED,
-        EXCEEDED_NESTING_LIMIT,
-        NULL_UTF16_CHARACTER,
-        EXPECTED_VALUE,
-        UNESCAPED_CONTROL_CHARACTER,
-    };
+    }
 
-    template<typename Context>
-    explicit parse_error(
-        const Context& context,
-        const error_reason reason) noexcept
-    : m_offset(get_offset(context))
-    , m_reason(reason)
+    std::size_t block_size() const noexcept
     {
+        return m_block_size;
     }
 
-    std::size_t offset() const noexcept
+    // Producer side: waits for a free block, and returns it, or nullptr if the
+    // ring has been stopped
+    char* acquire_back()
     {
-        return m_offset;
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        wait(
+            m_producer_waiting,
+            m_producer_stalls,
+            [&]
+            {
+                return tail - m_head.load() < m_block_count || m_stopped;
+            });
+
+        return !m_stopped ? block(tail) : nullptr;
     }
 
-    error_reason reason() const noexcept
+    // Producer side: publishes the block returned by acquire_back(). An empty
+    // block marks the end of the input
+    void publish(const std::size_t size)
     {
-        return m_reason;
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        m_sizes[tail % m_block_count] = size;
+        m_tail.store(tail + 1);
+        wake(m_consumer_waiting);
     }
 
-    const char* what() const noexcept override
+    // Producer side: the error to be rethrown by the consumer at the end of
+    // the input
+    void set_error(const std::exception_ptr& error) noexcept
     {
-        switch (m_reason)
-        {
-        case UNKNOWN:
-            return "Unknown parse error";
-        case EXPECTED_OPENING_QUOTE:
-            return "Expected opening quote";
-        case EXPECTED_UTF16_LOW_SURROGATE:
-            return "Expected UTF-16 low surrogate";
-        case INVALID_ESCAPE_SEQUENCE:
-            return "Invalid escape sequence";
-        case INVALID_UTF16_CHARACTER:
-            return "Invalid UTF-16 character";
-        case INVALID_VALUE:
-            return "Invalid value";
-        case UNTERMINATED_VALUE:
-            return "Unterminated value";
-        case EXPECTED_OPENING_BRACKET:
-            return "Expected opening bracket";
-        case EXPECTED_COLON:
-            return "Expected colon";
-        case EXPECTED_COMMA_OR_CLOSING_BRACKET:
-            return "Expected comma or closing bracket";
-        case NESTED_OBJECT_OR_ARRAY_NOT_PARSED:
-            return "Nested object or array not parsed";
-        case EXCEEDED_NESTING_LIMIT:
-            return "Exceeded nesting limit ("
-                MJR_STRINGIFY(MJR_NESTING_LIMIT) ")";
-        case NULL_UTF16_CHARACTER:
-            return "Null UTF-16 character";
-        case EXPECTED_VALUE:
-            return "Expected a value";
-        case UNESCAPED_CONTROL_CHARACTER:
-            return "Unescaped control character";
-        }
-
-        return ""; // to suppress compiler warnings -- LCOV_EXCL_LINE
+        m_error = error;
     }
 
-private:
-    template<typename Context>
-    static std::size_t get_offset(const Context& context) noexcept
+    // Consumer side: waits for a block to be published, and returns it
+    std::pair<const char*, std::size_t> front()
     {
-        const std::size_t read_offset = context.read_offset();
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        wait(
+            m_consumer_waiting,
+            m_consumer_stalls,
+            [&] { return m_tail.load() != head; });
 
-        return (read_offset != 0) ? (read_offset - 1) : 0;
+        return {block(head), m_sizes[head % m_block_count]};
     }
 
-    std::size_t m_offset;
-    error_reason m_reason;
-}; // class parse_error
-
-// LCOV_EXCL_START
-inline std::ostream& operator<<(
-    std::ostream& out,
-    const parse_error::error_reason reason)
-{
-    switch (reason)
+    // Consumer side: releases the block returned by front()
+    void pop()
     {
-    case parse_error::UNKNOWN:
-        return out << "UNKNOWN";
-    case parse_error::EXPECTED_OPENING_QUOTE:
-        return out << "EXPECTED_OPENING_QUOTE";
-    case parse_error::EXPECTED_UTF16_LOW_SURROGATE:
-        return out << "EXPECTED_UTF16_LOW_SURROGATE";
-    case parse_error::INVALID_ESCAPE_SEQUENCE:
-        return out << "INVALID_ESCAPE_SEQUENCE";
-    case parse_error::INVALID_UTF16_CHARACTER:
-        return out << "INVALID_UTF16_CHARACTER";
-    case parse_error::INVALID_VALUE:
-        return out << "INVALID_VALUE";
-    case parse_error::UNTERMINATED_VALUE:
-        return out << "UNTERMINATED_VALUE";
-    case parse_error::EXPECTED_OPENING_BRACKET:
-        return out << "EXPECTED_OPENING_BRACKET";
-    case parse_error::EXPECTED_COLON:
-        return out << "EXPECTED_COLON";
-    case parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET:
-        return out << "EXPECTED_COMMA_OR_CLOSING_BRACKET";
-    case parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED:
-        return out << "NESTED_OBJECT_OR_ARRAY_NOT_PARSED";
-    case parse_error::EXCEEDED_NESTING_LIMIT:
-        return out << "EXCEEDED_NESTING_LIMIT";
-    case parse_error::NULL_UTF16_CHARACTER:
-        return out << "NULL_UTF16_CHARACTER";
-    case parse_error::EXPECTED_VALUE:
-        return out << "EXPECTED_VALUE";
-    case parse_error::UNESCAPED_CONTROL_CHARACTER:
-        return out << "UNESCAPED_CONTROL_CHARACTER";
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1);
+        wake(m_producer_waiting);
     }
 
-    return out << "UNKNOWN";
-}
-// LCOV_EXCL_STOP
-
-namespace detail
-{
-
-// Tells whether a character is acceptable JSON whitespace to separate tokens
-inline bool is_whitespace(const char c)
-{
-    switch (c)
+    // Consumer side: rethrows the error set by the producer, if any
+    void rethrow_error() const
     {
-    case ' ':
-    case '\n':
-    case '\r':
-    case '\t':
-        return true;
-    default:
-        return false;
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
     }
-}
 
-// Tells whether a character can be used to terminate a value not enclosed in
-// quotes (i.e. Null, Boolean and Number)
-inline bool is_value_termination(const char c)
-{
-    switch (c)
+    // Makes the producer give up
+    void stop()
     {
-    case ',':
-    case '}':
-    case ']':
-        return true;
-    default:
-        return is_whitespace(c);
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        m_condition.notify_all();
     }
-}
 
-// There is an std::isdigit() but it's weird (takes an int among other things)
-inline bool is_digit(const char c)
-{
-    switch (c)
+    std::size_t producer_stalls() const noexcept
     {
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-        return true;
-    default:
-        return false;
+        return m_producer_stalls.load(std::memory_order_relaxed);
     }
-}
 
-// There is an std::isxdigit() but it's weird (takes an int among other things)
-inline bool is_hex_digit(const char c)
-{
-    switch (c)
+    std::size_t consumer_stalls() const noexcept
     {
-    case 'a':
-    case 'A':
-    case 'b':
-    case 'B':
-    case 'c':
-    case 'C':
-    case 'd':
-    case 'D':
-    case 'e':
-    case 'E':
-    case 'f':
-    case 'F':
-        return true;
-    default:
-        return is_digit(c);
+        return m_consumer_stalls.load(std::memory_order_relaxed);
     }
-}
-
-// This exception is thrown internally by the functions dealing with UTF-16
-// escape sequences and is not propagated outside of the library
-struct encoding_error
-{
-};
 
-inline std::uint32_t utf16_to_utf32(std::uint16_t high, std::uint16_t low)
-{
-    std::uint32_t result;
+private:
+    char* block(const std::size_t index) noexcept
+    {
+        return m_data.data() + (index % m_block_count) * m_block_size;
+    }
 
-    if (high <= 0xD7FF || high >= 0xE000)
+    // The waiting flag and the index checked by ready() are both accessed with
+    // sequentially consistent operations, so that either the waiting thread
+    // sees the new index, or the other thread sees the flag, and notifies it
+    template<typename Ready>
+    void wait(
+        std::atomic<bool>& waiting,
+        std::atomic<std::size_t>& stalls,
+        const Ready& ready)
     {
-        if (low != 0)
+        if (ready())
         {
-            // Since the high code unit is not a surrogate, the low code unit
-            // should be zero
-            throw encoding_error();
+            return;
         }
 
-        result = high;
-    }
-    else
-    {
-        if (high > 0xDBFF) // we already know high >= 0xD800
+        std::unique_lock<std::mutex> lock(m_mutex);
+        waiting = true;
+        if (!ready())
         {
-            // The high surrogate is not within the expected range
-            throw encoding_error();
+            stalls.fetch_add(1, std::memory_order_relaxed);
+            m_condition.wait(lock, ready);
         }
+        waiting = false;
+    }
 
-        if (low < 0xDC00 || low > 0xDFFF)
+    void wake(const std::atomic<bool>& waiting)
+    {
+        if (waiting)
         {
-            // The low surrogate is not within the expected range
-            throw encoding_error();
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_condition.notify_all();
         }
-
-        high -= 0xD800;
-        low -= 0xDC00;
-        result = 0x010000 + ((high << 10) | low);
     }
 
-    return result;
-}
-
-inline std::array<std::uint8_t, 4> utf32_to_utf8(const std::uint32_t utf32_char)
+    const std::size_t m_block_size;
+    const std::size_t m_block_count;
+    std::vector<char> m_data;
+    std::vector<std::size_t> m_sizes;
+    std::exception_ptr m_error;
+    std::atomic<std::size_t> m_head = 0;
+    std::atomic<std::size_t> m_tail = 0;
+    std::atomic<bool> m_producer_waiting = false;
+    std::atomic<bool> m_consumer_waiting = false;
+    std::atomic<std::size_t> m_producer_stalls = 0;
+    std::atomic<std::size_t> m_consumer_stalls = 0;
+    std::atomic<bool> m_stopped = false;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+}; // class block_ring
+
+// Base for contexts whose input is read in blocks by a dedicated producer
+// thread, which fills a ring of blocks while the parser consumes them. The
+// reader is called by the producer thread as reader(block, block_size), and
+// returns the number of characters it has read, 0 meaning the end of the input
+class block_reader_context_base : public context_base
 {
-    std::array<std::uint8_t, 4> result {};
+public:
+    block_reader_context_base(const block_reader_context_base&) = delete;
+    block_reader_context_base(block_reader_context_base&&) = default;
+    block_reader_context_base& operator=(
+        const block_reader_context_base&) = delete;
 
-    // All the static_casts below are to please VS2022
-    if (utf32_char <= 0x00007F)
-    {
-        std::get<0>(result) = static_cast<std::uint8_t>(utf32_char);
-    }
-    else if (utf32_char <= 0x0007FF)
-    {
-        std::get<0>(result) =
-            static_cast<std::uint8_t>(
-                0xC0 | ((utf32_char & (0x1F << 6)) >> 6));
-        std::get<1>(result) =
-            static_cast<std::uint8_t>(
-                0x80 | (utf32_char & 0x3F));
-    }
-    else if (utf32_char <= 0x00FFFF)
+    block_reader_context_base& operator=(
+        block_reader_context_base&& other) noexcept
     {
-        std::get<0>(result) =
-            static_cast<std::uint8_t>(
-                0xE0 | ((utf32_char & (0x0F << 12)) >> 12));
-        std::get<1>(result) =
-            static_cast<std::uint8_t>(
-                0x80 | ((utf32_char & (0x3F << 6)) >> 6));
-        std::get<2>(result) =
-            static_cast<std::uint8_t>(
-                0x80 | (utf32_char & 0x3F));
+        if (this != &other)
+        {
+            stop();
+            context_base::operator=(std::move(other));
+            m_ring = std::move(other.m_ring);
+            m_producer = std::move(other.m_producer);
+            m_position = std::exchange(other.m_position, nullptr);
+            m_end = std::exchange(other.m_end, nullptr);
+            m_read_offset = std::exchange(other.m_read_offset, 0);
+            m_literals = std::move(other.m_literals);
+        }
+        return *this;
     }
-    else if (utf32_char <= 0x1FFFFF)
+
+    ~block_reader_context_base()
     {
-        std::get<0>(result) =
-            static_cast<std::uint8_t>(
-                0xF0 | ((utf32_char & (0x07 << 18)) >> 18));
-        std::get<1>(result) =
-            static_cast<std::uint8_t>(
-                0x80 | ((utf32_char & (0x3F << 12)) >> 12));
-        std::get<2>(result) =
-            static_cast<std::uint8_t>(
-                0x80 | ((utf32_char & (0x3F << 6)) >> 6));
-        std::get<3>(result) =
-            static_cast<std::uint8_t>(
-                0x80 | (utf32_char & 0x3F));
+        stop();
     }
-    else
+
+    char read()
     {
-        // Invalid code unit
-        throw encoding_error();
-    }
+        if (m_position == m_end && !next_block())
+        {
+            return 0;
+        }
 
-    return result;
-}
+        ++m_read_offset;
 
-inline std::array<std::uint8_t, 4> utf16_to_utf8(
-    const std::uint16_t high,
-    const std::uint16_t low)
-{
-    return utf32_to_utf8(utf16_to_utf32(high, low));
-}
+        return *m_position++;
+    }
 
-inline std::uint8_t parse_hex_digit(const char c)
-{
-    switch (c)
+    std::size_t read_offset() const noexcept
     {
-    case '0':
-        return 0x0;
-    case '1':
-        return 0x1;
-    case '2':
-        return 0x2;
-    case '3':
-        return 0x3;
-    case '4':
-        return 0x4;
-    case '5':
-        return 0x5;
-    case '6':
-        return 0x6;
-    case '7':
-        return 0x7;
-    case '8':
-        return 0x8;
-    case '9':
-        return 0x9;
-    case 'a':
-    case 'A':
-        return 0xa;
-    case 'b':
-    case 'B':
-        return 0xb;
-    case 'c':
-    case 'C':
-        return 0xc;
-    case 'd':
-    case 'D':
-        return 0xd;
-    case 'e':
-    case 'E':
-        return 0xe;
-    case 'f':
-    case 'F':
-        return 0xf;
-    default:
-        throw encoding_error();
+        return m_read_offset;
     }
-}
 
-inline std::uint16_t parse_utf16_escape_sequence(
-    const std::array<char, 4>& sequence)
-{
-    std::uint16_t result = 0;
+    void begin_literal()
+    {
+        m_literals.emplace_front();
+    }
 
-    for (const char c : sequence)
+    void write(const char c)
     {
-        result <<= 4;
-        result |= parse_hex_digit(c);
+        m_literals.front().push_back(c);
     }
 
-    return result;
-}
+    // This method to retrieve the address of the current literal MUST be called
+    // AFTER all the calls to write() for the current current literal have been
+    // performed
+    const char* current_literal() const noexcept
+    {
+        const std::vector<char>& literal = m_literals.front();
 
-template<typename Context>
-void write_utf8_char(
-    literal_io<Context>& literal_io,
-    const std::array<std::uint8_t, 4>& c)
-{
-    literal_io.write(std::get<0>(c));
+        return !literal.empty() ? literal.data() : nullptr;
+    }
 
-    for (std::size_t i = 1; i < c.size() && c[i]; ++i)
+    std::size_t current_literal_length() const noexcept
     {
-        literal_io.write(c[i]);
+        return m_literals.front().size();
     }
-}
-
-// Parses a string enclosed in quotes, dealing with escape sequences.
-// Assumes the opening quote has already been parsed.
-template<typename Context>
-std::string_view parse_string(Context& context)
-{
-    literal_io literal_io(context);
 
-    enum
+    // How many times the producer thread had to wait for the parser to
+    // release a block, i.e. the ring was full
+    std::size_t producer_stalls() const noexcept
     {
-        CHARACTER,
-        ESCAPE_SEQUENCE,
-        UTF16_SEQUENCE,
-        CLOSED
-    } state = CHARACTER;
+        return m_ring->producer_stalls();
+    }
 
-    std::array<char, 4> utf16_seq {};
-    std::size_t utf16_seq_offset = 0;
-    std::uint16_t high_surrogate = 0;
+    // How many times the parser had to wait for the producer thread to fill
+    // a block, i.e. the ring was empty
+    std::size_t consumer_stalls() const noexcept
+    {
+        return m_ring->consumer_stalls();
+    }
 
-    char c;
+protected:
+    template<typename Reader>
+    block_reader_context_base(const pipeline_options& options, Reader reader)
+    : m_ring(std::make_unique<block_ring>(options))
+    , m_producer(produce<Reader>, m_ring.get(), std::move(reader))
+    {
+    }
 
-    while (state != CLOSED && (c = literal_io.read()) != 0)
+private:
+    template<typename Reader>
+    static void produce(block_ring* ring, Reader reader)
     {
-        switch (state)
+        while (char* const block = ring->acquire_back())
         {
-        case CHARACTER:
-            if (c == '\\')
-            {
-                state = ESCAPE_SEQUENCE;
-            }
-            else if (high_surrogate != 0)
-            {
-                throw parse_error(
-                    context,
-                    parse_error::EXPECTED_UTF16_LOW_SURROGATE);
-            }
-            else if (c == '"')
-            {
-                state = CLOSED;
-            }
-            else if (c >= 0x1 && c <= 0x1F)
+            std::size_t size = 0;
+            try
             {
-                throw parse_error(
-                    context,
-                    parse_error::UNESCAPED_CONTROL_CHARACTER);
+                size = reader(block, ring->block_size());
             }
-            else
+            catch (...)
             {
-                literal_io.write(c);
+                ring->set_error(std::current_exception());
             }
-            break;
-
-        case ESCAPE_SEQUENCE:
-            state = CHARACTER;
 
-            switch (c)
+            ring->publish(size);
+            if (size == 0)
             {
-            case '"':
-                literal_io.write('"');
-                break;
-            case '\\':
-                literal_io.write('\\');
                 break;
-            case '/':
-                literal_io.write('/');
-                break;
-            case 'b':
-                literal_io.write('\b');
-                break;
-            case 'f':
-                literal_io.write('\f');
-                break;
-            case 'n':
-                literal_io.write('\n');
-                break;
-            case 'r':
-                literal_io.write('\r');
-                break;
-            case 't':
-                literal_io.write('\t');
-                break;
-            case 'u':
-                state = UTF16_SEQUENCE;
-                break;
-            default:
-                throw parse_error(
-                    context,
-                    parse_error::INVALID_ESCAPE_SEQUENCE);
-            }
-            break;
-
-        case UTF16_SEQUENCE:
-            if (!is_hex_digit(c))
-            {
-                throw parse_error(
-                    context,
-                    parse_error::INVALID_ESCAPE_SEQUENCE);
             }
+        }
+    }
 
-            utf16_seq[utf16_seq_offset++] = c;
-
-            if (utf16_seq_offset == utf16_seq.size())
-            {
-                try
-                {
-                    const std::uint16_t code_unit =
-                        parse_utf16_escape_sequence(utf16_seq);
-
-                    if (code_unit == 0 && high_surrogate == 0)
-                    {
-                        throw parse_error(
-                            context,
-                            parse_error::NULL_UTF16_CHARACTER);
-                    }
+    bool next_block()
+    {
+        if (m_end != nullptr) // the current block has been consumed
+        {
+            m_ring->pop();
+        }
 
-                    if (high_surrogate != 0)
-                    {
-                        // We were waiting for the low surrogate
-                        // (that now is code_unit)
-                        write_utf8_char(
-                            literal_io,
-                            utf16_to_utf8(high_surrogate, code_unit));
-                        high_surrogate = 0;
-                    }
-                    else if (code_unit >= 0xD800 && code_unit <= 0xDBFF)
-                    {
-                        high_surrogate = code_unit;
-                    }
-                    else
-                    {
-                        write_utf8_char(
-                            literal_io,
-                            utf16_to_utf8(code_unit, 0));
-                    }
-                }
-                catch (const encoding_error&)
-                {
-                    throw parse_error(
-                        context,
-                        parse_error::INVALID_UTF16_CHARACTER);
-                }
+        const auto [block, size] = m_ring->front();
+        if (size == 0)
+        {
+            // The end block is never released, so that it is found again by
+            // further reads
+            m_position = m_end = nullptr;
+            m_ring->rethrow_error();
 
-                utf16_seq_offset = 0;
+            return false;
+        }
 
-                state = CHARACTER;
-            }
-            break;
+        m_position = block;
+        m_end = block + size;
 
-        // LCOV_EXCL_START
-        case CLOSED:
-            throw std::runtime_error(
-                "[minijson_reader] this line should never be reached, "
-                "please file a bug report");
-        // LCOV_EXCL_STOP
-        }
+        return true;
     }
 
-    if (state != CLOSED)
+    void stop() noexcept
     {
-        throw parse_error(context, parse_error::UNTERMINATED_VALUE);
+        if (m_ring)
+        {
+            m_ring->stop();
+            m_producer.join();
+        }
     }
 
-    return literal_io.finalize();
-}
-
-// Type trait to check if T is a specialization of std::optional
-template<typename T> struct is_std_optional
-    : std::false_type {};
-template<typename U> struct is_std_optional<std::optional<U>>
-    : std::true_type {};
-
-// Standard trick to prevent a static_assert() from always going off
-// when it is inside a final "else" of a sequence of "if constexpr" blocks
-template<typename> inline constexpr bool type_dependent_false = false;
+    std::unique_ptr<block_ring> m_ring;
+    std::thread m_producer;
+    const char* m_position = nullptr;
+    const char* m_end = nullptr;
+    std::size_t m_read_offset = 0;
+    std::forward_list<std::vector<char>> m_literals;
+}; // class block_reader_context_base
 
 } // namespace detail
 
-enum value_type
+// Like istream_context, but the stream is read in blocks by a dedicated
+// producer thread, which fills a ring of blocks while the parser consumes them
+class pipelined_istream_context final
+: public detail::block_reader_context_base
 {
-    String,
-    Number,
-    Boolean,
-    Object,
-    Array,
-    Null
-};
+public:
+    explicit pipelined_istream_context(
+        std::istream& stream,
+        const pipeline_options& options = pipeline_options())
+    : block_reader_context_base(
+        options,
+        [stream = &stream](char* const block, const std::size_t size)
+        {
+            stream->read(block, static_cast<std::streamsize>(size));
 
-class bad_value_cast final : public std::invalid_argument
+            return static_cast<std::size_t>(stream->gcount());
+        })
+    {
+    }
+}; // class pipelined_istream_context
+
+// Reads a C file in blocks, with double buffering: a helper thread reads the
+// next block while the parser consumes the current one
+class file_context final : public detail::block_reader_context_base
 {
 public:
-    using std::invalid_argument::invalid_argument;
-};
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+    explicit file_context(
+        std::FILE* const file,
+        const std::size_t block_size = DEFAULT_BLOCK_SIZE)
+    : block_reader_context_base(
+        pipeline_options{block_size, 2},
+        [file](char* const block, const std::size_t size)
+        {
+            const std::size_t read = std::fread(block, 1, size, file);
+            if (read < size && std::ferror(file))
+            {
+                throw std::system_error(
+                    errno,
+                    std::generic_category(),
+                    "Cannot read the file");
+            }
 
-template<typename T, typename Enable = void>
-struct value_as;
+            return read;
+        })
+    {
+    }
+}; // class file_context
 
-class value final
+#ifdef MJR_HAS_MMAP
+
+// Reads a file through a memory mapped window, which slides over the file as
+// the parser advances, so that arbitrarily large files can be parsed with
+// bounded memory. The window is split into steps: when the parser enters a
+// step, the kernel is advised to read the following one ahead, and to drop the
+// previous one
+class mmap_context final : public detail::context_base
 {
 public:
-    explicit value() noexcept = default;
+    static constexpr std::size_t DEFAULT_WINDOW_SIZE = 64 * 1024 * 1024;
+    static constexpr std::size_t STEPS_PER_WINDOW = 4;
 
-    explicit value(
-        const value_type type,
-        const std::string_view raw_value = "") noexcept
-    : m_type(type)
-    , m_raw_value(raw_value)
+    explicit mmap_context(
+        const int fd,
+        const std::size_t window_size = DEFAULT_WINDOW_SIZE)
+    : m_fd(fd)
     {
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            throw std::system_error(
+                errno,
+                std::generic_category(),
+                "Cannot stat the file");
+        }
+        m_file_size = static_cast<std::size_t>(status.st_size);
+
+        // The window and the steps must be aligned to pages
+        const std::size_t page_size =
+            static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        m_step_size = std::max<std::size_t>(
+            window_size / STEPS_PER_WINDOW / page_size, 1) * page_size;
+        m_window_size = m_step_size * STEPS_PER_WINDOW;
     }
 
-    value_type type() const noexcept
-    {
-        return m_type;
-    }
+    mmap_context(const mmap_context&) = delete;
 
-    std::string_view raw() const
+    mmap_context(mmap_context&& other) noexcept
+    : context_base(std::move(other))
+    , m_fd(other.m_fd)
+    , m_file_size(other.m_file_size)
+    , m_window_size(other.m_window_size)
+    , m_step_size(other.m_step_size)
+    , m_window(std::exchange(other.m_window, nullptr))
+    , m_window_end(std::exchange(other.m_window_end, nullptr))
+    , m_position(std::exchange(other.m_position, nullptr))
+    , m_step_end(std::exchange(other.m_step_end, nullptr))
+    , m_read_offset(std::exchange(other.m_read_offset, 0))
+    , m_literals(std::move(other.m_literals))
     {
-        return m_raw_value;
     }
 
-    template<typename T>
-    T as() const
+    mmap_context& operator=(const mmap_context&) = delete;
+
+    mmap_context& operator=(mmap_context&& other) noexcept
     {
-        return value_as<T>()(*this);
+        if (this != &other)
+        {
+            unmap();
+            context_base::operator=(std::move(other));
+            m_fd = other.m_fd;
+            m_file_size = other.m_file_size;
+            m_window_size = other.m_window_size;
+            m_step_size = other.m_step_size;
+            m_window = std::exchange(other.m_window, nullptr);
+            m_window_end = std::exchange(other.m_window_end, nullptr);
+            m_position = std::exchange(other.m_position, nullptr);
+            m_step_end = std::exchange(other.m_step_end, nullptr);
+            m_read_offset = std::exchange(other.m_read_offset, 0);
+            m_literals = std::move(other.m_literals);
+        }
+        return *this;
     }
 
-    template<typename T>
-    T& to(T& dest) const
+    ~mmap_context()
     {
-        dest = as<T>();
-        return dest;
+        unmap();
     }
 
-private:
-    value_type m_type = Null;
-    std::string_view m_raw_value = "null";
-}; // class value
-
-// Fallback behavior of value::as<T>() when no user-provided value_as
-// specialization for T exists.
-// This function is also meant to be called directly by the user in case they
-// need to fall back to the default behavior inside their value_as
-// specialization for T, for whatever reason.
-template<typename T>
-T value_as_default(const value v)
-{
-    if constexpr (detail::is_std_optional<T>())
+    char read()
     {
-        using U = typename T::value_type;
-        static_assert(
-            !detail::is_std_optional<U>(),
-            "it appears that T is std::optional<std::optional<...>> which is "
-            "unlikely to be what you meant to do");
-
-        if (v.type() == Null)
+        if (m_position == m_step_end && !advance())
         {
-            return std::nullopt;
+            return 0;
         }
 
-        return v.as<U>();
+        ++m_read_offset;
+
+        return *m_position++;
     }
-    else // not an optional
+
+    std::size_t read_offset() const noexcept
     {
-        switch (v.type())
-        {
-        case Null:
-            throw bad_value_cast(
-                "cannot call value::as<T>() on values of type Null: "
-                "consider checking value::type() first, or use "
-                "value::as<std::optional<T>>()");
+        return m_read_offset;
+    }
 
-        case Object:
-            throw bad_value_cast(
-                "cannot call value::as<T>() on values of type Object: "
-                "you have to call parse_object() on the same context");
+    void begin_literal()
+    {
+        m_literals.emplace_front();
+    }
 
-        case Array:
-            throw bad_value_cast(
-                "cannot call value::as<T>() on values of type Array: "
-                "you have to call parse_array() on the same context");
+    void write(const char c)
+    {
+        m_literals.front().push_back(c);
+    }
 
-        case String:
-        case Boolean:
-        case Number:
-            break;
-        }
+    // This method to retrieve the address of the current literal MUST be called
+    // AFTER all the calls to write() for the current current literal have been
+    // performed
+    const char* current_literal() const noexcept
+    {
+        const std::vector<char>& literal = m_literals.front();
 
-        const std::string_view raw = v.raw();
+        return !literal.empty() ? literal.data() : nullptr;
+    }
 
-        if constexpr (std::is_same_v<T, std::string_view>)
-        {
-            if (v.type() != String)
-            {
-                throw bad_value_cast(
-                    "value::as<T>(): value type is not String");
-            }
+    std::size_t current_literal_length() const noexcept
+    {
+        return m_literals.front().size();
+    }
 
-            return raw;
-        }
-        else if constexpr (std::is_same_v<T, bool>)
+    std::size_t window_size() const noexcept
+    {
+        return m_window_size;
+    }
+
+private:
+    // Called when the parser reaches the end of the current step
+    bool advance()
+    {
+        if (m_read_offset >= m_file_size)
         {
-            if (v.type() != Boolean)
-            {
-                throw bad_value_cast(
-                    "value::as<T>(): value type is not Boolean");
-            }
+            return false;
+        }
 
-            // If this value comes from parse_object() or parse_array(),
-            // as it should, we know that raw is either "true" or "false".
-            // However, we do a paranoia check for emptiness.
-            return !raw.empty() && raw[0] == 't';
+        if (m_position == m_window_end)
+        {
+            map(m_read_offset);
         }
-        else if constexpr (std::is_arithmetic_v<T>)
+        else
         {
-            if (v.type() != Number)
-            {
-                throw bad_value_cast(
-                    "value::as<T>(): value type is not Number");
-            }
+            drop_behind();
+        }
 
-            T result {}; // value initialize to silence compiler warnings
-            const auto begin = raw.data();
-            const auto end = raw.data() + raw.size();
-            const auto [parse_end, error] = std::from_chars(begin, end, result);
-            if (parse_end != end || error != std::errc())
-            {
-                throw std::range_error(
-                    "value::as<T>() could not parse the number");
-            }
-            return result;
+        // The following step is read ahead, unless it is in the next window
+        m_step_end = m_position + std::min<std::size_t>(
+            m_step_size,
+            m_window_end - m_position);
+        advise(m_step_end, m_step_size, MADV_WILLNEED);
+
+        return true;
+    }
+
+    // Maps the window starting at the given offset, which is aligned to pages
+    void map(const std::size_t offset)
+    {
+        unmap();
+
+        const std::size_t length =
+            std::min(m_window_size, m_file_size - offset);
+        void* const window = mmap(
+            nullptr,
+            length,
+            PROT_READ,
+            MAP_SHARED,
+            m_fd,
+            static_cast<off_t>(offset));
+        if (window == MAP_FAILED)
+        {
+            throw std::system_error(
+                errno,
+                std::generic_category(),
+                "Cannot map the file");
         }
-        else // unsupported type
+
+        m_window = static_cast<const char*>(window);
+        m_window_end = m_window + length;
+        m_position = m_window;
+        advise(m_window, length, MADV_SEQUENTIAL);
+        advise(m_window, m_step_size, MADV_WILLNEED);
+    }
+
+    void unmap() noexcept
+    {
+        if (m_window != nullptr)
         {
-            // We need the predicate of static_assert() to depend on T,
-            // otherwise the assert always goes off.
-            static_assert(
-                detail::type_dependent_false<T>,
-                "value::as<T>(): T is not one of the supported types "
-                "(std::string_view, bool, arithmetic types, plus all of the "
-                "above wrapped in std::optional)");
+            drop_behind();
+            munmap(const_cast<char*>(m_window), m_window_end - m_window);
+            m_window = nullptr;
         }
     }
-}
 
-template<typename T, typename Enable>
-struct value_as final
-{
-    T operator()(const value v) const
+    // Drops the step preceding the current position, both from the mapping
+    // and from the page cache
+    void drop_behind() noexcept
     {
-        return value_as_default<T>(v);
+        const std::size_t length = std::min<std::size_t>(
+            m_step_size,
+            m_position - m_window);
+        advise(m_position - length, length, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+        posix_fadvise(
+            m_fd,
+            static_cast<off_t>(m_read_offset - length),
+            static_cast<off_t>(length),
+            POSIX_FADV_DONTNEED);
+#endif
+    }
+
+    // The advice is clipped to the window, and ignored if it fails, as it is
+    // only a hint
+    void advise(
+        const char* const begin,
+        const std::size_t length,
+        const int advice) const noexcept
+    {
+        const std::size_t clipped = std::min<std::size_t>(
+            length,
+            m_window_end - begin);
+        if (clipped > 0)
+        {
+            madvise(const_cast<char*>(begin), clipped, advice);
+        }
     }
+
+    int m_fd;
+    std::size_t m_file_size = 0;
+    std::size_t m_window_size = 0;
+    std::size_t m_step_size = 0;
+    const char* m_window = nullptr;
+    const char* m_window_end = nullptr;
+    const char* m_position = nullptr;
+    const char* m_step_end = nullptr;
+    std::size_t m_read_offset = 0;
+    std::forward_list<std::vector<char>> m_literals;
+}; // class mmap_context
+
+// Thrown when a shared memory ring is invalid or corrupted
+class shm_ring_error final : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
 };
 
 namespace detail
 {
 
-// Convenience function to consume a verbatim sequence of characters
-// in a value not enclosed in quotes (in practice, Null and Boolean).
-// Returns the value termination character (e.g. ',').
-template<typename Context, std::size_t Size>
-char consume(
-    literal_io<Context>& literal_io,
-    const std::array<char, Size>& sequence)
+struct shm_ring_header final
 {
-    for (const char expected : sequence)
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    alignas(64) std::atomic<std::uint64_t> head; // written by the consumer
+    alignas(64) std::atomic<std::uint64_t> tail; // written by the producer
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+} // namespace detail
+
+// Ring of JSON messages in shared memory (e.g. a memfd or a shm_open()
+// object), written by a producer process and parsed in place by a consumer
+// process. The shared memory starts with a header, followed by DATA_OFFSET
+// bytes by the frames: each is made of the 32-bit length of the message and
+// the message, padded to a multiple of 8 bytes. A frame that would cross the
+// end of the ring is preceded by a padding frame with length PADDING, which
+// makes the consumer wrap around. The head and the tail of the ring are
+// positions in bytes, which only ever increase
+class shm_ring final
+{
+public:
+    static constexpr std::uint64_t MAGIC = 0x474e4952534a4d; // "MJSRING"
+    static constexpr std::uint32_t PADDING = 0xffffffff;
+    static constexpr std::size_t DATA_OFFSET = sizeof(detail::shm_ring_header);
+
+    // Sizes the shared memory behind the file descriptor, and initializes an
+    // empty ring with the given capacity (rounded up to a multiple of 8)
+    static shm_ring create(const int fd, const std::size_t capacity)
     {
-        const char read = literal_io.read();
-        if (read == 0)
+        const std::size_t aligned_capacity =
+            frame_size(std::max<std::size_t>(capacity, 8) - 4);
+        if (ftruncate(fd, static_cast<off_t>(DATA_OFFSET + aligned_capacity))
+            != 0)
         {
-            throw parse_error(
-                literal_io.context(),
-                parse_error::UNTERMINATED_VALUE);
+            throw std::system_error(
+                errno,
+                std::generic_category(),
+                "Cannot resize the shared memory");
         }
-        if (read != expected)
+
+        shm_ring ring(fd, DATA_OFFSET + aligned_capacity);
+        new (ring.m_header) detail::shm_ring_header{
+            MAGIC,
+            aligned_capacity,
+            {0},
+            {0},
+        };
+        ring.m_capacity = aligned_capacity;
+
+        return ring;
+    }
+
+    // Maps a ring initialized by create(), possibly in another process
+    static shm_ring attach(const int fd)
+    {
+        struct stat status;
+        if (fstat(fd, &status) != 0)
         {
-            throw parse_error(
-                literal_io.context(),
-                parse_error::INVALID_VALUE);
+            throw std::system_error(
+                errno,
+                std::generic_category(),
+                "Cannot stat the shared memory");
         }
-        literal_io.write(read);
+        const std::size_t size = static_cast<std::size_t>(status.st_size);
+        if (size < DATA_OFFSET)
+        {
+            throw shm_ring_error("Not a shared memory ring");
+        }
+
+        shm_ring ring(fd, size);
+        if (ring.m_header->magic != MAGIC ||
+            ring.m_header->capacity != size - DATA_OFFSET ||
+            ring.m_header->capacity == 0 ||
+            ring.m_header->capacity % 8 != 0)
+        {
+            throw shm_ring_error("Not a shared memory ring");
+        }
+        ring.m_capacity = ring.m_header->capacity;
+
+        return ring;
     }
 
-    const char read = literal_io.read();
-    if (read == 0)
+    shm_ring(const shm_ring&) = delete;
+
+    shm_ring(shm_ring&& other) noexcept
+    : m_memory(std::exchange(other.m_memory, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_header(std::exchange(other.m_header, nullptr))
+    , m_data(std::exchange(other.m_data, nullptr))
+    , m_capacity(std::exchange(other.m_capacity, 0))
     {
-        throw parse_error(
-            literal_io.context(),
-            parse_error::UNTERMINATED_VALUE);
     }
-    if (!is_value_termination(read))
+
+    shm_ring& operator=(const shm_ring&) = delete;
+
+    shm_ring& operator=(shm_ring&& other) noexcept
     {
-        throw parse_error(
-            literal_io.context(),
-            parse_error::INVALID_VALUE);
+        if (this != &other)
+        {
+            unmap();
+            m_memory = std::exchange(other.m_memory, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_header = std::exchange(other.m_header, nullptr);
+            m_data = std::exchange(other.m_data, nullptr);
+            m_capacity = std::exchange(other.m_capacity, 0);
+        }
+        return *this;
     }
-    return read;
-}
 
-// Parses primitive values that are not enclosed in quotes
-// (i.e. Null, Boolean and Number).
-// Returns the value and its termination character (e.g. ',').
-template<typename Context>
-std::tuple<value, char>
-parse_unquoted_value(Context& context, const char first_char)
-{
-    literal_io literal_io(context);
+    ~shm_ring()
+    {
+        unmap();
+    }
 
-    char c = first_char;
+    std::size_t capacity() const noexcept
+    {
+        return m_capacity;
+    }
 
-    // Cover "null", "true" and "false" cases
-    switch (c)
+    // Producer side: appends the message to the ring, unless there is not
+    // enough free space, in which case false is returned. Throws
+    // std::length_error if the message can never fit in the ring
+    bool try_write(const std::string_view message)
     {
-    case 'n': // "null"
-        literal_io.write(c);
-        c = consume(literal_io, std::array {'u', 'l', 'l'});
-        return {value(Null, literal_io.finalize()), c};
+        const std::size_t size = frame_size(message.size());
+        if (message.size() >= PADDING || size > m_capacity)
+        {
+            throw std::length_error("Message too large for the ring");
+        }
 
-    case 't': // "true"
-        literal_io.write(c);
-        c = consume(literal_io, std::array {'r', 'u', 'e'});
-        return {value(Boolean, literal_io.finalize()), c};
+        std::uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+        const std::uint64_t head =
+            m_header->head.load(std::memory_order_acquire);
+        const std::size_t offset = tail % m_capacity;
+        const std::size_t padding =
+            m_capacity - offset < size ? m_capacity - offset : 0;
+        const std::size_t free_space = m_capacity - (tail - head);
+        if (free_space < padding + size)
+        {
+            // Otherwise, the frame could never fit once the ring is empty
+            if (padding > 0 && free_space >= padding)
+            {
+                write_length(offset, PADDING);
+                m_header->tail.store(
+                    tail + padding,
+                    std::memory_order_release);
+            }
+            return false;
+        }
+
+        if (padding > 0)
+        {
+            write_length(offset, PADDING);
+            tail += padding;
+        }
+        write_length(tail % m_capacity, static_cast<std::uint32_t>(
+            message.size()));
+        std::memcpy(
+            m_data + tail % m_capacity + 4,
+            message.data(),
+            message.size());
+        m_header->tail.store(tail + size, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer side: if a message is available, calls handler(context) with a
+    // buffer_context over the message, which is parsed in place, and then
+    // releases the frame, even if the handler throws; otherwise returns false
+    template<typename Handler>
+    bool try_consume(Handler&& handler)
+    {
+        std::uint64_t head = m_header->head.load(std::memory_order_relaxed);
+        const std::uint64_t tail =
+            m_header->tail.load(std::memory_order_acquire);
+        if (head == tail)
+        {
+            return false;
+        }
+
+        std::size_t offset = head % m_capacity;
+        std::uint32_t length = read_length(offset);
+        if (length == PADDING)
+        {
+            head += m_capacity - offset;
+            offset = 0;
+            if (head == tail)
+            {
+                // The padding was written alone, by a failed try_write()
+                m_header->head.store(head, std::memory_order_release);
+                return false;
+            }
+            length = read_length(offset);
+        }
+        const std::size_t size = frame_size(length);
+        if (head >= tail || size > tail - head || size > m_capacity - offset)
+        {
+            throw shm_ring_error("Corrupted shared memory ring");
+        }
+
+        // The frame is released even if parsing fails
+        struct releaser
+        {
+            std::atomic<std::uint64_t>& head;
+            std::uint64_t next;
+
+            ~releaser()
+            {
+                head.store(next, std::memory_order_release);
+            }
+        } releaser{m_header->head, head + size};
+
+        buffer_context context(m_data + offset + 4, length);
+        handler(context);
+
+        return true;
+    }
+
+private:
+    shm_ring(const int fd, const std::size_t size)
+    : m_size(size)
+    {
+        m_memory = mmap(
+            nullptr,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED,
+            fd,
+            0);
+        if (m_memory == MAP_FAILED)
+        {
+            throw std::system_error(
+                errno,
+                std::generic_category(),
+                "Cannot map the shared memory");
+        }
+        m_header = static_cast<detail::shm_ring_header*>(m_memory);
+        m_data = static_cast<char*>(m_memory) + DATA_OFFSET;
+    }
+
+    static std::size_t frame_size(const std::size_t length) noexcept
+    {
+        return (4 + length + 7) / 8 * 8;
+    }
+
+    void write_length(const std::size_t offset, const std::uint32_t length)
+    {
+        std::memcpy(m_data + offset, &length, sizeof(length));
+    }
+
+    std::uint32_t read_length(const std::size_t offset) const
+    {
+        std::uint32_t length;
+        std::memcpy(&length, m_data + offset, sizeof(length));
+
+        return length;
+    }
+
+    void unmap() noexcept
+    {
+        if (m_memory != nullptr)
+        {
+            munmap(m_memory, m_size);
+            m_memory = nullptr;
+        }
+    }
+
+    void* m_memory = nullptr;
+    std::size_t m_size = 0;
+    detail::shm_ring_header* m_header = nullptr;
+    char* m_data = nullptr;
+    std::size_t m_capacity = 0;
+}; // class shm_ring
+
+#endif // MJR_HAS_MMAP
+
+class parse_error final : public std::exception
+{
+public:
+    enum error_reason
+    {
+        UNKNOWN,
+        EXPECTED_OPENING_QUOTE,
+        EXPECTED_UTF16_LOW_SURROGATE,
+        INVALID_ESCAPE_SEQUENCE,
+        INVALID_UTF16_CHARACTER,
+        INVALID_VALUE,
+        UNTERMINATED_VALUE,
+        EXPECTED_OPENING_BRACKET,
+        EXPECTED_COLON,
+        EXPECTED_COMMA_OR_CLOSING_BRACKET,
+        NESTED_OBJECT_OR_ARRAY_NOT_PARSED,
+        EXCEEDED_NESTING_LIMIT,
+        NULL_UTF16_CHARACTER,
+        EXPECTED_VALUE,
+        UNESCAPED_CONTROL_CHARACTER,
+        EXPECTED_END_OF_MESSAGE,
+        INVALID_UTF8,
+    };
+
+    template<typename Context>
+    explicit parse_error(
+        const Context& context,
+        const error_reason reason) noexcept
+    : m_offset(get_offset(context))
+    , m_reason(reason)
+    {
+    }
+
+    std::size_t offset() const noexcept
+    {
+        return m_offset;
+    }
+
+    error_reason reason() const noexcept
+    {
+        return m_reason;
+    }
+
+    const char* what() const noexcept override
+    {
+        switch (m_reason)
+        {
+        case UNKNOWN:
+            return "Unknown parse error";
+        case EXPECTED_OPENING_QUOTE:
+            return "Expected opening quote";
+        case EXPECTED_UTF16_LOW_SURROGATE:
+            return "Expected UTF-16 low surrogate";
+        case INVALID_ESCAPE_SEQUENCE:
+            return "Invalid escape sequence";
+        case INVALID_UTF16_CHARACTER:
+            return "Invalid UTF-16 character";
+        case INVALID_VALUE:
+            return "Invalid value";
+        case UNTERMINATED_VALUE:
+            return "Unterminated value";
+        case EXPECTED_OPENING_BRACKET:
+            return "Expected opening bracket";
+        case EXPECTED_COLON:
+            return "Expected colon";
+        case EXPECTED_COMMA_OR_CLOSING_BRACKET:
+            return "Expected comma or closing bracket";
+        case NESTED_OBJECT_OR_ARRAY_NOT_PARSED:
+            return "Nested object or array not parsed";
+        case EXCEEDED_NESTING_LIMIT:
+            return "Exceeded nesting limit";
+        case NULL_UTF16_CHARACTER:
+            return "Null UTF-16 character";
+        case EXPECTED_VALUE:
+            return "Expected a value";
+        case UNESCAPED_CONTROL_CHARACTER:
+            return "Unescaped control character";
+        case EXPECTED_END_OF_MESSAGE:
+            return "Expected end of message";
+        case INVALID_UTF8:
+            return "Invalid UTF-8";
+        }
+
+        return ""; // to suppress compiler warnings -- LCOV_EXCL_LINE
+    }
+
+private:
+    template<typename Context>
+    static std::size_t get_offset(const Context& context) noexcept
+    {
+        const std::size_t read_offset = context.read_offset();
+
+        return (read_offset != 0) ? (read_offset - 1) : 0;
+    }
+
+    std::size_t m_offset;
+    error_reason m_reason;
+}; // class parse_error
+
+// LCOV_EXCL_START
+inline std::ostream& operator<<(
+    std::ostream& out,
+    const parse_error::error_reason reason)
+{
+    switch (reason)
+    {
+    case parse_error::UNKNOWN:
+        return out << "UNKNOWN";
+    case parse_error::EXPECTED_OPENING_QUOTE:
+        return out << "EXPECTED_OPENING_QUOTE";
+    case parse_error::EXPECTED_UTF16_LOW_SURROGATE:
+        return out << "EXPECTED_UTF16_LOW_SURROGATE";
+    case parse_error::INVALID_ESCAPE_SEQUENCE:
+        return out << "INVALID_ESCAPE_SEQUENCE";
+    case parse_error::INVALID_UTF16_CHARACTER:
+        return out << "INVALID_UTF16_CHARACTER";
+    case parse_error::INVALID_VALUE:
+        return out << "INVALID_VALUE";
+    case parse_error::UNTERMINATED_VALUE:
+        return out << "UNTERMINATED_VALUE";
+    case parse_error::EXPECTED_OPENING_BRACKET:
+        return out << "EXPECTED_OPENING_BRACKET";
+    case parse_error::EXPECTED_COLON:
+        return out << "EXPECTED_COLON";
+    case parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET:
+        return out << "EXPECTED_COMMA_OR_CLOSING_BRACKET";
+    case parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED:
+        return out << "NESTED_OBJECT_OR_ARRAY_NOT_PARSED";
+    case parse_error::EXCEEDED_NESTING_LIMIT:
+        return out << "EXCEEDED_NESTING_LIMIT";
+    case parse_error::NULL_UTF16_CHARACTER:
+        return out << "NULL_UTF16_CHARACTER";
+    case parse_error::EXPECTED_VALUE:
+        return out << "EXPECTED_VALUE";
+    case parse_error::UNESCAPED_CONTROL_CHARACTER:
+        return out << "UNESCAPED_CONTROL_CHARACTER";
+    case parse_error::EXPECTED_END_OF_MESSAGE:
+        return out << "EXPECTED_END_OF_MESSAGE";
+    case parse_error::INVALID_UTF8:
+        return out << "INVALID_UTF8";
+    }
+
+    return out << "UNKNOWN";
+}
+// LCOV_EXCL_STOP
+
+namespace detail
+{
+
+// Tells whether a character is acceptable JSON whitespace to separate tokens
+inline bool is_whitespace(const char c)
+{
+    switch (c)
+    {
+    case ' ':
+    case '\n':
+    case '\r':
+    case '\t':
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Tells whether a character can be used to terminate a value not enclosed in
+// quotes (i.e. Null, Boolean and Number)
+inline bool is_value_termination(const char c)
+{
+    switch (c)
+    {
+    case ',':
+    case '}':
+    case ']':
+        return true;
+    default:
+        return is_whitespace(c);
+    }
+}
+
+// There is an std::isdigit() but it's weird (takes an int among other things)
+inline bool is_digit(const char c)
+{
+    switch (c)
+    {
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Maps each character to the value of the hex digit it represents, or to
+// INVALID_HEX_DIGIT if it is not a hex digit
+inline constexpr std::uint8_t INVALID_HEX_DIGIT = 0xFF;
+
+constexpr std::array<std::uint8_t, 256> make_hex_digit_table() noexcept
+{
+    std::array<std::uint8_t, 256> table {};
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        table[i] = INVALID_HEX_DIGIT;
+    }
+    for (std::uint8_t i = 0; i < 10; ++i)
+    {
+        table['0' + i] = i;
+    }
+    for (std::uint8_t i = 0; i < 6; ++i)
+    {
+        table['a' + i] = static_cast<std::uint8_t>(10 + i);
+        table['A' + i] = static_cast<std::uint8_t>(10 + i);
+    }
+
+    return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> hex_digit_table =
+    make_hex_digit_table();
+
+inline bool is_high_surrogate(const std::uint16_t code_unit) noexcept
+{
+    return (code_unit & 0xFC00) == 0xD800;
+}
+
+inline bool is_low_surrogate(const std::uint16_t code_unit) noexcept
+{
+    return (code_unit & 0xFC00) == 0xDC00;
+}
+
+// Returns std::nullopt if the code units do not form a valid character
+inline std::optional<std::uint32_t> utf16_to_utf32(
+    const std::uint16_t high,
+    const std::uint16_t low) noexcept
+{
+    if ((high & 0xF800) != 0xD800)
+    {
+        // Since the high code unit is not a surrogate, the low code unit
+        // should be zero
+        if (low != 0)
+        {
+            return std::nullopt;
+        }
+
+        return high;
+    }
+
+    if (!is_high_surrogate(high) || !is_low_surrogate(low))
+    {
+        return std::nullopt;
+    }
+
+    // Same as 0x010000 + ((high - 0xD800) << 10 | (low - 0xDC00))
+    constexpr std::uint32_t offset = (0xD800 << 10) + 0xDC00 - 0x010000;
+
+    return (static_cast<std::uint32_t>(high) << 10) + low - offset;
+}
+
+// Returns std::nullopt if the character cannot be encoded
+inline std::optional<std::array<std::uint8_t, 4>> utf32_to_utf8(
+    const std::uint32_t utf32_char) noexcept
+{
+    std::array<std::uint8_t, 4> result {};
+
+    // All the static_casts below are to please VS2022
+    if (utf32_char <= 0x00007F)
+    {
+        std::get<0>(result) = static_cast<std::uint8_t>(utf32_char);
+    }
+    else if (utf32_char <= 0x0007FF)
+    {
+        std::get<0>(result) =
+            static_cast<std::uint8_t>(
+                0xC0 | ((utf32_char & (0x1F << 6)) >> 6));
+        std::get<1>(result) =
+            static_cast<std::uint8_t>(
+                0x80 | (utf32_char & 0x3F));
+    }
+    else if (utf32_char <= 0x00FFFF)
+    {
+        std::get<0>(result) =
+            static_cast<std::uint8_t>(
+                0xE0 | ((utf32_char & (0x0F << 12)) >> 12));
+        std::get<1>(result) =
+            static_cast<std::uint8_t>(
+                0x80 | ((utf32_char & (0x3F << 6)) >> 6));
+        std::get<2>(result) =
+            static_cast<std::uint8_t>(
+                0x80 | (utf32_char & 0x3F));
+    }
+    else if (utf32_char <= 0x1FFFFF)
+    {
+        std::get<0>(result) =
+            static_cast<std::uint8_t>(
+                0xF0 | ((utf32_char & (0x07 << 18)) >> 18));
+        std::get<1>(result) =
+            static_cast<std::uint8_t>(
+                0x80 | ((utf32_char & (0x3F << 12)) >> 12));
+        std::get<2>(result) =
+            static_cast<std::uint8_t>(
+                0x80 | ((utf32_char & (0x3F << 6)) >> 6));
+        std::get<3>(result) =
+            static_cast<std::uint8_t>(
+                0x80 | (utf32_char & 0x3F));
+    }
+    else
+    {
+        // Invalid code unit
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+inline std::optional<std::array<std::uint8_t, 4>> utf16_to_utf8(
+    const std::uint16_t high,
+    const std::uint16_t low) noexcept
+{
+    const std::optional<std::uint32_t> utf32_char = utf16_to_utf32(high, low);
+    if (!utf32_char)
+    {
+        return std::nullopt;
+    }
+
+    return utf32_to_utf8(*utf32_char);
+}
+
+template<typename Writer>
+void write_utf8_char(Writer& writer, const std::array<std::uint8_t, 4>& c)
+{
+    writer.write(std::get<0>(c));
+
+    for (std::size_t i = 1; i < c.size() && c[i]; ++i)
+    {
+        writer.write(c[i]);
+    }
+}
+
+// Reads the four hex digits following "\u" and returns the code unit they
+// represent
+template<typename Context>
+std::uint16_t read_utf16_code_unit(Context& context)
+{
+    std::uint16_t result = 0;
+
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        const char c = context.read();
+        const std::uint8_t digit =
+            hex_digit_table[static_cast<unsigned char>(c)];
+
+        if (digit == INVALID_HEX_DIGIT)
+        {
+            throw parse_error(
+                context,
+                c == 0 ?
+                    parse_error::UNTERMINATED_VALUE :
+                    parse_error::INVALID_ESCAPE_SEQUENCE);
+        }
+
+        result = static_cast<std::uint16_t>((result << 4) | digit);
+    }
+
+    return result;
+}
+
+// Reads the rest of a \u escape sequence, assuming "\u" has already been
+// parsed, together with the second escape sequence if the first one is a
+// high surrogate, and writes the UTF-8 encoding of the character
+template<typename Context, typename Writer>
+void decode_utf16_escape_sequence(Context& context, Writer& writer)
+{
+    const std::uint16_t high = read_utf16_code_unit(context);
+    std::uint16_t low = 0;
+
+    if (high == 0)
+    {
+        throw parse_error(context, parse_error::NULL_UTF16_CHARACTER);
+    }
+
+    if (is_high_surrogate(high))
+    {
+        // The low surrogate must follow immediately
+        for (const char expected : {'\\', 'u'})
+        {
+            const char c = context.read();
+            if (c != expected)
+            {
+                throw parse_error(
+                    context,
+                    c == 0 ?
+                        parse_error::UNTERMINATED_VALUE :
+                        parse_error::EXPECTED_UTF16_LOW_SURROGATE);
+            }
+        }
+
+        low = read_utf16_code_unit(context);
+    }
+
+    const std::optional<std::array<std::uint8_t, 4>> utf8_char =
+        utf16_to_utf8(high, low);
+    if (!utf8_char)
+    {
+        throw parse_error(context, parse_error::INVALID_UTF16_CHARACTER);
+    }
+
+    write_utf8_char(writer, *utf8_char);
+}
+
+// Checks that a sequence of bytes, fed one at a time, is well-formed UTF-8
+// (https://www.unicode.org/versions/latest/ch03.pdf, table 3-7)
+class utf8_validator final
+{
+public:
+    // Returns false if the byte cannot appear at this point (e.g. an ASCII
+    // character in the middle of a multi-byte character)
+    bool feed(const char c) noexcept
+    {
+        const auto byte = static_cast<std::uint8_t>(c);
+
+        if (m_remaining == 0)
+        {
+            if (byte < 0x80)
+            {
+                return true;
+            }
+
+            return begin_character(byte);
+        }
+
+        if (byte < m_lower || byte > m_upper)
+        {
+            return false;
+        }
+
+        --m_remaining;
+        m_lower = 0x80;
+        m_upper = 0xBF;
+
+        return true;
+    }
+
+    // Whether some continuation bytes are still expected
+    bool in_character() const noexcept
+    {
+        return m_remaining != 0;
+    }
+
+private:
+    bool begin_character(const std::uint8_t byte) noexcept
+    {
+        if (byte >= 0xC2 && byte <= 0xDF)
+        {
+            m_remaining = 1;
+        }
+        else if (byte >= 0xE0 && byte <= 0xEF)
+        {
+            m_remaining = 2;
+            // Exclude overlong encodings and UTF-16 surrogates
+            m_lower = (byte == 0xE0) ? 0xA0 : 0x80;
+            m_upper = (byte == 0xED) ? 0x9F : 0xBF;
+        }
+        else if (byte >= 0xF0 && byte <= 0xF4)
+        {
+            m_remaining = 3;
+            // Exclude overlong encodings and code points above U+10FFFF
+            m_lower = (byte == 0xF0) ? 0x90 : 0x80;
+            m_upper = (byte == 0xF4) ? 0x8F : 0xBF;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    std::size_t m_remaining = 0;
+    std::uint8_t m_lower = 0x80; // bounds of the next continuation byte
+    std::uint8_t m_upper = 0xBF;
+}; // class utf8_validator
+
+// Decodes a string enclosed in quotes, dealing with escape sequences, and
+// passes the decoded characters one at a time to writer.write().
+// Assumes the opening quote has already been parsed.
+template<typename Context, typename Writer>
+void decode_string(Context& context, Writer& writer)
+{
+
+    enum
+    {
+        CHARACTER,
+        ESCAPE_SEQUENCE,
+        CLOSED
+    } state = CHARACTER;
+
+    const bool validate_utf8 = context.validate_utf8();
+    utf8_validator utf8_validator;
+
+    char c;
+
+    while (state != CLOSED && (c = context.read()) != 0)
+    {
+        switch (state)
+        {
+        case CHARACTER:
+            if (c == '\\' || c == '"')
+            {
+                if (validate_utf8 && utf8_validator.in_character())
+                {
+                    // The last character is truncated
+                    throw parse_error(context, parse_error::INVALID_UTF8);
+                }
+
+                state = (c == '"') ? CLOSED : ESCAPE_SEQUENCE;
+            }
+            else if (c >= 0x1 && c <= 0x1F)
+            {
+                throw parse_error(
+                    context,
+                    parse_error::UNESCAPED_CONTROL_CHARACTER);
+            }
+            else
+            {
+                if (validate_utf8 && !utf8_validator.feed(c))
+                {
+                    throw parse_error(context, parse_error::INVALID_UTF8);
+                }
+
+                writer.write(c);
+            }
+            break;
+
+        case ESCAPE_SEQUENCE:
+            state = CHARACTER;
+
+            switch (c)
+            {
+            case '"':
+                writer.write('"');
+                break;
+            case '\\':
+                writer.write('\\');
+                break;
+            case '/':
+                writer.write('/');
+                break;
+            case 'b':
+                writer.write('\b');
+                break;
+            case 'f':
+                writer.write('\f');
+                break;
+            case 'n':
+                writer.write('\n');
+                break;
+            case 'r':
+                writer.write('\r');
+                break;
+            case 't':
+                writer.write('\t');
+                break;
+            case 'u':
+                decode_utf16_escape_sequence(context, writer);
+                break;
+            default:
+                throw parse_error(
+                    context,
+                    parse_error::INVALID_ESCAPE_SEQUENCE);
+            }
+            break;
+
+        // LCOV_EXCL_START
+        case CLOSED:
+            throw std::runtime_error(
+                "[minijson_reader] this line should never be reached, "
+                "please file a bug report");
+        // LCOV_EXCL_STOP
+        }
+    }
+
+    if (state != CLOSED)
+    {
+        throw parse_error(context, parse_error::UNTERMINATED_VALUE);
+    }
+}
+
+// Parses a string enclosed in quotes into a literal of the context.
+// Assumes the opening quote has already been parsed.
+template<typename Context>
+std::string_view parse_string(Context& context)
+{
+    literal_io literal_io(context);
+    decode_string(context, literal_io);
+
+    return literal_io.finalize();
+}
+
+// Writer for decode_string() passing the decoded characters to the sink in
+// chunks, as std::string_view, rather than storing them in the context
+template<typename Sink>
+class chunked_writer final
+{
+public:
+    explicit chunked_writer(Sink& sink) noexcept
+    : m_sink(sink)
+    {
+    }
+
+    void write(const char c)
+    {
+        if (m_size == m_chunk.size())
+        {
+            flush();
+        }
+        m_chunk[m_size++] = c;
+    }
+
+    void flush()
+    {
+        if (m_size > 0)
+        {
+            m_sink(std::string_view(m_chunk.data(), m_size));
+            m_size = 0;
+        }
+    }
+
+private:
+    Sink& m_sink;
+    std::array<char, MJR_STRING_CHUNK_SIZE> m_chunk;
+    std::size_t m_size = 0;
+}; // class chunked_writer
+
+// Type trait to check if T is a specialization of std::optional
+template<typename T> struct is_std_optional
+    : std::false_type {};
+template<typename U> struct is_std_optional<std::optional<U>>
+    : std::true_type {};
+
+// Standard trick to prevent a static_assert() from always going off
+// when it is inside a final "else" of a sequence of "if constexpr" blocks
+template<typename> inline constexpr bool type_dependent_false = false;
+
+} // namespace detail
+
+enum value_type
+{
+    String,
+    Number,
+    Boolean,
+    Object,
+    Array,
+    Null
+};
+
+class bad_value_cast final : public std::invalid_argument
+{
+public:
+    using std::invalid_argument::invalid_argument;
+};
+
+template<typename T, typename Enable = void>
+struct value_as;
+
+class value final
+{
+public:
+    explicit value() noexcept = default;
+
+    explicit value(
+        const value_type type,
+        const std::string_view raw_value = "") noexcept
+    : m_type(type)
+    , m_raw_value(raw_value)
+    {
+    }
+
+    value_type type() const noexcept
+    {
+        return m_type;
+    }
+
+    std::string_view raw() const
+    {
+        return m_raw_value;
+    }
+
+    template<typename T>
+    T as() const
+    {
+        return value_as<T>()(*this);
+    }
+
+    template<typename T>
+    T& to(T& dest) const
+    {
+        dest = as<T>();
+        return dest;
+    }
+
+private:
+    value_type m_type = Null;
+    std::string_view m_raw_value = "null";
+}; // class value
+
+// Fallback behavior of value::as<T>() when no user-provided value_as
+// specialization for T exists.
+// This function is also meant to be called directly by the user in case they
+// need to fall back to the default behavior inside their value_as
+// specialization for T, for whatever reason.
+template<typename T>
+T value_as_default(const value v)
+{
+    if constexpr (detail::is_std_optional<T>())
+    {
+        using U = typename T::value_type;
+        static_assert(
+            !detail::is_std_optional<U>(),
+            "it appears that T is std::optional<std::optional<...>> which is "
+            "unlikely to be what you meant to do");
+
+        if (v.type() == Null)
+        {
+            return std::nullopt;
+        }
+
+        return v.as<U>();
+    }
+    else // not an optional
+    {
+        switch (v.type())
+        {
+        case Null:
+            throw bad_value_cast(
+                "cannot call value::as<T>() on values of type Null: "
+                "consider checking value::type() first, or use "
+                "value::as<std::optional<T>>()");
+
+        case Object:
+            throw bad_value_cast(
+                "cannot call value::as<T>() on values of type Object: "
+                "you have to call parse_object() on the same context");
+
+        case Array:
+            throw bad_value_cast(
+                "cannot call value::as<T>() on values of type Array: "
+                "you have to call parse_array() on the same context");
+
+        case String:
+        case Boolean:
+        case Number:
+            break;
+        }
+
+        const std::string_view raw = v.raw();
+
+        if constexpr (std::is_same_v<T, std::string_view>)
+        {
+            if (v.type() != String)
+            {
+                throw bad_value_cast(
+                    "value::as<T>(): value type is not String");
+            }
+
+            return raw;
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            if (v.type() != Boolean)
+            {
+                throw bad_value_cast(
+                    "value::as<T>(): value type is not Boolean");
+            }
+
+            // If this value comes from parse_object() or parse_array(),
+            // as it should, we know that raw is either "true" or "false".
+            // However, we do a paranoia check for emptiness.
+            return !raw.empty() && raw[0] == 't';
+        }
+        else if constexpr (std::is_arithmetic_v<T>)
+        {
+            if (v.type() != Number)
+            {
+                throw bad_value_cast(
+                    "value::as<T>(): value type is not Number");
+            }
+
+            T result {}; // value initialize to silence compiler warnings
+            const auto begin = raw.data();
+            const auto end = raw.data() + raw.size();
+            const auto [parse_end, error] = std::from_chars(begin, end, result);
+            if (parse_end != end || error != std::errc())
+            {
+                throw std::range_error(
+                    "value::as<T>() could not parse the number");
+            }
+            return result;
+        }
+        else // unsupported type
+        {
+            // We need the predicate of static_assert() to depend on T,
+            // otherwise the assert always goes off.
+            static_assert(
+                detail::type_dependent_false<T>,
+                "value::as<T>(): T is not one of the supported types "
+                "(std::string_view, bool, arithmetic types, plus all of the "
+                "above wrapped in std::optional)");
+        }
+    }
+}
+
+template<typename T, typename Enable>
+struct value_as final
+{
+    T operator()(const value v) const
+    {
+        return value_as_default<T>(v);
+    }
+};
+
+// The two base64 alphabets of RFC 4648: the standard one (with '+' and '/')
+// and the URL and filename safe one (with '-' and '_')
+enum class base64_alphabet
+{
+    Standard,
+    Url
+};
+
+// Upper bound of the number of bytes decoded from length base64 characters
+constexpr std::size_t base64_decoded_size(const std::size_t length) noexcept
+{
+    return (length + 3) / 4 * 3;
+}
+
+namespace detail
+{
+
+// Maps each character to its 6-bit value, or to 0x80 if it is not part of the
+// alphabet
+constexpr std::array<std::uint8_t, 256> make_base64_table(
+    const char c62,
+    const char c63) noexcept
+{
+    std::array<std::uint8_t, 256> table {};
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        table[i] = 0x80;
+    }
+    for (std::uint8_t i = 0; i < 26; ++i)
+    {
+        table['A' + i] = i;
+        table['a' + i] = static_cast<std::uint8_t>(26 + i);
+    }
+    for (std::uint8_t i = 0; i < 10; ++i)
+    {
+        table['0' + i] = static_cast<std::uint8_t>(52 + i);
+    }
+    table[static_cast<unsigned char>(c62)] = 62;
+    table[static_cast<unsigned char>(c63)] = 63;
+
+    return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> base64_table =
+    make_base64_table('+', '/');
+inline constexpr std::array<std::uint8_t, 256> base64url_table =
+    make_base64_table('-', '_');
+
+} // namespace detail
+
+// Incremental base64 decoder, which accepts the encoded text in chunks split
+// at arbitrary positions (e.g. the ones passed by cursor::stream_string()).
+// Padding is optional, but if present it must be correct.
+class base64_decoder final
+{
+public:
+    explicit base64_decoder(
+        const base64_alphabet alphabet = base64_alphabet::Standard) noexcept
+    : m_table(
+        alphabet == base64_alphabet::Standard ?
+            detail::base64_table.data() :
+            detail::base64url_table.data())
+    {
+    }
+
+    // Decodes a chunk, writing the decoded bytes to output, which must have
+    // room for at least base64_decoded_size(chunk.size()) bytes. Returns the
+    // number of bytes written. Throws bad_value_cast if the text is invalid.
+    std::size_t update(const std::string_view chunk, char* const output)
+    {
+        const char* in = chunk.data();
+        const char* const end = in + chunk.size();
+        char* out = output;
+
+        // Fast path: sixteen characters at a time, with a single check for
+        // characters outside the alphabet (including padding)
+        if (m_count == 0 && !m_done)
+        {
+            while (end - in >= 16)
+            {
+                std::uint8_t values[16];
+                std::uint8_t invalid = 0;
+                for (std::size_t i = 0; i < 16; ++i)
+                {
+                    values[i] = m_table[static_cast<unsigned char>(in[i])];
+                    invalid |= values[i];
+                }
+                if (invalid & 0x80)
+                {
+                    break;
+                }
+
+                for (std::size_t i = 0; i < 16; i += 4)
+                {
+                    write_quantum(
+                        out,
+                        static_cast<std::uint32_t>(values[i]) << 18 |
+                        static_cast<std::uint32_t>(values[i + 1]) << 12 |
+                        static_cast<std::uint32_t>(values[i + 2]) << 6 |
+                        values[i + 3],
+                        3);
+                    out += 3;
+                }
+                in += 16;
+            }
+        }
+
+        // Slow path: one character at a time, dealing with padding, errors
+        // and quanta split across chunks
+        for (; in != end; ++in)
+        {
+            push(*in, out);
+        }
+
+        return out - output;
+    }
+
+    // Completes decoding, writing to output the bytes of a final quantum
+    // without padding, if any (at most 2). Returns the number of bytes
+    // written. Throws bad_value_cast if the text is truncated. Afterwards,
+    // the decoder can be reused.
+    std::size_t finish(char* const output)
+    {
+        const bool truncated = m_count == 1 || m_padding > 0;
+        std::size_t size = 0;
+        if (m_count > 0 && !truncated)
+        {
+            // The last quantum is made of 2 or 3 characters, i.e. 1 or 2
+            // bytes, so output need not have room for 3 bytes
+            const std::uint32_t quantum = m_quantum << (6 * (4 - m_count));
+            output[0] = static_cast<char>(quantum >> 16);
+            if (m_count == 3)
+            {
+                output[1] = static_cast<char>(quantum >> 8 & 0xff);
+            }
+            size = m_count - 1;
+        }
+
+        m_quantum = 0;
+        m_count = 0;
+        m_padding = 0;
+        m_done = false;
+
+        if (truncated)
+        {
+            throw bad_value_cast("base64: truncated input");
+        }
+
+        return size;
+    }
+
+private:
+    void push(const char c, char*& out)
+    {
+        if (m_done)
+        {
+            throw bad_value_cast("base64: characters after padding");
+        }
+
+        if (c == '=')
+        {
+            if (m_count < 2)
+            {
+                throw bad_value_cast("base64: misplaced padding");
+            }
+            ++m_padding;
+        }
+        else
+        {
+            const std::uint8_t value = m_table[static_cast<unsigned char>(c)];
+            if (value & 0x80 || m_padding > 0)
+            {
+                throw bad_value_cast("base64: invalid character");
+            }
+            m_quantum = m_quantum << 6 | value;
+        }
+
+        if (++m_count == 4)
+        {
+            m_done = m_padding > 0;
+            out += flush(out, 4 - m_padding);
+        }
+    }
+
+    // Writes the bytes of the current quantum, made of count characters
+    // other than padding, and starts a new one
+    std::size_t flush(char* const out, const std::size_t count) noexcept
+    {
+        const std::size_t size = count - 1;
+        write_quantum(out, m_quantum << (6 * (4 - count)), size);
+        m_quantum = 0;
+        m_count = 0;
+        m_padding = 0;
+
+        return size;
+    }
+
+    static void write_quantum(
+        char* const out,
+        const std::uint32_t quantum,
+        const std::size_t size) noexcept
+    {
+        out[0] = static_cast<char>(quantum >> 16);
+        if (size > 1)
+        {
+            out[1] = static_cast<char>(quantum >> 8 & 0xff);
+        }
+        if (size > 2)
+        {
+            out[2] = static_cast<char>(quantum & 0xff);
+        }
+    }
+
+    const std::uint8_t* m_table;
+    std::uint32_t m_quantum = 0;
+    std::size_t m_count = 0; // characters in the quantum, padding included
+    std::size_t m_padding = 0;
+    bool m_done = false; // a padded quantum ends the text
+}; // class base64_decoder
+
+// Decodes base64 text into the buffer, which must have room for at least
+// base64_decoded_size(encoded.size()) bytes, otherwise std::length_error is
+// thrown. Returns the number of bytes written. Throws bad_value_cast if the
+// text is invalid.
+inline std::size_t decode_base64(
+    const std::string_view encoded,
+    char* const output,
+    const std::size_t capacity,
+    const base64_alphabet alphabet = base64_alphabet::Standard)
+{
+    if (capacity < base64_decoded_size(encoded.size()))
+    {
+        throw std::length_error("base64: output buffer too small");
+    }
+
+    base64_decoder decoder(alphabet);
+    const std::size_t size = decoder.update(encoded, output);
+
+    return size + decoder.finish(output + size);
+}
+
+// Like the above, but decodes a String value
+inline std::size_t decode_base64(
+    const value v,
+    char* const output,
+    const std::size_t capacity,
+    const base64_alphabet alphabet = base64_alphabet::Standard)
+{
+    if (v.type() != String)
+    {
+        throw bad_value_cast("decode_base64(): value type is not String");
+    }
+
+    return decode_base64(v.raw(), output, capacity, alphabet);
+}
+
+namespace detail
+{
+
+// Convenience function to consume a verbatim sequence of characters
+// in a value not enclosed in quotes (in practice, Null and Boolean).
+// Returns the value termination character (e.g. ',').
+template<typename Context, std::size_t Size>
+char consume(
+    literal_io<Context>& literal_io,
+    const std::array<char, Size>& sequence)
+{
+    for (const char expected : sequence)
+    {
+        const char read = literal_io.read();
+        if (read == 0)
+        {
+            throw parse_error(
+                literal_io.context(),
+                parse_error::UNTERMINATED_VALUE);
+        }
+        if (read != expected)
+        {
+            throw parse_error(
+                literal_io.context(),
+                parse_error::INVALID_VALUE);
+        }
+        literal_io.write(read);
+    }
+
+    const char read = literal_io.read();
+    if (read == 0)
+    {
+        throw parse_error(
+            literal_io.context(),
+            parse_error::UNTERMINATED_VALUE);
+    }
+    if (!is_value_termination(read))
+    {
+        throw parse_error(
+            literal_io.context(),
+            parse_error::INVALID_VALUE);
+    }
+    return read;
+}
+
+// Parses primitive values that are not enclosed in quotes
+// (i.e. Null, Boolean and Number).
+// Returns the value and its termination character (e.g. ',').
+template<typename Context>
+std::tuple<value, char>
+parse_unquoted_value(Context& context, const char first_char)
+{
+    literal_io literal_io(context);
+
+    char c = first_char;
+
+    // Cover "null", "true" and "false" cases
+    switch (c)
+    {
+    case 'n': // "null"
+        literal_io.write(c);
+        c = consume(literal_io, std::array {'u', 'l', 'l'});
+        return {value(Null, literal_io.finalize()), c};
+
+    case 't': // "true"
+        literal_io.write(c);
+        c = consume(literal_io, std::array {'r', 'u', 'e'});
+        return {value(Boolean, literal_io.finalize()), c};
+
+    case 'f': // "false"
+        literal_io.write(c);
+        c = consume(literal_io, std::array {'a', 'l', 's', 'e'});
+        return {value(Boolean, literal_io.finalize()), c};
+    }
+
+    // We are in the Number case.
+    // Let's check that the number looks OK according to the JSON
+    // specification, but let's not convert it yet
+    // (that happens in value::as<T>() only as required).
+
+    if (is_value_termination(c))
+    {
+        throw parse_error(context, parse_error::EXPECTED_VALUE);
+    }
+
+    enum
+    {
+        SIGN_OR_FIRST_DIGIT,
+        FIRST_DIGIT,
+        AFTER_LEADING_ZERO,
+        INTEGRAL_PART,
+        FRACTIONAL_PART_FIRST_DIGIT,
+        FRACTIONAL_PART,
+        EXPONENT_SIGN_OR_FIRST_DIGIT,
+        EXPONENT_FIRST_DIGIT,
+        EXPONENT,
+    } state = SIGN_OR_FIRST_DIGIT;
+
+    while (true)
+    {
+        if (c == 0)
+        {
+            throw parse_error(context, parse_error::UNTERMINATED_VALUE);
+        }
+        if (is_value_termination(c))
+        {
+            break;
+        }
+
+        switch (state)
+        {
+        case SIGN_OR_FIRST_DIGIT:
+            if (c == '-') // leading plus sign not allowed
+            {
+                state = FIRST_DIGIT;
+                break;
+            }
+            [[fallthrough]];
+        case FIRST_DIGIT:
+            if (c == '0')
+            {
+                // If zero is the first digit, then it must be the ONLY digit
+                // of the integral part
+                state = AFTER_LEADING_ZERO;
+                break;
+            }
+            if (is_digit(c))
+            {
+                state = INTEGRAL_PART;
+                break;
+            }
+            throw parse_error(context, parse_error::INVALID_VALUE);
+
+        case INTEGRAL_PART:
+            if (is_digit(c))
+            {
+                break;
+            }
+            [[fallthrough]];
+        case AFTER_LEADING_ZERO:
+            if (c == '.')
+            {
+                state = FRACTIONAL_PART_FIRST_DIGIT;
+                break;
+            }
+            if (c == 'e' || c == 'E')
+            {
+                state = EXPONENT_SIGN_OR_FIRST_DIGIT;
+                break;
+            }
+            throw parse_error(context, parse_error::INVALID_VALUE);
+
+        case FRACTIONAL_PART:
+            if (c == 'e' || c == 'E')
+            {
+                state = EXPONENT_SIGN_OR_FIRST_DIGIT;
+                break;
+            }
+            [[fallthrough]];
+        case FRACTIONAL_PART_FIRST_DIGIT:
+            if (is_digit(c))
+            {
+                state = FRACTIONAL_PART;
+                break;
+            }
+            throw parse_error(context, parse_error::INVALID_VALUE);
+
+        case EXPONENT_SIGN_OR_FIRST_DIGIT:
+            if (c == '+' || c == '-')
+            {
+                state = EXPONENT_FIRST_DIGIT;
+                break;
+            }
+            [[fallthrough]];
+        case EXPONENT_FIRST_DIGIT:
+        case EXPONENT:
+            if (is_digit(c))
+            {
+                state = EXPONENT;
+                break;
+            }
+            throw parse_error(context, parse_error::INVALID_VALUE);
+        }
 
-    case 'f': // "false"
         literal_io.write(c);
-        c = consume(literal_io, std::array {'a', 'l', 's', 'e'});
-        return {value(Boolean, literal_io.finalize()), c};
+        c = literal_io.read();
+    }
+
+    switch (state)
+    {
+    case AFTER_LEADING_ZERO:
+    case INTEGRAL_PART:
+    case FRACTIONAL_PART:
+    case EXPONENT:
+        break;
+    default:
+        throw parse_error(context, parse_error::INVALID_VALUE);
+    }
+
+    return {value(Number, literal_io.finalize()), c};
+}
+
+// Helper function of parse_object() and parse_array() dealing with the opening
+// bracket/brace of arrays and objects in presence of nesting
+template<typename Context>
+void parse_init(
+    const Context& context,
+    char& c,
+    bool& must_read) noexcept
+{
+    switch (context.nested_status())
+    {
+    case Context::NESTED_STATUS_NONE:
+        must_read = true;
+        break;
+
+    case Context::NESTED_STATUS_OBJECT:
+        c = '{';
+        // Since we are parsing a nested object, we already read an opening
+        // brace. The main loop does not need to read a character from the
+        // input.
+        must_read = false;
+        break;
+
+    case Context::NESTED_STATUS_ARRAY:
+        // Since we are parsing a nested array, we already read an opening
+        // bracket. The main loop does not need to read a character from the
+        // input.
+        c = '[';
+        must_read = false;
+        break;
+    }
+}
+
+// Helper function of parse_object() and parse_array() parsing JSON values.
+// In case the value is a nested Object or Array, returns a placeholder value.
+template<typename Context>
+value parse_value(Context& context, char& c, bool& must_read)
+{
+    switch (c)
+    {
+    case '{':
+        context.begin_nested(Context::NESTED_STATUS_OBJECT);
+        return value(Object);
+
+    case '[':
+        context.begin_nested(Context::NESTED_STATUS_ARRAY);
+        return value(Array);
+
+    case '"':
+        return value(String, parse_string(context));
+
+    default: // Boolean, Null or Number
+        value v;
+        std::tie(v, c) = parse_unquoted_value(context, c);
+        // c contains the character after the value, no need to read again
+        // in the main loop
+        must_read = false;
+        return v;
+    }
+}
+
+} // namespace detail
+
+template<typename Context, typename Handler>
+std::size_t parse_object(Context& context, Handler&& handler)
+{
+    const std::size_t read_offset = context.read_offset();
+
+    const std::size_t nesting_level = context.nesting_level();
+    if (nesting_level > context.nesting_limit())
+    {
+        throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
+    }
+
+    char c = 0;
+    bool must_read = false;
+
+    detail::parse_init(context, c, must_read);
+    context.reset_nested_status();
+
+    enum
+    {
+        OPENING_BRACKET,
+        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
+        FIELD_NAME,
+        COLON,
+        FIELD_VALUE,
+        COMMA_OR_CLOSING_BRACKET,
+        END
+    } state = OPENING_BRACKET;
+
+    std::string_view field_name = "";
+
+    while (state != END)
+    {
+        if (context.nesting_level() != nesting_level)
+        {
+            throw parse_error(
+                context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+        }
+
+        if (must_read)
+        {
+            c = context.read();
+        }
+
+        must_read = true;
+
+        if (detail::is_whitespace(c))
+        {
+            continue;
+        }
+
+        switch (state)
+        {
+        case OPENING_BRACKET:
+            if (c != '{')
+            {
+                throw parse_error(
+                    context, parse_error::EXPECTED_OPENING_BRACKET);
+            }
+            state = FIELD_NAME_OR_CLOSING_BRACKET;
+            break;
+
+        case FIELD_NAME_OR_CLOSING_BRACKET:
+            if (c == '}')
+            {
+                state = END;
+                break;
+            }
+            [[fallthrough]];
+
+        case FIELD_NAME:
+            if (c != '"')
+            {
+                throw parse_error(context, parse_error::EXPECTED_OPENING_QUOTE);
+            }
+            field_name = detail::parse_string(context);
+            state = COLON;
+            break;
+
+        case COLON:
+            if (c != ':')
+            {
+                throw parse_error(context, parse_error::EXPECTED_COLON);
+            }
+            state = FIELD_VALUE;
+            break;
+
+        case FIELD_VALUE:
+            {
+                const value v = detail::parse_value(context, c, must_read);
+
+                // Try calling the handler with the context as the last argument
+                if constexpr (
+                    std::is_invocable_v<
+                        decltype(handler),
+                        decltype(field_name),
+                        decltype(v),
+                        decltype(context)>)
+                {
+                    std::invoke(handler, field_name, v, context);
+                }
+                else
+                {
+                    // Now try again without the context. Generate a compile
+                    // error if it does not work.
+                    std::invoke(handler, field_name, v);
+                }
+            }
+            state = COMMA_OR_CLOSING_BRACKET;
+            break;
+
+        case COMMA_OR_CLOSING_BRACKET:
+            if (c == ',')
+            {
+                state = FIELD_NAME;
+            }
+            else if (c == '}')
+            {
+                state = END;
+            }
+            else
+            {
+                throw parse_error(
+                    context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+            }
+            break;
+
+        // LCOV_EXCL_START
+        case END:
+            throw std::runtime_error(
+                "[minijson_reader] this line should never be reached, "
+                "please file a bug report");
+        // LCOV_EXCL_STOP
+        }
+
+        if (c == 0)
+        {
+            throw std::runtime_error( // LCOV_EXCL_LINE
+                "[minijson_reader] this line should never be reached, "
+                "please file a bug report");
+        }
+    }
+
+    context.end_nested();
+
+    return context.read_offset() - read_offset;
+}
+
+template<typename Context, typename Handler>
+std::size_t parse_array(Context& context, Handler&& handler)
+{
+    const std::size_t read_offset = context.read_offset();
+
+    const std::size_t nesting_level = context.nesting_level();
+    if (nesting_level > context.nesting_limit())
+    {
+        throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
+    }
+
+    char c = 0;
+    bool must_read = false;
+
+    detail::parse_init(context, c, must_read);
+    context.reset_nested_status();
+
+    enum
+    {
+        OPENING_BRACKET,
+        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
+        VALUE,
+        COMMA_OR_CLOSING_BRACKET,
+        END
+    } state = OPENING_BRACKET;
+
+    while (state != END)
+    {
+        if (context.nesting_level() != nesting_level)
+        {
+            throw parse_error(
+                context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+        }
+
+        if (must_read)
+        {
+            c = context.read();
+        }
+
+        must_read = true;
+
+        if (detail::is_whitespace(c))
+        {
+            continue;
+        }
+
+        switch (state)
+        {
+        case OPENING_BRACKET:
+            if (c != '[')
+            {
+                throw parse_error(
+                    context, parse_error::EXPECTED_OPENING_BRACKET);
+            }
+            state = VALUE_OR_CLOSING_BRACKET;
+            break;
+
+        case VALUE_OR_CLOSING_BRACKET:
+            if (c == ']')
+            {
+                state = END;
+                break;
+            }
+            [[fallthrough]];
+
+        case VALUE:
+            {
+                const value v = detail::parse_value(context, c, must_read);
+
+                // Try calling the handler with the context as the last argument
+                if constexpr (
+                    std::is_invocable_v<
+                        decltype(handler),
+                        decltype(v),
+                        decltype(context)>)
+                {
+                    std::invoke(handler, v, context);
+                }
+                else
+                {
+                    // Now try again without the context. Generate a compile
+                    // error if it does not work.
+                    std::invoke(handler, v);
+                }
+            }
+            state = COMMA_OR_CLOSING_BRACKET;
+            break;
+
+        case COMMA_OR_CLOSING_BRACKET:
+            if (c == ',')
+            {
+                state = VALUE;
+            }
+            else if (c == ']')
+            {
+                state = END;
+            }
+            else
+            {
+                throw parse_error(
+                    context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+            }
+            break;
+
+        // LCOV_EXCL_START
+        case END:
+            throw std::runtime_error(
+                "[minijson_reader] this line should never be reached, "
+                "please file a bug report");
+        // LCOV_EXCL_STOP
+        }
+
+        if (c == 0)
+        {
+            throw std::runtime_error( // LCOV_EXCL_LINE
+                "[minijson_reader] this line should never be reached, "
+                "please file a bug report");
+        }
+    }
+
+    context.end_nested();
+
+    return context.read_offset() - read_offset;
+}
+
+namespace detail
+{
+
+// Returns the first character in [begin, end) that is not a digit, or end.
+// Eight characters at a time are checked at once, by means of a SWAR
+// (SIMD Within A Register) technique.
+inline const char* skip_digits(const char* begin, const char* const end)
+{
+    constexpr std::uint64_t high_nibbles = 0xf0f0f0f0f0f0f0f0;
+    constexpr std::uint64_t digit_high_nibbles = 0x3030303030303030;
+    constexpr std::uint64_t sixes = 0x0606060606060606;
+
+    while (end - begin >= 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, begin, sizeof(word));
+
+        // A byte is a digit if its high nibble is 3 (0x30-0x3f), and it stays
+        // so after adding 6 (which would carry for 0x3a-0x3f)
+        const std::uint64_t non_digits =
+            ((word & high_nibbles) ^ digit_high_nibbles) |
+            (((word + sixes) & high_nibbles) ^ digit_high_nibbles);
+        if (non_digits != 0)
+        {
+            break;
+        }
+        begin += 8;
+    }
+
+    while (begin != end && is_digit(*begin))
+    {
+        ++begin;
+    }
+
+    return begin;
+}
+
+// Parses arrays of numbers working directly on the read buffer of a context
+// backed by a buffer
+template<typename Context>
+class buffer_number_parser final
+{
+public:
+    explicit buffer_number_parser(Context& context) noexcept
+    : m_context(context)
+    , m_begin(context.read_buffer() + context.read_offset())
+    , m_end(context.read_buffer() + context.read_buffer_length())
+    , m_current(m_begin)
+    {
+    }
+
+    // Deals with the opening bracket of the outermost array, in the same
+    // way as parse_array()
+    void parse_init()
+    {
+        char c = 0;
+        bool must_read = false;
+        detail::parse_init(m_context, c, must_read);
+        m_context.reset_nested_status();
+
+        if (must_read)
+        {
+            skip_whitespace();
+            if (peek() != '[')
+            {
+                throw fail(parse_error::EXPECTED_OPENING_BRACKET);
+            }
+            ++m_current;
+        }
+    }
+
+    // Parses the elements of an array whose opening bracket was already
+    // consumed, up to its closing bracket included, appending them to result
+    template<typename T>
+    void parse_numbers(std::vector<T>& result)
+    {
+        // A cheap pre-count of the elements, assuming the array is well-formed
+        if (const void* const closing_bracket =
+                std::memchr(m_current, ']', m_end - m_current))
+        {
+            const std::size_t capacity =
+                result.size() + 1 +
+                std::count(
+                    m_current,
+                    static_cast<const char*>(closing_bracket),
+                    ',');
+            if (capacity > result.capacity())
+            {
+                // Keep the growth geometric, as the same vector may be used
+                // for many small arrays
+                result.reserve(std::max(capacity, 2 * result.capacity()));
+            }
+        }
+
+        skip_whitespace();
+        if (peek() == ']')
+        {
+            ++m_current;
+            return;
+        }
+
+        while (true)
+        {
+            result.push_back(parse_number<T>());
+
+            skip_whitespace();
+            if (peek() == ']')
+            {
+                ++m_current;
+                return;
+            }
+            if (peek() != ',')
+            {
+                throw fail(parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+            }
+            ++m_current;
+            skip_whitespace();
+        }
+    }
+
+    // Expects the next value to be an array, and consumes its opening bracket
+    void parse_opening_bracket(const char* const what)
+    {
+        if (peek() != '[')
+        {
+            throw_unexpected_value(what);
+        }
+        ++m_current;
+    }
+
+    void skip_whitespace() noexcept
+    {
+        while (m_current != m_end && is_whitespace(*m_current))
+        {
+            ++m_current;
+        }
+    }
+
+    char peek() const noexcept
+    {
+        return (m_current != m_end) ? *m_current : 0;
+    }
+
+    void consume() noexcept
+    {
+        ++m_current;
+    }
+
+    // Makes the read offset of the context consistent with parse_array(),
+    // which would have read the current character
+    void sync() noexcept
+    {
+        m_context.advance(m_current - m_begin + 1);
+    }
+
+    parse_error fail(const parse_error::error_reason reason) noexcept
+    {
+        sync();
+        return parse_error(m_context, reason);
+    }
+
+    // Consumes the characters read so far, up to the last one
+    void finalize() noexcept
+    {
+        m_context.advance(m_current - m_begin);
+    }
+
+private:
+    // Validates a number according to the JSON specification, and converts it
+    template<typename T>
+    T parse_number()
+    {
+        const char* const number_begin = m_current;
+        if (peek() == '-')
+        {
+            ++m_current;
+        }
+        else if (!is_digit(peek()))
+        {
+            throw_unexpected_value(
+                "parse_number_array(): value type is not Number");
+        }
+
+        if (peek() == '0')
+        {
+            ++m_current; // if zero is the first digit, it must be the only one
+        }
+        else
+        {
+            parse_digits();
+        }
+        if (peek() == '.')
+        {
+            ++m_current;
+            parse_digits();
+        }
+        if (peek() == 'e' || peek() == 'E')
+        {
+            ++m_current;
+            if (peek() == '+' || peek() == '-')
+            {
+                ++m_current;
+            }
+            parse_digits();
+        }
+        if (peek() == 0)
+        {
+            throw fail(parse_error::UNTERMINATED_VALUE);
+        }
+        if (!is_value_termination(*m_current))
+        {
+            throw fail(parse_error::INVALID_VALUE);
+        }
+
+        T number {}; // value initialize to silence compiler warnings
+        const auto [parse_end, error] =
+            std::from_chars(number_begin, m_current, number);
+        if (parse_end != m_current || error != std::errc())
+        {
+            sync();
+            throw std::range_error(
+                "parse_number_array() could not parse the number");
+        }
+        return number;
+    }
+
+    void parse_digits()
+    {
+        if (!is_digit(peek()))
+        {
+            throw fail(
+                (peek() == 0) ?
+                    parse_error::UNTERMINATED_VALUE :
+                    parse_error::INVALID_VALUE);
+        }
+        m_current = skip_digits(m_current + 1, m_end);
+    }
+
+    // Throws the exception for a value that is not of the expected type.
+    // Invalid values are reported as such, like parse_array() would.
+    [[noreturn]] void throw_unexpected_value(const char* const what)
+    {
+        const char c = peek();
+        switch (c)
+        {
+        case 0:
+            throw fail(parse_error::UNTERMINATED_VALUE);
+        case '{':
+        case '[':
+            break;
+        case '"':
+            sync();
+            parse_string(m_context);
+            break;
+        default:
+            if (is_value_termination(c))
+            {
+                throw fail(parse_error::EXPECTED_VALUE);
+            }
+            sync();
+            parse_unquoted_value(m_context, c);
+        }
+        throw bad_value_cast(what);
+    }
+
+    Context& m_context;
+    const char* m_begin;
+    const char* m_end;
+    const char* m_current;
+}; // class buffer_number_parser
+
+} // namespace detail
+
+// Parses an array of numbers, appending them to result. This is much faster
+// than parse_array() for large arrays, especially with buffer_context and
+// const_buffer_context. Returns the number of bytes read.
+template<typename T, typename Context>
+std::size_t parse_number_array(Context& context, std::vector<T>& result)
+{
+    static_assert(
+        std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+        "parse_number_array(): T must be an arithmetic type other than bool");
+
+    if constexpr (std::is_base_of_v<detail::buffer_context_base, Context>)
+    {
+        const std::size_t read_offset = context.read_offset();
+
+        if (context.nesting_level() > context.nesting_limit())
+        {
+            throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
+        }
+
+        detail::buffer_number_parser parser(context);
+        parser.parse_init();
+        parser.parse_numbers(result);
+        parser.finalize();
+        context.end_nested();
+
+        return context.read_offset() - read_offset;
+    }
+    else
+    {
+        return parse_array(
+            context,
+            [&](const value v)
+            {
+                if (v.type() != Number)
+                {
+                    throw bad_value_cast(
+                        "parse_number_array(): value type is not Number");
+                }
+                result.push_back(value_as_default<T>(v));
+            });
+    }
+}
+
+// Numbers parsed by parse_nested_number_array() from arrays nested at a fixed
+// depth, e.g. [[[1, 2], [3, 4]], [[5, 6]]] has depth 3
+template<typename T>
+struct nested_number_array
+{
+    // All the numbers, in the order they appear in the message
+    std::vector<T> values;
+
+    // For each depth d, the elements of the i-th array at depth d are those
+    // from offsets[d][i] (included) to offsets[d][i + 1] (excluded) among
+    // the arrays at depth d + 1 or, for the deepest arrays, in values
+    std::vector<std::vector<std::size_t>> offsets;
+
+    // If all the arrays at each depth have the same length, those lengths;
+    // otherwise, empty
+    std::vector<std::size_t> shape;
+};
+
+namespace detail
+{
+
+inline constexpr const char* NOT_AN_ARRAY =
+    "parse_nested_number_array(): value type is not Array";
+
+// Implementation of parse_nested_number_array() for contexts backed by a
+// buffer, which works directly on the read buffer without any recursion
+template<typename T, typename Context>
+void parse_nested_number_array_buffer(
+    Context& context,
+    const std::size_t depth,
+    nested_number_array<T>& result)
+{
+    const std::size_t nesting_level = context.nesting_level();
+
+    buffer_number_parser parser(context);
+    parser.parse_init();
+
+    std::size_t level = 0;
+    bool opened = true; // whether we just read the opening bracket of an array
+    while (true)
+    {
+        if (opened)
+        {
+            if (nesting_level + level > context.nesting_limit())
+            {
+                throw parser.fail(parse_error::EXCEEDED_NESTING_LIMIT);
+            }
+
+            if (level + 1 == depth)
+            {
+                result.offsets[level].push_back(result.values.size());
+                parser.parse_numbers(result.values);
+                opened = false;
+                continue;
+            }
+
+            result.offsets[level].push_back(result.offsets[level + 1].size());
+            parser.skip_whitespace();
+            if (parser.peek() == ']')
+            {
+                parser.consume();
+                opened = false;
+                continue;
+            }
+            parser.parse_opening_bracket(NOT_AN_ARRAY);
+            ++level;
+            continue;
+        }
+
+        // We just read the closing bracket of an array
+        if (level == 0)
+        {
+            break;
+        }
+        --level;
+
+        parser.skip_whitespace();
+        if (parser.peek() == ',')
+        {
+            parser.consume();
+            parser.skip_whitespace();
+            parser.parse_opening_bracket(NOT_AN_ARRAY);
+            ++level;
+            opened = true;
+        }
+        else if (parser.peek() == ']')
+        {
+            parser.consume();
+        }
+        else
+        {
+            throw parser.fail(parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+        }
+    }
+
+    parser.finalize();
+}
+
+// Implementation of parse_nested_number_array() for any other context
+template<typename T, typename Context>
+void parse_nested_number_array_generic(
+    Context& context,
+    const std::size_t level,
+    const std::size_t depth,
+    nested_number_array<T>& result)
+{
+    if (level + 1 == depth)
+    {
+        result.offsets[level].push_back(result.values.size());
+        parse_number_array(context, result.values);
+        return;
+    }
+
+    result.offsets[level].push_back(result.offsets[level + 1].size());
+    parse_array(
+        context,
+        [&](const value v)
+        {
+            if (v.type() != Array)
+            {
+                throw bad_value_cast(NOT_AN_ARRAY);
+            }
+            parse_nested_number_array_generic(
+                context,
+                level + 1,
+                depth,
+                result);
+        });
+}
+
+} // namespace detail
+
+// Parses an array containing arrays of numbers, nested at the given depth,
+// into result. If require_rectangular is true, all the arrays at each depth
+// must have the same length. Returns the number of bytes read.
+template<typename T, typename Context>
+std::size_t parse_nested_number_array(
+    Context& context,
+    const std::size_t depth,
+    nested_number_array<T>& result,
+    const bool require_rectangular = false)
+{
+    static_assert(
+        std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+        "parse_nested_number_array(): T must be an arithmetic type other "
+        "than bool");
+
+    if (depth == 0)
+    {
+        throw std::invalid_argument(
+            "parse_nested_number_array(): depth must be at least 1");
+    }
+
+    const std::size_t read_offset = context.read_offset();
+
+    result.values.clear();
+    result.offsets.resize(depth);
+    for (std::vector<std::size_t>& offsets : result.offsets)
+    {
+        offsets.clear();
+    }
+    result.shape.clear();
+
+    if constexpr (std::is_base_of_v<detail::buffer_context_base, Context>)
+    {
+        if (context.nesting_level() > context.nesting_limit())
+        {
+            throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
+        }
+
+        detail::parse_nested_number_array_buffer(context, depth, result);
+        context.end_nested();
+    }
+    else
+    {
+        detail::parse_nested_number_array_generic(context, 0, depth, result);
+    }
+
+    // Terminate the offsets, and work out the shape
+    bool rectangular = true;
+    for (std::size_t level = 0; level < depth; ++level)
+    {
+        std::vector<std::size_t>& offsets = result.offsets[level];
+        offsets.push_back(
+            (level + 1 < depth) ?
+                result.offsets[level + 1].size() :
+                result.values.size());
+
+        const std::size_t length =
+            (offsets.size() > 1) ? offsets[1] - offsets[0] : 0;
+        for (std::size_t i = 1; i < offsets.size() && rectangular; ++i)
+        {
+            rectangular = (offsets[i] - offsets[i - 1] == length);
+        }
+        result.shape.push_back(length);
+    }
+
+    if (!rectangular)
+    {
+        result.shape.clear();
+        if (require_rectangular)
+        {
+            throw bad_value_cast(
+                "parse_nested_number_array(): array is not rectangular");
+        }
+    }
+
+    return context.read_offset() - read_offset;
+}
+
+namespace detail
+{
+
+// Stack of the objects and arrays enclosing the current position, used by
+// the parsers that handle nesting without recursion
+class nesting_stack final
+{
+public:
+    bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    // Tells whether the innermost enclosing value is an object (as opposed
+    // to an array). Must not be called on an empty stack.
+    bool in_object() const noexcept
+    {
+        return is_object(m_size - 1);
+    }
+
+    // Allocates memory only when growing deeper than the default nesting
+    // limit allows
+    void push(const bool is_object)
+    {
+        if (m_size < m_is_object.size())
+        {
+            m_is_object[m_size] = is_object;
+        }
+        else
+        {
+            m_overflow.push_back(is_object);
+        }
+        ++m_size;
+    }
+
+    void pop() noexcept
+    {
+        --m_size;
+        if (m_size >= m_is_object.size())
+        {
+            m_overflow.pop_back();
+        }
+    }
+
+private:
+    bool is_object(const std::size_t index) const noexcept
+    {
+        return (index < m_is_object.size()) ?
+            m_is_object[index] :
+            m_overflow[index - m_is_object.size()];
+    }
+
+    std::bitset<MJR_NESTING_LIMIT + 1> m_is_object;
+    std::vector<bool> m_overflow;
+    std::size_t m_size = 0;
+}; // class nesting_stack
+
+} // namespace detail
+
+// Tokens returned by cursor::next() and cursor::peek_type()
+enum token_type
+{
+    BeginObject,
+    EndObject,
+    BeginArray,
+    EndArray,
+    FieldName,
+    Scalar,
+    EndOfInput
+};
+
+// Pull-style reader of a JSON object or array, which hands out one token at a
+// time as requested by the caller. Nesting is tracked by means of an explicit
+// stack rather than recursion.
+template<typename Context>
+class cursor final
+{
+public:
+    explicit cursor(Context& context) noexcept
+    : m_context(context)
+    , m_nesting_level(context.nesting_level())
+    {
+        detail::parse_init(m_context, m_c, m_must_read);
+        m_context.reset_nested_status();
+    }
+
+    cursor(const cursor&) = delete;
+    cursor(cursor&&) = delete;
+    cursor& operator=(const cursor&) = delete;
+    cursor& operator=(cursor&&) = delete;
+
+    // Reads the next token. Returns EndOfInput once the outermost object or
+    // array has been closed.
+    token_type next()
+    {
+        const token_type type = peek_type();
+        m_peeked = false;
+        consume(type);
+        return type;
+    }
+
+    // Tells what the next call to next() will return, reading no further
+    // than the first character of the next token
+    token_type peek_type()
+    {
+        if (!m_peeked)
+        {
+            m_peeked_type = advance();
+            m_peeked = true;
+        }
+        return m_peeked_type;
+    }
+
+    // Skips the next value, be it a Scalar or a whole object or array. If the
+    // next token is a FieldName, skips both the field name and its value.
+    // Does nothing if the next token closes an object or array.
+    void skip()
+    {
+        if (peek_type() == FieldName)
+        {
+            next();
+        }
+
+        switch (peek_type())
+        {
+        case BeginObject:
+        case BeginArray:
+            {
+                const std::size_t depth = m_stack.size();
+                next();
+                while (m_stack.size() > depth)
+                {
+                    next();
+                }
+            }
+            break;
+
+        case Scalar:
+            next();
+            break;
+
+        case EndObject:
+        case EndArray:
+        case EndOfInput:
+        case FieldName: // unreachable: a field name is followed by a value
+            break;
+        }
+    }
+
+    // The value read by the last call to next() which returned Scalar,
+    // BeginObject or BeginArray (for the latter two, only the type is set)
+    value get_value() const noexcept
+    {
+        return m_value;
+    }
+
+    // The name of the field read by the last call to next() which returned
+    // FieldName
+    std::string_view field_name() const noexcept
+    {
+        return m_field_name;
+    }
+
+    // Number of objects and arrays enclosing the current position
+    std::size_t depth() const noexcept
+    {
+        return m_stack.size();
+    }
+
+    // If the next token is a string value, consumes it by decoding it and
+    // passing it to sink(std::string_view) in chunks of at most
+    // MJR_STRING_CHUNK_SIZE characters, without storing it in the context,
+    // and returns true. Otherwise, returns false and consumes nothing.
+    template<typename Sink>
+    bool stream_string(Sink&& sink)
+    {
+        if (peek_type() != Scalar || m_c != '"')
+        {
+            return false;
+        }
+
+        m_peeked = false;
+        detail::chunked_writer writer(sink);
+        detail::decode_string(m_context, writer);
+        writer.flush();
+        m_state = COMMA_OR_CLOSING_BRACKET;
+
+        return true;
+    }
+
+private:
+    enum state
+    {
+        OPENING_BRACKET,
+        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
+        FIELD_NAME,
+        COLON,
+        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
+        VALUE,
+        COMMA_OR_CLOSING_BRACKET,
+        END
+    };
+
+    // Reads up to the first character of the next token, and tells what
+    // kind of token it is
+    token_type advance()
+    {
+        while (m_state != END)
+        {
+            if (m_must_read)
+            {
+                m_c = m_context.read();
+            }
+
+            m_must_read = true;
+
+            if (detail::is_whitespace(m_c))
+            {
+                continue;
+            }
+
+            switch (m_state)
+            {
+            case OPENING_BRACKET:
+                if (m_c == '{')
+                {
+                    return BeginObject;
+                }
+                if (m_c == '[')
+                {
+                    return BeginArray;
+                }
+                throw parse_error(
+                    m_context, parse_error::EXPECTED_OPENING_BRACKET);
+
+            case FIELD_NAME_OR_CLOSING_BRACKET:
+                if (m_c == '}')
+                {
+                    return EndObject;
+                }
+                [[fallthrough]];
+
+            case FIELD_NAME:
+                if (m_c != '"')
+                {
+                    throw parse_error(
+                        m_context, parse_error::EXPECTED_OPENING_QUOTE);
+                }
+                return FieldName;
+
+            case COLON:
+                if (m_c != ':')
+                {
+                    throw parse_error(m_context, parse_error::EXPECTED_COLON);
+                }
+                m_state = VALUE;
+                break;
+
+            case VALUE_OR_CLOSING_BRACKET:
+                if (m_c == ']')
+                {
+                    return EndArray;
+                }
+                [[fallthrough]];
+
+            case VALUE:
+                switch (m_c)
+                {
+                case '{':
+                    return BeginObject;
+                case '[':
+                    return BeginArray;
+                default:
+                    return Scalar;
+                }
+
+            case COMMA_OR_CLOSING_BRACKET:
+                if (m_c == ',')
+                {
+                    m_state = m_stack.in_object() ? FIELD_NAME : VALUE;
+                    break;
+                }
+                if (m_c == (m_stack.in_object() ? '}' : ']'))
+                {
+                    return m_stack.in_object() ? EndObject : EndArray;
+                }
+                throw parse_error(
+                    m_context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+
+            // LCOV_EXCL_START
+            case END:
+                throw std::runtime_error(
+                    "[minijson_reader] this line should never be reached, "
+                    "please file a bug report");
+            // LCOV_EXCL_STOP
+            }
+        }
+
+        return EndOfInput;
+    }
+
+    // Consumes the token whose first character has been read by advance()
+    void consume(const token_type type)
+    {
+        switch (type)
+        {
+        case BeginObject:
+        case BeginArray:
+            if (m_nesting_level + m_stack.size() > m_context.nesting_limit())
+            {
+                throw parse_error(
+                    m_context, parse_error::EXCEEDED_NESTING_LIMIT);
+            }
+            if (type == BeginObject)
+            {
+                m_stack.push(true);
+                m_value = value(Object);
+                m_state = FIELD_NAME_OR_CLOSING_BRACKET;
+            }
+            else
+            {
+                m_stack.push(false);
+                m_value = value(Array);
+                m_state = VALUE_OR_CLOSING_BRACKET;
+            }
+            break;
+
+        case EndObject:
+        case EndArray:
+            m_stack.pop();
+            if (m_stack.empty())
+            {
+                m_context.end_nested();
+                m_state = END;
+            }
+            else
+            {
+                m_state = COMMA_OR_CLOSING_BRACKET;
+            }
+            break;
+
+        case FieldName:
+            m_field_name = detail::parse_string(m_context);
+            m_state = COLON;
+            break;
+
+        case Scalar:
+            if (m_c == '"')
+            {
+                m_value = value(String, detail::parse_string(m_context));
+            }
+            else // Boolean, Null or Number
+            {
+                std::tie(m_value, m_c) =
+                    detail::parse_unquoted_value(m_context, m_c);
+                // m_c contains the character after the value, no need to
+                // read again in advance()
+                m_must_read = false;
+            }
+            m_state = COMMA_OR_CLOSING_BRACKET;
+            break;
+
+        case EndOfInput:
+            break;
+        }
+    }
+
+    Context& m_context;
+    const std::size_t m_nesting_level;
+    detail::nesting_stack m_stack;
+    state m_state = OPENING_BRACKET;
+    char m_c = 0;
+    bool m_must_read = false;
+    bool m_peeked = false;
+    token_type m_peeked_type = EndOfInput;
+    std::string_view m_field_name;
+    value m_value;
+}; // class cursor
+
+// Parses a JSON object or array in a single loop, without recursion,
+// reporting its contents to the handler as a flat sequence of events
+template<typename Context, typename Handler>
+std::size_t parse_events(Context& context, Handler&& handler)
+{
+    const std::size_t read_offset = context.read_offset();
+
+    cursor<Context> reader(context);
+
+    while (true)
+    {
+        switch (reader.next())
+        {
+        case BeginObject:
+            handler.start_object();
+            break;
+
+        case EndObject:
+            handler.end_object();
+            break;
+
+        case BeginArray:
+            handler.start_array();
+            break;
+
+        case EndArray:
+            handler.end_array();
+            break;
+
+        case FieldName:
+            handler.key(reader.field_name());
+            break;
+
+        case Scalar:
+            {
+                const value v = reader.get_value();
+                switch (v.type())
+                {
+                case String:
+                    handler.string(v.raw());
+                    break;
+                case Number:
+                    handler.number(v);
+                    break;
+                case Boolean:
+                    handler.boolean(v.as<bool>());
+                    break;
+                case Null:
+                    handler.null();
+                    break;
+                // LCOV_EXCL_START
+                case Object:
+                case Array:
+                    throw std::runtime_error(
+                        "[minijson_reader] this line should never be "
+                        "reached, please file a bug report");
+                // LCOV_EXCL_STOP
+                }
+            }
+            break;
+
+        case EndOfInput:
+            return context.read_offset() - read_offset;
+        }
+    }
+}
+
+namespace detail
+{
+
+// Context adapter reading from the wrapped context, but discarding all the
+// literals instead of writing them. It is used to skip nested objects and
+// arrays while leaving the write buffer of the wrapped context untouched.
+template<typename Context>
+class skip_context final : public context_base
+{
+public:
+    explicit skip_context(Context& context) noexcept
+    : m_context(context)
+    {
+        copy_nesting(context);
+    }
+
+    skip_context(const skip_context&) = delete;
+    skip_context(skip_context&&) = delete;
+    skip_context& operator=(const skip_context&) = delete;
+    skip_context& operator=(skip_context&&) = delete;
+
+    char read() noexcept(noexcept(m_context.read()))
+    {
+        return m_context.read();
+    }
+
+    std::size_t read_offset() const noexcept
+    {
+        return m_context.read_offset();
+    }
+
+    void begin_literal() noexcept
+    {
+    }
+
+    void write(char) noexcept
+    {
+    }
+
+    const char* current_literal() const noexcept
+    {
+        return nullptr;
+    }
+
+    std::size_t current_literal_length() const noexcept
+    {
+        return 0;
+    }
+
+private:
+    Context& m_context;
+}; // class skip_context
+
+// Parses and discards the nested object or array the context is positioned
+// on, without writing any literals and without recursion
+template<typename Context>
+void skip_nested(Context& context)
+{
+    skip_context<Context> skip(context);
+    cursor<skip_context<Context>>(skip).skip();
+
+    context.reset_nested_status();
+    context.end_nested();
+}
+
+template<typename Context>
+class ignore final
+{
+public:
+    explicit ignore(Context& context) noexcept
+    : m_context(context)
+    {
+    }
+
+    ignore(const ignore&) = delete;
+    ignore(ignore&&) = delete;
+    ignore& operator=(const ignore&) = delete;
+    ignore& operator=(ignore&&) = delete;
+
+    void operator()(std::string_view, value) const
+    {
+        (*this)();
+    }
+
+    void operator()(value) const
+    {
+        (*this)();
+    }
+
+    void operator()() const
+    {
+        if (m_context.nested_status() != Context::NESTED_STATUS_NONE)
+        {
+            skip_nested(m_context);
+        }
+    }
+
+private:
+    Context& m_context;
+}; // class ignore
+
+// Base for unhandled_field_error and missing_field_error
+class dispatcher_error_base : public std::exception
+{
+public:
+    explicit dispatcher_error_base(const std::string_view field_name) noexcept
+    : m_field_name_truncated_length(
+        std::min(MAX_FIELD_NAME_LENGTH, field_name.size()))
+    {
+        std::copy_n(
+            field_name.begin(),
+            m_field_name_truncated_length,
+            m_field_name_truncated.begin());
+    }
+
+    std::string_view field_name_truncated() const noexcept
+    {
+        return {m_field_name_truncated.data(), m_field_name_truncated_length};
+    }
+
+    inline static constexpr std::size_t MAX_FIELD_NAME_LENGTH = 55;
+
+private:
+    // The temptation of storing a the field name here as a std::string_view
+    // is almost irresistible, but it would tie the validity of this exception
+    // to that of the dispatcher or, even worse, the parsing context
+    std::size_t m_field_name_truncated_length = 0;
+    std::array<char, MAX_FIELD_NAME_LENGTH + 1> m_field_name_truncated {};
+}; // class dispatcher_error_base
+
+} // namespace detail
+
+template<typename Context>
+void ignore(Context& context)
+{
+    detail::ignore<Context> ignore(context);
+    ignore();
+}
+
+// Skips the nested object or array the context is positioned on and returns
+// its exact original bytes in the input buffer, brackets included
+template<typename Context>
+std::string_view capture(Context& context)
+{
+    static_assert(
+        std::is_base_of_v<detail::buffer_context_base, Context>,
+        "capture() is only available for buffer_context and "
+        "const_buffer_context");
+
+    if (context.nested_status() == Context::NESTED_STATUS_NONE)
+    {
+        return {};
+    }
+
+    // The opening bracket is the last character we read
+    const std::size_t begin = context.read_offset() - 1;
+
+    detail::skip_nested(context);
+
+    return {
+        context.read_buffer() + begin,
+        context.read_offset() - begin};
+}
+
+// A nested object or array captured by defer(), which can be parsed later
+// (possibly on another thread) by means of a const_buffer_context
+class deferred_value final
+{
+public:
+    explicit deferred_value() noexcept = default;
+
+    explicit deferred_value(
+        const value_type type,
+        const std::string_view raw,
+        const std::size_t nesting_level,
+        const std::size_t nesting_limit = MJR_NESTING_LIMIT,
+        const bool validate_utf8 = MJR_VALIDATE_UTF8) noexcept
+    : m_type(type)
+    , m_raw(raw)
+    , m_nesting_level(nesting_level)
+    , m_nesting_limit(nesting_limit)
+    , m_validate_utf8(validate_utf8)
+    {
+    }
+
+    value_type type() const noexcept
+    {
+        return m_type;
+    }
+
+    std::string_view raw() const noexcept
+    {
+        return m_raw;
+    }
+
+    std::size_t nesting_level() const noexcept
+    {
+        return m_nesting_level;
+    }
+
+    std::size_t nesting_limit() const noexcept
+    {
+        return m_nesting_limit;
+    }
+
+    bool validate_utf8() const noexcept
+    {
+        return m_validate_utf8;
+    }
+
+private:
+    value_type m_type = Null;
+    std::string_view m_raw;
+    std::size_t m_nesting_level = 0;
+    std::size_t m_nesting_limit = MJR_NESTING_LIMIT;
+    bool m_validate_utf8 = MJR_VALIDATE_UTF8;
+}; // class deferred_value
+
+inline const_buffer_context::const_buffer_context(
+    const deferred_value& deferred)
+: detail::buffer_context_base(
+    deferred.raw().data(),
+    new char[deferred.raw().size()],
+    deferred.raw().size(),
+    deferred.nesting_level())
+, m_capacity(deferred.raw().size())
+{
+    set_nesting_limit(deferred.nesting_limit());
+    set_validate_utf8(deferred.validate_utf8());
+}
+
+// Skips the nested object or array the context is positioned on and returns
+// it as a self-contained work item. Only const_buffer_context is supported,
+// since a buffer_context overwrites its input with literals as it parses.
+template<typename Context>
+deferred_value defer(Context& context)
+{
+    static_assert(
+        std::is_same_v<Context, const_buffer_context>,
+        "defer() requires a const_buffer_context: the input of a "
+        "buffer_context is overwritten as parsing resumes");
+
+    const auto nested_status = context.nested_status();
+    if (nested_status == Context::NESTED_STATUS_NONE)
+    {
+        return deferred_value();
+    }
+
+    const value_type type =
+        (nested_status == Context::NESTED_STATUS_OBJECT) ? Object : Array;
+    const std::size_t nesting_level = context.nesting_level();
+    const std::string_view raw = capture(context);
+
+    return deferred_value(
+        type,
+        raw,
+        nesting_level,
+        context.nesting_limit(),
+        context.validate_utf8());
+}
+
+namespace handlers
+{
+
+namespace detail
+{
+
+// Tags to declare handler traits
+struct handler_tag {};
+struct field_specific_handler_tag {};
+struct required_field_handler_tag {};
+struct ignore_handler_tag {};
+
+// Base class for field-specific handlers
+template<typename Functor, typename... Tag>
+class field_specific_handler_base
+    : public handler_tag
+    , public field_specific_handler_tag
+    , public Tag...
+{
+public:
+    explicit field_specific_handler_base(
+        const std::string_view field_name,
+        Functor functor)
+    : m_field_name(field_name)
+    , m_functor(std::move(functor))
+    {
+    }
+
+    std::string_view field_name() const noexcept
+    {
+        return m_field_name;
+    }
+
+    const Functor& functor() const noexcept
+    {
+        return m_functor;
+    }
+
+    template<typename Context, typename... Target>
+    bool operator()(
+        const std::string_view parsed_field_name,
+        const value value,
+        Context& context,
+        Target&... target) const
+    {
+        if (parsed_field_name != m_field_name)
+        {
+            return false;
+        }
+
+        // Try calling the functor with the context as the last argument
+        if constexpr (
+            std::is_invocable_v<
+                decltype(m_functor),
+                decltype(target)...,
+                decltype(value),
+                decltype(context)>)
+        {
+            std::invoke(m_functor, target..., value, context);
+        }
+        else
+        {
+            // Now try again without the context. Generate a compile error if
+            // it does not work.
+            std::invoke(m_functor, target..., value);
+        }
+
+        return true;
+    }
+
+private:
+    std::string_view m_field_name;
+    Functor m_functor;
+}; // class field_specific_handler_base
+
+// Base class for non-field-specific handlers
+template<typename Functor, typename... Tag>
+class any_handler_base : public handler_tag, public Tag...
+{
+public:
+    any_handler_base(Functor functor)
+    : m_functor(std::move(functor))
+    {
+    }
+
+    const Functor& functor() const noexcept
+    {
+        return m_functor;
+    }
+
+    template<typename Context, typename... Target>
+    bool operator()(
+        const std::string_view parsed_field_name,
+        const value value,
+        Context& context,
+        Target&... target) const
+    {
+        // Try calling the functor with the context as the last argument
+        if constexpr (
+            std::is_invocable_v<
+                decltype(m_functor),
+                decltype(target)...,
+                decltype(parsed_field_name),
+                decltype(value),
+                decltype(context)>)
+        {
+            return std::invoke(
+                m_functor,
+                target...,
+                parsed_field_name,
+                value,
+                context);
+        }
+        else
+        {
+            // Now try again without the context. Generate a compile error if
+            // it does not work.
+            return std::invoke(m_functor, target..., parsed_field_name, value);
+        }
+    }
+
+private:
+    Functor m_functor;
+}; // class any_handler_base
+
+// Functor for all handlers which ignore the field
+struct ignore_functor final
+{
+    template<typename... Args>
+    bool operator()(Args&&... args) const
+    {
+        // The context is the last argument we are being passed, extract it
+        const auto args_tuple =
+            std::forward_as_tuple(std::forward<Args>(args)...);
+        auto& context = std::get<sizeof...(args) - 1>(args_tuple);
+
+        // Call ignore to discard the current value
+        ignore(context);
+
+        return true;
+    }
+}; // struct ignore_functor
+
+} // namespace handlers::detail
+
+template<typename Functor>
+class handler final
+    : public detail::field_specific_handler_base<
+        Functor,
+        detail::required_field_handler_tag>
+{
+public:
+    handler(const std::string_view field_name, Functor functor)
+    : detail::field_specific_handler_base<
+        Functor,
+        detail::required_field_handler_tag>(
+            field_name,
+            std::move(functor))
+    {
+    }
+}; // class handler
+
+template<typename Functor>
+class optional_handler final
+    : public detail::field_specific_handler_base<Functor>
+{
+public:
+    optional_handler(const std::string_view field_name, Functor functor)
+    : detail::field_specific_handler_base<Functor>(
+        field_name,
+        std::move(functor))
+    {
+    }
+}; // class optional_handler
+
+template<typename Functor>
+class any_handler final : public detail::any_handler_base<Functor>
+{
+public:
+    any_handler(Functor functor)
+    : detail::any_handler_base<Functor>(std::move(functor))
+    {
+    }
+}; // class any_handler
+
+class ignore_handler final
+    : public detail::field_specific_handler_base<
+        detail::ignore_functor,
+        detail::ignore_handler_tag>
+{
+public:
+    ignore_handler(const std::string_view field_name)
+    : detail::field_specific_handler_base<
+        detail::ignore_functor,
+        detail::ignore_handler_tag>(
+            field_name,
+            detail::ignore_functor())
+    {
+    }
+}; // class ignore_handler
+
+class ignore_any_handler final
+    : public detail::any_handler_base<
+        detail::ignore_functor,
+        detail::ignore_handler_tag>
+{
+public:
+    ignore_any_handler()
+    : detail::any_handler_base<
+        detail::ignore_functor,
+        detail::ignore_handler_tag>(
+            detail::ignore_functor())
+    {
+    }
+}; // class ignore_any_handler
+
+template<typename Handler, typename Enable = void>
+struct traits;
+
+template<typename Handler>
+struct traits<
+    Handler,
+    std::enable_if_t<
+        std::is_base_of_v<
+            detail::handler_tag,
+            std::remove_reference_t<Handler>>>> final
+{
+    static inline constexpr bool is_field_specific =
+        std::is_base_of_v<
+            detail::field_specific_handler_tag,
+            std::remove_reference_t<Handler>>;
+
+    static inline constexpr bool is_required_field =
+        std::is_base_of_v<
+            detail::required_field_handler_tag,
+            std::remove_reference_t<Handler>>;
+
+    static inline constexpr bool is_ignore =
+        std::is_base_of_v<
+            detail::ignore_handler_tag,
+            std::remove_reference_t<Handler>>;
+};
+
+} // namespace handlers
+
+class unhandled_field_error final : public detail::dispatcher_error_base
+{
+public:
+    using detail::dispatcher_error_base::dispatcher_error_base;
+
+    virtual const char* what() const noexcept override
+    {
+        return "a JSON field was not handled";
+    }
+}; // class unhandled_field_error
+
+class missing_field_error final : public detail::dispatcher_error_base
+{
+public:
+    using detail::dispatcher_error_base::dispatcher_error_base;
+
+    virtual const char* what() const noexcept override
+    {
+        return "at least one required JSON field is missing";
+    }
+}; // class missing_field_error
+
+template<typename Dispatcher, typename... Target>
+class dispatcher_run final
+{
+public:
+    dispatcher_run(Dispatcher& dispatcher, Target&... target) noexcept
+    : m_dispatcher(dispatcher)
+    , m_targets(target...)
+    {
+    }
+
+    dispatcher_run(const dispatcher_run&) = delete;
+    dispatcher_run(dispatcher_run&&) = default;
+    dispatcher_run& operator=(const dispatcher_run&) = delete;
+    dispatcher_run& operator=(dispatcher_run&&) = delete;
+
+    template<typename Context>
+    void operator()(
+        const std::string_view parsed_field_name,
+        const value value,
+        Context& context)
+    {
+        // AFAIK, in pre-C++20 we are forced to resort to a helper function
+        // rather than use a template lambda which would be more readable
+        call_helper(
+            parsed_field_name,
+            value,
+            context,
+            std::make_index_sequence<Dispatcher::n_handlers>());
+    }
+
+    template<typename Inspector>
+    void inspect(Inspector&& inspector) const
+    {
+        // AFAIK, in pre-C++20 we are forced to resort to a helper function
+        // rather than use a template lambda which would be more readable
+        inspect_helper(
+            inspector,
+            std::make_index_sequence<Dispatcher::n_handlers>());
+    }
+
+    void enforce_required() const
+    {
+        inspect(
+            [](const auto& handler, const std::size_t handle_count)
+            {
+                if constexpr (
+                    handlers::traits<decltype(handler)>::is_required_field)
+                {
+                    if (handle_count == 0)
+                    {
+                        throw missing_field_error(handler.field_name());
+                    }
+                }
+            });
+    }
+
+private:
+    // Helper of operator()() to get a sequence of indices
+    template<typename Context, std::size_t... I>
+    void call_helper(
+        const std::string_view parsed_field_name,
+        const value value,
+        Context& context,
+        std::index_sequence<I...>)
+    {
+        if (!(... || offer_to_handler<I>(parsed_field_name, value, context)))
+        {
+            throw unhandled_field_error(parsed_field_name);
+        }
+    }
+
+    template<typename Inspector, std::size_t... I>
+    void inspect_helper(Inspector& inspector, std::index_sequence<I...>) const
+    {
+        (..., std::invoke(
+            inspector,
+            std::get<I>(m_dispatcher.handlers()),
+            std::get<I>(m_handle_count)));
+    }
+
+    // Offer this field to the I-th handler of the dispatcher.
+    // If the handler chooses to handle it, then increment the I-th
+    // m_handle_count entry and return true. Otherwise, return false.
+    template<std::size_t I, typename Context>
+    bool offer_to_handler(
+        const std::string_view parsed_field_name,
+        const value value,
+        Context& context)
+    {
+        std::size_t& handle_count = std::get<I>(m_handle_count);
+        auto& handler = std::get<I>(m_dispatcher.handlers());
+
+        return std::apply(
+            [&](auto&... target)
+            {
+                if (handler(parsed_field_name, value, context, target...))
+                {
+                    ++handle_count;
+                    return true;
+                }
+                return false;
+            },
+            m_targets);
+    }
+
+    Dispatcher& m_dispatcher;
+    std::tuple<Target&...> m_targets;
+
+    // Tracks how many times the i-th handler decided to handle a field
+    std::array<std::size_t, Dispatcher::n_handlers> m_handle_count {};
+}; // class dispatcher_run
+
+template<typename... Handler>
+class dispatcher final
+{
+public:
+    dispatcher(Handler... handler)
+    : m_handlers {std::move(handler)...}
+    {
+    }
+
+    template<typename Context, typename... Target>
+    void run(Context& context, Target&... target) const
+    {
+        dispatcher_run run(*this, target...);
+        minijson::parse_object(context, run);
+        run.enforce_required();
+    }
+
+    const std::tuple<Handler...>& handlers() const noexcept
+    {
+        return m_handlers;
+    }
+
+    inline static constexpr std::size_t n_handlers = sizeof...(Handler);
+
+private:
+    std::tuple<Handler...> m_handlers;
+}; // class dispatcher
+
+// Thrown when a serialized tape cannot be loaded
+class tape_error final : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Compact, immutable representation of a parsed JSON object or array, which
+// can be visited any number of times, in any order, and concurrently by
+// multiple threads. It is obtained by means of parse_tape().
+//
+// The tape is an array of 64-bit entries, each made of an 8-bit tag and a
+// 56-bit payload:
+// - the entry beginning an object or array stores the index of the entry
+//   following the matching end, so that siblings can be skipped in O(1);
+// - the entry ending an object or array stores the index of the matching
+//   beginning;
+// - field names, strings and numbers store the offset of their literal in
+//   the literal buffer, and are followed by an extra entry storing its
+//   length;
+// - booleans and nulls store no payload.
+class tape final
+{
+    enum tag : std::uint8_t
+    {
+        TAG_BEGIN_OBJECT,
+        TAG_END_OBJECT,
+        TAG_BEGIN_ARRAY,
+        TAG_END_ARRAY,
+        TAG_FIELD_NAME,
+        TAG_STRING,
+        TAG_NUMBER,
+        TAG_TRUE,
+        TAG_FALSE,
+        TAG_NULL
+    };
+
+    inline static constexpr std::uint64_t PAYLOAD_MASK =
+        (std::uint64_t(1) << 56) - 1;
+
+    static tag get_tag(const std::uint64_t entry) noexcept
+    {
+        return static_cast<tag>(entry >> 56);
+    }
+
+    static std::size_t get_payload(const std::uint64_t entry) noexcept
+    {
+        return static_cast<std::size_t>(entry & PAYLOAD_MASK);
+    }
+
+public:
+    // An object, array or scalar stored in a tape. Elements are lightweight
+    // and can be freely copied. They stay valid as long as the tape they
+    // were obtained from, even if the tape is moved.
+    class element final
+    {
+    public:
+        value_type type() const noexcept
+        {
+            switch (get_tag(entry()))
+            {
+            case TAG_BEGIN_OBJECT:
+                return Object;
+            case TAG_BEGIN_ARRAY:
+                return Array;
+            case TAG_STRING:
+                return String;
+            case TAG_NUMBER:
+                return Number;
+            case TAG_TRUE:
+            case TAG_FALSE:
+                return Boolean;
+            default:
+                return Null;
+            }
+        }
+
+        // The element as a value, which can be converted by means of
+        // value::as<T>(). For objects and arrays, only the type is set.
+        value get_value() const noexcept
+        {
+            switch (get_tag(entry()))
+            {
+            case TAG_BEGIN_OBJECT:
+                return value(Object);
+            case TAG_BEGIN_ARRAY:
+                return value(Array);
+            case TAG_STRING:
+                return value(String, literal(m_index));
+            case TAG_NUMBER:
+                return value(Number, literal(m_index));
+            case TAG_TRUE:
+                return value(Boolean, "true");
+            case TAG_FALSE:
+                return value(Boolean, "false");
+            default:
+                return value(Null, "null");
+            }
+        }
+
+        template<typename T>
+        T as() const
+        {
+            return get_value().as<T>();
+        }
+
+        // Number of fields of an object, or elements of an array
+        std::size_t size() const
+        {
+            std::size_t result = 0;
+            for_each_child([&](std::size_t) {++result; return true;});
+            return result;
+        }
+
+        // Looks up the field with the given name in an object. If the same
+        // name appears more than once, the first occurrence is returned.
+        std::optional<element> find(const std::string_view field_name) const
+        {
+            require(Object, "tape::element::find()");
+
+            std::optional<element> result;
+            for_each_child(
+                [&](const std::size_t index)
+                {
+                    if (literal(index) != field_name)
+                    {
+                        return true;
+                    }
+                    result = element(m_entries, m_literals, index + 2);
+                    return false;
+                });
+            return result;
+        }
+
+        // The element at the given position in an array
+        element at(const std::size_t position) const
+        {
+            require(Array, "tape::element::at()");
+
+            std::size_t current = 0;
+            std::optional<element> result;
+            for_each_child(
+                [&](const std::size_t index)
+                {
+                    if (current++ != position)
+                    {
+                        return true;
+                    }
+                    result = element(m_entries, m_literals, index);
+                    return false;
+                });
+            if (!result)
+            {
+                throw std::out_of_range(
+                    "tape::element::at(): position out of range");
+            }
+            return *result;
+        }
+
+        // Calls functor(field_name, element) for each field of an object
+        template<typename Functor>
+        void for_each_field(Functor&& functor) const
+        {
+            require(Object, "tape::element::for_each_field()");
+
+            for_each_child(
+                [&](const std::size_t index)
+                {
+                    std::invoke(
+                        functor,
+                        literal(index),
+                        element(m_entries, m_literals, index + 2));
+                    return true;
+                });
+        }
+
+        // Calls functor(element) for each element of an array
+        template<typename Functor>
+        void for_each_element(Functor&& functor) const
+        {
+            require(Array, "tape::element::for_each_element()");
+
+            for_each_child(
+                [&](const std::size_t index)
+                {
+                    std::invoke(
+                        functor,
+                        element(m_entries, m_literals, index));
+                    return true;
+                });
+        }
+
+    private:
+        friend class tape;
+
+        explicit element(
+            const std::uint64_t* const entries,
+            const char* const literals,
+            const std::size_t index) noexcept
+        : m_entries(entries)
+        , m_literals(literals)
+        , m_index(index)
+        {
+        }
+
+        std::uint64_t entry() const noexcept
+        {
+            return m_entries[m_index];
+        }
+
+        std::string_view literal(const std::size_t index) const noexcept
+        {
+            return {
+                m_literals + get_payload(m_entries[index]),
+                static_cast<std::size_t>(m_entries[index + 1])};
+        }
+
+        // Index of the entry following the element at the given index
+        std::size_t skip(const std::size_t index) const noexcept
+        {
+            const std::uint64_t entry = m_entries[index];
+
+            switch (get_tag(entry))
+            {
+            case TAG_BEGIN_OBJECT:
+            case TAG_BEGIN_ARRAY:
+                return get_payload(entry);
+            case TAG_FIELD_NAME:
+            case TAG_STRING:
+            case TAG_NUMBER:
+                return index + 2;
+            default:
+                return index + 1;
+            }
+        }
+
+        void require(const value_type type, const char* const what) const
+        {
+            if (this->type() != type)
+            {
+                throw bad_value_cast(
+                    std::string(what) + ": wrong element type");
+            }
+        }
+
+        // Calls visitor(index) with the index of each array element or field
+        // name of an object, until the visitor returns false
+        template<typename Visitor>
+        void for_each_child(Visitor&& visitor) const
+        {
+            const tag t = get_tag(entry());
+            if (t != TAG_BEGIN_OBJECT && t != TAG_BEGIN_ARRAY)
+            {
+                return;
+            }
+
+            const std::size_t end = get_payload(entry()) - 1;
+            std::size_t index = m_index + 1;
+            while (index < end)
+            {
+                if (!visitor(index))
+                {
+                    return;
+                }
+                if (t == TAG_BEGIN_OBJECT)
+                {
+                    index += 2; // skip the field name
+                }
+                index = skip(index);
+            }
+        }
+
+        const std::uint64_t* m_entries;
+        const char* m_literals;
+        std::size_t m_index;
+    }; // class element
+
+    // The outermost object or array
+    element root() const noexcept
+    {
+        return element(m_entries, m_literals, 0);
+    }
+
+    // Serializes the tape, so that it can be later reloaded without parsing
+    // the message again by means of load() or view()
+    void save(std::ostream& stream) const
+    {
+        const std::uint64_t header[HEADER_WORDS] = {
+            MAGIC,
+            VERSION,
+            BYTE_ORDER_MARK,
+            m_entries_count,
+            m_literals_size,
+            checksum(m_entries, m_entries_count, m_literals, m_literals_size),
+        };
+
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream.write(
+            reinterpret_cast<const char*>(m_entries),
+            static_cast<std::streamsize>(
+                m_entries_count * sizeof(std::uint64_t)));
+        stream.write(m_literals, static_cast<std::streamsize>(m_literals_size));
+    }
+
+    // Reloads a tape that was serialized by means of save()
+    static tape load(std::istream& stream)
+    {
+        std::uint64_t header[HEADER_WORDS];
+        read(stream, header, sizeof(header));
+        check_header(header, std::numeric_limits<std::size_t>::max());
+
+        tape result;
+        read(stream, result.m_entry_storage, header[3]);
+        read(stream, result.m_literal_storage, header[4]);
+        result.adopt_storage();
+        result.check(header[5]);
+
+        return result;
+    }
+
+    // Uses a tape that was serialized by means of save() in place, without
+    // copying it: data must be aligned to 8 bytes, and must outlive the
+    // returned tape and any of its elements. This is typically used with
+    // memory-mapped files.
+    static tape view(const void* const data, const std::size_t size)
+    {
+        if (reinterpret_cast<std::uintptr_t>(data) %
+            alignof(std::uint64_t) != 0)
+        {
+            throw tape_error("Misaligned tape");
+        }
+        if (size < sizeof(std::uint64_t) * HEADER_WORDS)
+        {
+            throw tape_error("Truncated tape");
+        }
+
+        const std::uint64_t* const header =
+            static_cast<const std::uint64_t*>(data);
+        check_header(header, size);
+
+        tape result;
+        result.m_entries = header + HEADER_WORDS;
+        result.m_entries_count = static_cast<std::size_t>(header[3]);
+        result.m_literals =
+            reinterpret_cast<const char*>(
+                result.m_entries + result.m_entries_count);
+        result.m_literals_size = static_cast<std::size_t>(header[4]);
+        result.check(header[5]);
+
+        return result;
+    }
+
+    tape(const tape& other)
+    : m_entry_storage(other.m_entry_storage)
+    , m_literal_storage(other.m_literal_storage)
+    , m_entries(other.m_entries)
+    , m_entries_count(other.m_entries_count)
+    , m_literals(other.m_literals)
+    , m_literals_size(other.m_literals_size)
+    {
+        if (!m_entry_storage.empty())
+        {
+            adopt_storage();
+        }
+    }
+
+    tape(tape&& other) noexcept = default;
+
+    tape& operator=(const tape& other)
+    {
+        return *this = tape(other);
+    }
+
+    tape& operator=(tape&& other) noexcept = default;
+
+private:
+    template<typename Context>
+    friend tape parse_tape(Context& context);
+
+    inline static constexpr std::size_t HEADER_WORDS = 6;
+    inline static constexpr std::uint64_t MAGIC = 0x45504154524a4d00;
+    inline static constexpr std::uint64_t VERSION = 1;
+    inline static constexpr std::uint64_t BYTE_ORDER_MARK = 0x0102030405060708;
+
+    explicit tape() noexcept = default;
+
+    void add(const tag t, const std::size_t payload = 0)
+    {
+        m_entry_storage.push_back((std::uint64_t(t) << 56) | payload);
+    }
+
+    void add_literal(const tag t, const std::string_view literal)
+    {
+        add(t, m_literal_storage.size());
+        m_entry_storage.push_back(literal.size());
+        m_literal_storage.insert(
+            m_literal_storage.end(),
+            literal.begin(),
+            literal.end());
+        // Null terminator: not strictly required, but brings some extra
+        // safety at negligible cost
+        m_literal_storage.push_back(0);
+    }
+
+    // Makes the tape point to the data it owns
+    void adopt_storage() noexcept
+    {
+        m_entries = m_entry_storage.data();
+        m_entries_count = m_entry_storage.size();
+        m_literals = m_literal_storage.data();
+        m_literals_size = m_literal_storage.size();
+    }
+
+    static void read(std::istream& stream, void* data, std::size_t size)
+    {
+        stream.read(
+            static_cast<char*>(data),
+            static_cast<std::streamsize>(size));
+        if (static_cast<std::size_t>(stream.gcount()) != size)
+        {
+            throw tape_error("Truncated tape");
+        }
+    }
+
+    // Reads count elements into storage, which only grows as the data
+    // actually arrives, so that a corrupted header cannot cause a huge
+    // allocation
+    template<typename T>
+    static void read(
+        std::istream& stream,
+        std::vector<T>& storage,
+        const std::uint64_t count)
+    {
+        constexpr std::size_t chunk_size = (std::size_t(1) << 20) / sizeof(T);
+
+        storage.clear();
+        while (storage.size() < count)
+        {
+            const std::size_t offset = storage.size();
+            const std::size_t size =
+                static_cast<std::size_t>(
+                    std::min<std::uint64_t>(count - offset, chunk_size));
+            storage.resize(offset + size);
+            read(stream, storage.data() + offset, size * sizeof(T));
+        }
+    }
+
+    // Checks the header of a serialized tape, whose size is at most max_size
+    static void check_header(
+        const std::uint64_t* const header,
+        const std::size_t max_size)
+    {
+        if (header[0] != MAGIC)
+        {
+            if (header[0] == byte_swap(MAGIC))
+            {
+                throw tape_error("Tape was saved with a different byte order");
+            }
+            throw tape_error("Not a tape");
+        }
+        if (header[1] != VERSION || header[2] != BYTE_ORDER_MARK)
+        {
+            throw tape_error("Unsupported tape version");
+        }
+
+        const std::uint64_t max_entries =
+            max_size / sizeof(std::uint64_t) - HEADER_WORDS;
+        if (header[3] > max_entries ||
+            header[4] > (max_entries - header[3]) * sizeof(std::uint64_t) +
+                max_size % sizeof(std::uint64_t))
+        {
+            throw tape_error("Truncated tape");
+        }
+    }
+
+    static std::uint64_t byte_swap(std::uint64_t word) noexcept
+    {
+        std::uint64_t result = 0;
+        for (std::size_t i = 0; i < sizeof(word); ++i)
+        {
+            result = (result << 8) | (word & 0xff);
+            word >>= 8;
+        }
+        return result;
+    }
+
+    // Word-wise FNV-1a variant: much faster than its byte-wise counterpart,
+    // while still detecting truncated or corrupted files
+    static std::uint64_t checksum(
+        const std::uint64_t* const entries,
+        const std::size_t entries_count,
+        const char* const literals,
+        const std::size_t literals_size) noexcept
+    {
+        constexpr std::uint64_t prime = 0x100000001b3;
+        std::uint64_t result = 0xcbf29ce484222325;
+
+        for (std::size_t i = 0; i < entries_count; ++i)
+        {
+            result = (result ^ entries[i]) * prime;
+        }
+        for (std::size_t i = 0; i < literals_size; i += sizeof(std::uint64_t))
+        {
+            std::uint64_t word = 0;
+            std::memcpy(
+                &word,
+                literals + i,
+                std::min(sizeof(word), literals_size - i));
+            result = (result ^ word) * prime;
+        }
+
+        return result;
+    }
+
+    // Checks the integrity of a tape that was loaded from outside, so that
+    // visiting it can never cause out-of-bounds accesses
+    void check(const std::uint64_t expected_checksum) const
+    {
+        if (checksum(m_entries, m_entries_count, m_literals, m_literals_size)
+            != expected_checksum)
+        {
+            throw tape_error("Tape checksum mismatch");
+        }
+
+        const auto malformed = []
+        {
+            return tape_error("Malformed tape");
+        };
+
+        std::vector<std::size_t> open_entries;
+        bool expect_field_name = false;
+        std::size_t index = 0;
+        while (index < m_entries_count)
+        {
+            if (index != 0 && open_entries.empty())
+            {
+                throw malformed(); // trailing entries
+            }
+
+            const std::uint64_t entry = m_entries[index];
+            const tag t = get_tag(entry);
+            const std::size_t payload = get_payload(entry);
+
+            const bool in_object = !open_entries.empty() &&
+                get_tag(m_entries[open_entries.back()]) == TAG_BEGIN_OBJECT;
+            if (expect_field_name ?
+                    (t != TAG_FIELD_NAME && t != TAG_END_OBJECT) :
+                    (t == TAG_FIELD_NAME || t == TAG_END_OBJECT ||
+                     (t == TAG_END_ARRAY && in_object) ||
+                     (index == 0 && t != TAG_BEGIN_OBJECT &&
+                      t != TAG_BEGIN_ARRAY)))
+            {
+                throw malformed();
+            }
+
+            switch (t)
+            {
+            case TAG_BEGIN_OBJECT:
+            case TAG_BEGIN_ARRAY:
+                open_entries.push_back(index);
+                expect_field_name = (t == TAG_BEGIN_OBJECT);
+                ++index;
+                continue;
+
+            case TAG_END_OBJECT:
+            case TAG_END_ARRAY:
+                if (open_entries.empty() ||
+                    payload != open_entries.back() ||
+                    get_tag(m_entries[payload]) != static_cast<tag>(t - 1) ||
+                    get_payload(m_entries[payload]) != index + 1)
+                {
+                    throw malformed();
+                }
+                open_entries.pop_back();
+                ++index;
+                break;
+
+            case TAG_FIELD_NAME:
+            case TAG_STRING:
+            case TAG_NUMBER:
+                if (index + 1 >= m_entries_count ||
+                    payload >= m_literals_size ||
+                    m_entries[index + 1] >= m_literals_size - payload ||
+                    m_literals[payload + m_entries[index + 1]] != 0)
+                {
+                    throw malformed();
+                }
+                index += 2;
+                if (t == TAG_FIELD_NAME)
+                {
+                    expect_field_name = false;
+                    continue;
+                }
+                break;
+
+            case TAG_TRUE:
+            case TAG_FALSE:
+            case TAG_NULL:
+                if (payload != 0)
+                {
+                    throw malformed();
+                }
+                ++index;
+                break;
+
+            default:
+                throw malformed();
+            }
+
+            // A value was just read
+            expect_field_name = !open_entries.empty() &&
+                get_tag(m_entries[open_entries.back()]) == TAG_BEGIN_OBJECT;
+        }
+
+        if (m_entries_count == 0 || !open_entries.empty())
+        {
+            throw malformed();
+        }
+    }
+
+    std::vector<std::uint64_t> m_entry_storage;
+    std::vector<char> m_literal_storage;
+
+    // Point either to the storage above, or to memory owned by the caller
+    const std::uint64_t* m_entries = nullptr;
+    std::size_t m_entries_count = 0;
+    const char* m_literals = nullptr;
+    std::size_t m_literals_size = 0;
+}; // class tape
+
+// Parses a JSON object or array into a tape
+template<typename Context>
+tape parse_tape(Context& context)
+{
+    tape result;
+    std::vector<std::size_t> open_entries;
+
+    cursor<Context> reader(context);
+
+    while (true)
+    {
+        const token_type token = reader.next();
+
+        switch (token)
+        {
+        case BeginObject:
+        case BeginArray:
+            open_entries.push_back(result.m_entry_storage.size());
+            result.add(
+                (token == BeginObject) ?
+                    tape::TAG_BEGIN_OBJECT :
+                    tape::TAG_BEGIN_ARRAY);
+            break;
+
+        case EndObject:
+        case EndArray:
+            {
+                const std::size_t begin = open_entries.back();
+                open_entries.pop_back();
+                result.add(
+                    (token == EndObject) ?
+                        tape::TAG_END_OBJECT :
+                        tape::TAG_END_ARRAY,
+                    begin);
+                // Now we know where the object or array ends
+                result.m_entry_storage[begin] |= result.m_entry_storage.size();
+            }
+            break;
+
+        case FieldName:
+            result.add_literal(tape::TAG_FIELD_NAME, reader.field_name());
+            break;
+
+        case Scalar:
+            {
+                const value v = reader.get_value();
+                switch (v.type())
+                {
+                case String:
+                    result.add_literal(tape::TAG_STRING, v.raw());
+                    break;
+                case Number:
+                    result.add_literal(tape::TAG_NUMBER, v.raw());
+                    break;
+                case Boolean:
+                    result.add(
+                        v.as<bool>() ? tape::TAG_TRUE : tape::TAG_FALSE);
+                    break;
+                case Null:
+                    result.add(tape::TAG_NULL);
+                    break;
+                // LCOV_EXCL_START
+                case Object:
+                case Array:
+                    throw std::runtime_error(
+                        "[minijson_reader] this line should never be "
+                        "reached, please file a bug report");
+                // LCOV_EXCL_STOP
+                }
+            }
+            break;
+
+        case EndOfInput:
+            result.adopt_storage();
+            return result;
+        }
+    }
+}
+
+// Declares how the fields of a JSON object map to the members of T, so that
+// the object can be parsed by means of parse_into(). Specializations must
+// provide a static constexpr tuple of required_field(), optional_field() and
+// ignored_field() named fields.
+template<typename T>
+struct binding;
+
+namespace detail
+{
+
+template<typename Class, typename Member>
+struct member_field_binding final
+{
+    std::string_view name;
+    Member Class::* member;
+    bool required;
+};
+
+struct ignored_field_binding final
+{
+    std::string_view name;
+};
+
+template<typename T, typename Enable = void>
+struct is_bound : std::false_type
+{
+};
+
+template<typename T>
+struct is_bound<T, std::void_t<decltype(binding<T>::fields)>>
+    : std::true_type
+{
+};
+
+template<typename T>
+struct is_std_vector : std::false_type
+{
+};
+
+template<typename T, typename Allocator>
+struct is_std_vector<std::vector<T, Allocator>> : std::true_type
+{
+};
+
+constexpr std::size_t field_name_slot(
+    const std::string_view field_name,
+    const std::uint64_t seed,
+    const std::size_t table_size) noexcept
+{
+    std::uint64_t hash = 0xcbf29ce484222325 ^ (seed * 0x9e3779b97f4a7c15);
+    for (const char c : field_name)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    }
+    return static_cast<std::size_t>(hash ^ (hash >> 32)) & (table_size - 1);
+}
+
+struct perfect_hash_params final
+{
+    std::uint64_t seed;
+    std::size_t table_size;
+};
+
+template<std::size_t N>
+constexpr bool has_duplicates(
+    const std::array<std::string_view, N>& field_names) noexcept
+{
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        for (std::size_t j = i + 1; j < N; ++j)
+        {
+            if (field_names[i] == field_names[j])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Finds a seed and a table size (a power of 2, as small as possible) such
+// that every field name is hashed to a different slot of the table
+template<std::size_t N>
+constexpr perfect_hash_params find_perfect_hash(
+    const std::array<std::string_view, N>& field_names) noexcept
+{
+    if (has_duplicates(field_names))
+    {
+        return {0, 1}; // there is a static_assert for this
+    }
+
+    std::size_t table_size = 1;
+    while (table_size < N)
+    {
+        table_size *= 2;
+    }
+
+    for (;; table_size *= 2)
+    {
+        for (std::uint64_t seed = 0; seed < 64; ++seed)
+        {
+            std::array<std::size_t, N> slots {};
+            bool collision = false;
+            for (std::size_t i = 0; i < N && !collision; ++i)
+            {
+                slots[i] = field_name_slot(field_names[i], seed, table_size);
+                for (std::size_t j = 0; j < i && !collision; ++j)
+                {
+                    collision = (slots[i] == slots[j]);
+                }
+            }
+            if (!collision)
+            {
+                return {seed, table_size};
+            }
+        }
+    }
+}
+
+template<typename Member, typename Context>
+void parse_member(Member& member, value v, Context& context);
+
+// Generated parser for objects bound to T
+template<typename T>
+class bound_parser final
+{
+    using fields_type = std::remove_cv_t<decltype(binding<T>::fields)>;
+
+    inline static constexpr std::size_t n_fields =
+        std::tuple_size_v<fields_type>;
+
+    static_assert(
+        n_fields < std::numeric_limits<std::uint16_t>::max(),
+        "binding<T>: too many fields");
+
+    template<std::size_t... I>
+    static constexpr std::array<std::string_view, n_fields> get_field_names(
+        std::index_sequence<I...>) noexcept
+    {
+        return {std::get<I>(binding<T>::fields).name...};
+    }
+
+    inline static constexpr std::array<std::string_view, n_fields>
+        field_names =
+            get_field_names(std::make_index_sequence<n_fields>());
+
+    static_assert(
+        !has_duplicates(field_names),
+        "binding<T>: the same field name is bound more than once");
+
+    inline static constexpr perfect_hash_params hash =
+        find_perfect_hash(field_names);
+
+    // Maps each slot to the index of the field hashed to it, or n_fields
+    static constexpr std::array<std::uint16_t, hash.table_size>
+        build_table() noexcept
+    {
+        std::array<std::uint16_t, hash.table_size> table {};
+        for (std::size_t slot = 0; slot < hash.table_size; ++slot)
+        {
+            table[slot] = n_fields;
+        }
+        for (std::size_t i = 0; i < n_fields; ++i)
+        {
+            table[field_name_slot(
+                field_names[i],
+                hash.seed,
+                hash.table_size)] = static_cast<std::uint16_t>(i);
+        }
+        return table;
+    }
+
+    inline static constexpr std::array<std::uint16_t, hash.table_size>
+        table = build_table();
+
+public:
+    template<typename Context>
+    static void parse(Context& context, T& target)
+    {
+        std::bitset<n_fields> parsed_fields;
+
+        parse_object(
+            context,
+            [&](const std::string_view field_name, const value v)
+            {
+                const std::size_t index = table[
+                    field_name_slot(field_name, hash.seed, hash.table_size)];
+                if (index == n_fields || field_names[index] != field_name)
+                {
+                    throw unhandled_field_error(field_name);
+                }
+
+                parsed_fields.set(index);
+                parse_field(
+                    index,
+                    v,
+                    context,
+                    target,
+                    std::make_index_sequence<n_fields>());
+            });
+
+        enforce_required(
+            parsed_fields,
+            std::make_index_sequence<n_fields>());
+    }
+
+private:
+    template<typename Context, std::size_t... I>
+    static void parse_field(
+        [[maybe_unused]] const std::size_t index,
+        [[maybe_unused]] const value v,
+        [[maybe_unused]] Context& context,
+        [[maybe_unused]] T& target,
+        std::index_sequence<I...>)
+    {
+        (void) (... || (
+            index == I &&
+            (parse_field(std::get<I>(binding<T>::fields), v, context, target),
+             true)));
+    }
+
+    template<typename Context, typename Class, typename Member>
+    static void parse_field(
+        const member_field_binding<Class, Member>& field,
+        const value v,
+        Context& context,
+        T& target)
+    {
+        parse_member(target.*(field.member), v, context);
+    }
+
+    template<typename Context>
+    static void parse_field(
+        const ignored_field_binding&,
+        const value,
+        Context& context,
+        T&)
+    {
+        minijson::ignore(context);
     }
 
-    // We are in the Number case.
-    // Let's check that the number looks OK according to the JSON
-    // specification, but let's not convert it yet
-    // (that happens in value::as<T>() only as required).
+    template<std::size_t... I>
+    static void enforce_required(
+        const std::bitset<n_fields>& parsed_fields,
+        std::index_sequence<I...>)
+    {
+        (..., enforce_required(std::get<I>(binding<T>::fields),
+                               parsed_fields[I]));
+    }
 
-    if (is_value_termination(c))
+    template<typename Class, typename Member>
+    static void enforce_required(
+        const member_field_binding<Class, Member>& field,
+        const bool parsed)
     {
-        throw parse_error(context, parse_error::EXPECTED_VALUE);
+        if (field.required && !parsed)
+        {
+            throw missing_field_error(field.name);
+        }
     }
 
-    enum
+    static void enforce_required(const ignored_field_binding&, bool) noexcept
     {
-        SIGN_OR_FIRST_DIGIT,
-        FIRST_DIGIT,
-        AFTER_LEADING_ZERO,
-        INTEGRAL_PART,
-        FRACTIONAL_PART_FIRST_DIGIT,
-        FRACTIONAL_PART,
-        EXPONENT_SIGN_OR_FIRST_DIGIT,
-        EXPONENT_FIRST_DIGIT,
-        EXPONENT,
-    } state = SIGN_OR_FIRST_DIGIT;
+    }
+}; // class bound_parser
 
-    while (true)
+template<typename Member, typename Context>
+void parse_member(Member& member, const value v, Context& context)
+{
+    if constexpr (is_bound<Member>::value)
     {
-        if (c == 0)
+        if (v.type() != Object)
         {
-            throw parse_error(context, parse_error::UNTERMINATED_VALUE);
+            throw bad_value_cast("parse_into(): value type is not Object");
         }
-        if (is_value_termination(c))
+        bound_parser<Member>::parse(context, member);
+    }
+    else if constexpr (is_std_vector<Member>::value)
+    {
+        if (v.type() != Array)
         {
-            break;
+            throw bad_value_cast("parse_into(): value type is not Array");
         }
+        member.clear();
+        parse_array(
+            context,
+            [&](const value element_value)
+            {
+                typename Member::value_type element {};
+                parse_member(element, element_value, context);
+                member.push_back(std::move(element));
+            });
+    }
+    else if constexpr (std::is_same_v<Member, std::string>)
+    {
+        member = v.as<std::string_view>();
+    }
+    else if constexpr (is_std_optional<Member>())
+    {
+        using U = typename Member::value_type;
 
-        switch (state)
+        if constexpr (
+            is_bound<U>::value ||
+            is_std_vector<U>::value ||
+            std::is_same_v<U, std::string>)
         {
-        case SIGN_OR_FIRST_DIGIT:
-            if (c == '-') // leading plus sign not allowed
-            {
-                state = FIRST_DIGIT;
-                break;
-            }
-            [[fallthrough]];
-        case FIRST_DIGIT:
-            if (c == '0')
+            if (v.type() == Null)
             {
-                // If zero is the first digit, then it must be the ONLY digit
-                // of the integral part
-                state = AFTER_LEADING_ZERO;
-                break;
+                member.reset();
             }
-            if (is_digit(c))
+            else
             {
-                state = INTEGRAL_PART;
-                break;
+                parse_member(member.emplace(), v, context);
             }
-            throw parse_error(context, parse_error::INVALID_VALUE);
+        }
+        else
+        {
+            v.to(member);
+        }
+    }
+    else
+    {
+        v.to(member);
+    }
+}
 
-        case INTEGRAL_PART:
-            if (is_digit(c))
-            {
-                break;
-            }
-            [[fallthrough]];
-        case AFTER_LEADING_ZERO:
-            if (c == '.')
-            {
-                state = FRACTIONAL_PART_FIRST_DIGIT;
-                break;
-            }
-            if (c == 'e' || c == 'E')
-            {
-                state = EXPONENT_SIGN_OR_FIRST_DIGIT;
-                break;
-            }
-            throw parse_error(context, parse_error::INVALID_VALUE);
+} // namespace detail
 
-        case FRACTIONAL_PART:
-            if (c == 'e' || c == 'E')
-            {
-                state = EXPONENT_SIGN_OR_FIRST_DIGIT;
-                break;
-            }
-            [[fallthrough]];
-        case FRACTIONAL_PART_FIRST_DIGIT:
-            if (is_digit(c))
-            {
-                state = FRACTIONAL_PART;
-                break;
-            }
-            throw parse_error(context, parse_error::INVALID_VALUE);
+// Binds a field that must be present in the JSON object to a member
+template<typename Class, typename Member>
+constexpr detail::member_field_binding<Class, Member> required_field(
+    const std::string_view field_name,
+    Member Class::* const member) noexcept
+{
+    return {field_name, member, true};
+}
 
-        case EXPONENT_SIGN_OR_FIRST_DIGIT:
-            if (c == '+' || c == '-')
-            {
-                state = EXPONENT_FIRST_DIGIT;
-                break;
-            }
-            [[fallthrough]];
-        case EXPONENT_FIRST_DIGIT:
-        case EXPONENT:
-            if (is_digit(c))
+// Binds a field that may be missing from the JSON object to a member,
+// which is left untouched if that is the case
+template<typename Class, typename Member>
+constexpr detail::member_field_binding<Class, Member> optional_field(
+    const std::string_view field_name,
+    Member Class::* const member) noexcept
+{
+    return {field_name, member, false};
+}
+
+// Declares a field that may be present in the JSON object, but is not bound
+// to any member
+constexpr detail::ignored_field_binding ignored_field(
+    const std::string_view field_name) noexcept
+{
+    return {field_name};
+}
+
+// Parses a JSON object into target, whose type must have a binding
+template<typename Context, typename T>
+void parse_into(Context& context, T& target)
+{
+    static_assert(
+        detail::is_bound<T>::value,
+        "parse_into(): binding<T> is not specialized for T");
+
+    detail::bound_parser<T>::parse(context, target);
+}
+
+namespace detail
+{
+
+// Validity bitmap of a column: bit i (i % 64 of word i / 64) is set if
+// the i-th entry is not null
+class validity_bitmap final
+{
+public:
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    bool test(const std::size_t index) const noexcept
+    {
+        return (m_words[index / 64] >> (index % 64)) & 1;
+    }
+
+    const std::vector<std::uint64_t>& words() const noexcept
+    {
+        return m_words;
+    }
+
+    void push_back(const bool valid)
+    {
+        if (m_size % 64 == 0)
+        {
+            m_words.push_back(0);
+        }
+        m_words.back() |= std::uint64_t(valid) << (m_size % 64);
+        ++m_size;
+    }
+
+    void clear() noexcept
+    {
+        m_words.clear();
+        m_size = 0;
+    }
+
+private:
+    std::vector<std::uint64_t> m_words;
+    std::size_t m_size = 0;
+}; // class validity_bitmap
+
+} // namespace detail
+
+// Column of values of type T filled by parse_columns(). Null entries are
+// stored as value-initialized T's, and are marked in the validity bitmap.
+template<typename T>
+class column final
+{
+    static_assert(
+        !detail::is_std_optional<T>(),
+        "column<T>: T cannot be std::optional, as nulls are tracked by the "
+        "validity bitmap");
+
+public:
+    std::size_t size() const noexcept
+    {
+        return m_validity.size();
+    }
+
+    const std::vector<T>& values() const noexcept
+    {
+        return m_values;
+    }
+
+    bool is_valid(const std::size_t index) const noexcept
+    {
+        return m_validity.test(index);
+    }
+
+    const std::vector<std::uint64_t>& validity() const noexcept
+    {
+        return m_validity.words();
+    }
+
+    // Appends a value, which is converted by means of value::as<T>()
+    void append(const value v)
+    {
+        if (v.type() == Null)
+        {
+            append_null();
+            return;
+        }
+        m_values.push_back(v.as<T>());
+        m_validity.push_back(true);
+    }
+
+    void append_null()
+    {
+        m_values.push_back(T {});
+        m_validity.push_back(false);
+    }
+
+    void clear() noexcept
+    {
+        m_values.clear();
+        m_validity.clear();
+    }
+
+private:
+    std::vector<T> m_values;
+    detail::validity_bitmap m_validity;
+}; // class column
+
+// Column of strings filled by parse_columns(), all stored one after another
+// in a single pool of characters. Null entries are stored as empty strings,
+// and are marked in the validity bitmap.
+class string_column final
+{
+public:
+    std::size_t size() const noexcept
+    {
+        return m_validity.size();
+    }
+
+    std::string_view operator[](const std::size_t index) const noexcept
+    {
+        return {
+            m_chars.data() + m_offsets[index],
+            m_offsets[index + 1] - m_offsets[index]};
+    }
+
+    // The pool of characters
+    const std::vector<char>& chars() const noexcept
+    {
+        return m_chars;
+    }
+
+    // The i-th string goes from offsets()[i] (included) to offsets()[i + 1]
+    // (excluded) in the pool of characters
+    const std::vector<std::size_t>& offsets() const noexcept
+    {
+        return m_offsets;
+    }
+
+    bool is_valid(const std::size_t index) const noexcept
+    {
+        return m_validity.test(index);
+    }
+
+    const std::vector<std::uint64_t>& validity() const noexcept
+    {
+        return m_validity.words();
+    }
+
+    // Appends a value, which must be a String or Null
+    void append(const value v)
+    {
+        if (v.type() == Null)
+        {
+            append_null();
+            return;
+        }
+        const std::string_view string = v.as<std::string_view>();
+        m_chars.insert(m_chars.end(), string.begin(), string.end());
+        m_offsets.push_back(m_chars.size());
+        m_validity.push_back(true);
+    }
+
+    void append_null()
+    {
+        m_offsets.push_back(m_chars.size());
+        m_validity.push_back(false);
+    }
+
+    void clear() noexcept
+    {
+        m_chars.clear();
+        m_offsets.assign(1, 0);
+        m_validity.clear();
+    }
+
+private:
+    std::vector<char> m_chars;
+    std::vector<std::size_t> m_offsets {0};
+    detail::validity_bitmap m_validity;
+}; // class string_column
+
+namespace detail
+{
+
+template<typename Column>
+struct column_field_binding final
+{
+    std::string_view field_name;
+    Column& column;
+};
+
+template<typename... Column>
+class column_extractor final
+{
+public:
+    explicit column_extractor(column_field_binding<Column>... fields) noexcept
+    : m_fields(fields...)
+    {
+    }
+
+    template<typename Context>
+    void parse_record(Context& context)
+    {
+        m_parsed.fill(false);
+
+        parse_object(
+            context,
+            [&](const std::string_view field_name, const value v)
             {
-                state = EXPONENT;
-                break;
-            }
-            throw parse_error(context, parse_error::INVALID_VALUE);
+                offer(field_name, v, std::index_sequence_for<Column...>());
+
+                // Skip nested objects and arrays not appended to any column
+                minijson::ignore(context);
+            });
+
+        append_nulls(std::index_sequence_for<Column...>());
+    }
+
+private:
+    // Appends the value to the first column bound to the field, unless that
+    // column already got a value from this record (i.e. the first occurrence
+    // of a field wins)
+    template<std::size_t... I>
+    void offer(
+        [[maybe_unused]] const std::string_view field_name,
+        [[maybe_unused]] const value v,
+        std::index_sequence<I...>)
+    {
+        (void) (... || (
+            std::get<I>(m_fields).field_name == field_name &&
+            (append<I>(v), true)));
+    }
+
+    template<std::size_t I>
+    void append(const value v)
+    {
+        if (!m_parsed[I])
+        {
+            std::get<I>(m_fields).column.append(v);
+            m_parsed[I] = true;
         }
+    }
 
-        literal_io.write(c);
-        c = literal_io.read();
+    template<std::size_t... I>
+    void append_nulls(std::index_sequence<I...>)
+    {
+        (..., append_null<I>());
     }
 
-    switch (state)
+    template<std::size_t I>
+    void append_null()
     {
-    case AFTER_LEADING_ZERO:
-    case INTEGRAL_PART:
-    case FRACTIONAL_PART:
-    case EXPONENT:
-        break;
-    default:
-        throw parse_error(context, parse_error::INVALID_VALUE);
+        if (!m_parsed[I])
+        {
+            std::get<I>(m_fields).column.append_null();
+        }
     }
 
-    return {value(Number, literal_io.finalize()), c};
-}
+    std::tuple<column_field_binding<Column>...> m_fields;
+    std::array<bool, sizeof...(Column)> m_parsed {};
+}; // class column_extractor
 
-// Helper function of parse_object() and parse_array() dealing with the opening
-// bracket/brace of arrays and objects in presence of nesting
-template<typename Context>
-void parse_init(
-    const Context& context,
-    char& c,
-    bool& must_read) noexcept
+} // namespace detail
+
+// Binds a field of the objects parsed by parse_columns() to a column
+template<typename Column>
+detail::column_field_binding<Column> column_field(
+    const std::string_view field_name,
+    Column& column) noexcept
 {
-    switch (context.nested_status())
-    {
-    case Context::NESTED_STATUS_NONE:
-        must_read = true;
-        break;
+    return {field_name, column};
+}
 
-    case Context::NESTED_STATUS_OBJECT:
-        c = '{';
-        // Since we are parsing a nested object, we already read an opening
-        // brace. The main loop does not need to read a character from the
-        // input.
-        must_read = false;
-        break;
+// Parses an array of objects, appending the fields bound by column_field()
+// to the respective columns. Missing fields are appended as nulls, fields
+// not bound to any column are ignored. Returns the number of bytes read.
+template<typename Context, typename... Column>
+std::size_t parse_columns(
+    Context& context,
+    const detail::column_field_binding<Column>... fields)
+{
+    detail::column_extractor<Column...> extractor(fields...);
 
-    case Context::NESTED_STATUS_ARRAY:
-        // Since we are parsing a nested array, we already read an opening
-        // bracket. The main loop does not need to read a character from the
-        // input.
-        c = '[';
-        must_read = false;
-        break;
-    }
+    return parse_array(
+        context,
+        [&](const value v)
+        {
+            if (v.type() != Object)
+            {
+                throw bad_value_cast(
+                    "parse_columns(): value type is not Object");
+            }
+            extractor.parse_record(context);
+        });
 }
 
-// Helper function of parse_object() and parse_array() parsing JSON values.
-// In case the value is a nested Object or Array, returns a placeholder value.
-template<typename Context>
-value parse_value(Context& context, char& c, bool& must_read)
+// Thrown when parsing a record of a sequence of messages (e.g. by
+// parse_ndjson()) fails. The original exception is nested, and can be
+// retrieved by means of std::rethrow_if_nested().
+// Not final, as std::throw_with_nested() needs to derive from it.
+class record_error : public std::exception
 {
-    switch (c)
+public:
+    explicit record_error(
+        const std::size_t index,
+        const std::size_t offset) noexcept
+    : m_index(index)
+    , m_offset(offset)
     {
-    case '{':
-        context.begin_nested(Context::NESTED_STATUS_OBJECT);
-        return value(Object);
+    }
 
-    case '[':
-        context.begin_nested(Context::NESTED_STATUS_ARRAY);
-        return value(Array);
+    // Zero-based index of the record
+    std::size_t index() const noexcept
+    {
+        return m_index;
+    }
 
-    case '"':
-        return value(String, parse_string(context));
+    // Offset of the first byte of the record in the whole input
+    std::size_t offset() const noexcept
+    {
+        return m_offset;
+    }
 
-    default: // Boolean, Null or Number
-        value v;
-        std::tie(v, c) = parse_unquoted_value(context, c);
-        // c contains the character after the value, no need to read again
-        // in the main loop
-        must_read = false;
-        return v;
+    const char* what() const noexcept override
+    {
+        return "Error while parsing record";
     }
-}
 
-} // namespace detail
+private:
+    std::size_t m_index;
+    std::size_t m_offset;
+}; // class record_error
 
-template<typename Context, typename Handler>
-std::size_t parse_object(Context& context, Handler&& handler)
+namespace detail
+{
+
+inline bool is_blank(const char* const begin, const char* const end) noexcept
+{
+    return std::all_of(begin, end, is_whitespace);
+}
+
+// Checks that only whitespace follows the message the context was used to
+// parse. A handler which did not read anything chose to skip the message.
+inline void check_end_of_message(const_buffer_context& context)
 {
     const std::size_t read_offset = context.read_offset();
+    if (read_offset == 0)
+    {
+        return;
+    }
 
-    const std::size_t nesting_level = context.nesting_level();
-    if (nesting_level > MJR_NESTING_LIMIT)
+    const char* const end =
+        context.read_buffer() + context.read_buffer_length();
+    const char* const rest = context.read_buffer() + read_offset;
+    const char* const trailing = std::find_if_not(rest, end, is_whitespace);
+    if (trailing != end)
     {
-        throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
+        context.advance(trailing - rest + 1);
+        throw parse_error(context, parse_error::EXPECTED_END_OF_MESSAGE);
     }
+}
 
-    char c = 0;
-    bool must_read = false;
+// Parses one record by means of the handler, after repositioning the context
+// on it. Returns false if the record is blank, and was thus skipped.
+template<typename Handler>
+bool parse_line(
+    const_buffer_context& context,
+    const char* const begin,
+    const char* const end,
+    Handler& handler)
+{
+    if (is_blank(begin, end))
+    {
+        return false;
+    }
 
-    detail::parse_init(context, c, must_read);
-    context.reset_nested_status();
+    context.reset(begin, end - begin);
+    handler(context);
+    check_end_of_message(context);
 
-    enum
-    {
-        OPENING_BRACKET,
-        FIELD_NAME_OR_CLOSING_BRACKET, // in case the object is empty
-        FIELD_NAME,
-        COLON,
-        FIELD_VALUE,
-        COMMA_OR_CLOSING_BRACKET,
-        END
-    } state = OPENING_BRACKET;
+    return true;
+}
 
-    std::string_view field_name = "";
+// Like parse_line(), but nests any exception within a record_error
+template<typename Handler>
+bool parse_record(
+    const_buffer_context& context,
+    const char* const begin,
+    const char* const end,
+    const std::size_t index,
+    const std::size_t offset,
+    Handler& handler)
+{
+    try
+    {
+        return parse_line(context, begin, end, handler);
+    }
+    catch (...)
+    {
+        std::throw_with_nested(record_error(index, offset));
+    }
+}
 
-    while (state != END)
+// Calls f(line_begin, line_end) for each line of the buffer, newlines
+// excluded
+template<typename Function>
+void for_each_line(const char* begin, const char* const end, Function&& f)
+{
+    while (begin != end)
     {
-        if (context.nesting_level() != nesting_level)
+        const char* newline =
+            static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (newline == nullptr)
         {
-            throw parse_error(
-                context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+            newline = end;
         }
 
-        if (must_read)
-        {
-            c = context.read();
-        }
+        f(begin, newline);
 
-        must_read = true;
+        begin = (newline != end) ? newline + 1 : end;
+    }
+}
 
-        if (detail::is_whitespace(c))
-        {
-            continue;
-        }
+} // namespace detail
 
-        switch (state)
+// Parses newline-delimited JSON (also known as JSON Lines), calling the
+// handler once per non-blank line with a const_buffer_context positioned at
+// the beginning of the line. The same context is reused for all the lines.
+// Returns the number of records parsed.
+template<typename Handler>
+std::size_t parse_ndjson(
+    const char* const buffer,
+    const std::size_t length,
+    Handler&& handler)
+{
+    const_buffer_context context(nullptr, 0);
+    std::size_t index = 0;
+
+    detail::for_each_line(
+        buffer,
+        buffer + length,
+        [&](const char* const begin, const char* const end)
         {
-        case OPENING_BRACKET:
-            if (c != '{')
+            if (detail::parse_record(
+                context, begin, end, index, begin - buffer, handler))
             {
-                throw parse_error(
-                    context, parse_error::EXPECTED_OPENING_BRACKET);
+                ++index;
             }
-            state = FIELD_NAME_OR_CLOSING_BRACKET;
-            break;
+        });
 
-        case FIELD_NAME_OR_CLOSING_BRACKET:
-            if (c == '}')
-            {
-                state = END;
-                break;
-            }
-            [[fallthrough]];
+    return index;
+}
 
-        case FIELD_NAME:
-            if (c != '"')
-            {
-                throw parse_error(context, parse_error::EXPECTED_OPENING_QUOTE);
-            }
-            field_name = detail::parse_string(context);
-            state = COLON;
-            break;
+// Like the above, but reads the lines from a stream
+template<typename Handler>
+std::size_t parse_ndjson(std::istream& stream, Handler&& handler)
+{
+    const_buffer_context context(nullptr, 0);
+    std::size_t index = 0;
+    std::size_t offset = 0;
 
-        case COLON:
-            if (c != ':')
-            {
-                throw parse_error(context, parse_error::EXPECTED_COLON);
-            }
-            state = FIELD_VALUE;
-            break;
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (detail::parse_record(
+            context,
+            line.data(),
+            line.data() + line.size(),
+            index,
+            offset,
+            handler))
+        {
+            ++index;
+        }
 
-        case FIELD_VALUE:
-            {
-                const value v = detail::parse_value(context, c, must_read);
+        offset += line.size() + 1;
+    }
 
-                // Try calling the handler with the context as the last argument
-                if constexpr (
-                    std::is_invocable_v<
-                        decltype(handler),
-                        decltype(field_name),
-                        decltype(v),
-                        decltype(context)>)
-                {
-                    std::invoke(handler, field_name, v, context);
-                }
-                else
-                {
-                    // Now try again without the context. Generate a compile
-                    // error if it does not work.
-                    std::invoke(handler, field_name, v);
-                }
-            }
-            state = COMMA_OR_CLOSING_BRACKET;
-            break;
+    return index;
+}
 
-        case COMMA_OR_CLOSING_BRACKET:
-            if (c == ',')
+// Thrown when the input of parse_length_prefixed() ends in the middle of a
+// frame
+class framing_error final : public std::runtime_error
+{
+public:
+    explicit framing_error(const std::size_t offset)
+    : std::runtime_error("Truncated frame")
+    , m_offset(offset)
+    {
+    }
+
+    // Offset of the first byte of the truncated frame in the whole input
+    std::size_t offset() const noexcept
+    {
+        return m_offset;
+    }
+
+private:
+    std::size_t m_offset;
+}; // class framing_error
+
+namespace detail
+{
+
+// Finds the end of an object or array by tracking its nesting depth, one
+// character at a time, starting from its opening bracket. The message is not
+// validated: brackets are matched by depth only, and quotes are assumed to
+// delimit strings, unless escaped.
+class message_scanner final
+{
+public:
+    // Returns true if c ends the object or array
+    bool feed(const char c) noexcept
+    {
+        if (m_in_string)
+        {
+            if (m_escaped)
             {
-                state = FIELD_NAME;
+                m_escaped = false;
             }
-            else if (c == '}')
+            else if (c == '\\')
             {
-                state = END;
+                m_escaped = true;
             }
-            else
+            else if (c == '"')
             {
-                throw parse_error(
-                    context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+                m_in_string = false;
             }
-            break;
-
-        // LCOV_EXCL_START
-        case END:
-            throw std::runtime_error(
-                "[minijson_reader] this line should never be reached, "
-                "please file a bug report");
-        // LCOV_EXCL_STOP
         }
-
-        if (c == 0)
+        else if (c == '"')
         {
-            throw std::runtime_error( // LCOV_EXCL_LINE
-                "[minijson_reader] this line should never be reached, "
-                "please file a bug report");
+            m_in_string = true;
+        }
+        else if (c == '{' || c == '[')
+        {
+            ++m_depth;
+        }
+        else if (c == '}' || c == ']')
+        {
+            return --m_depth == 0;
         }
+
+        return false;
     }
 
-    context.end_nested();
+private:
+    std::size_t m_depth = 0;
+    bool m_in_string = false;
+    bool m_escaped = false;
+}; // class message_scanner
+
+inline bool is_opening_bracket(const char c) noexcept
+{
+    return c == '{' || c == '[';
+}
+
+// Returns the end of the message beginning at begin: the end of the object or
+// array, or the end of the buffer if it is something else, or unterminated,
+// so that the parse error is reported by the handler
+inline const char* find_message_end(
+    const char* begin,
+    const char* const end) noexcept
+{
+    if (!is_opening_bracket(*begin))
+    {
+        return end;
+    }
+
+    message_scanner scanner;
+    while (begin != end)
+    {
+        if (scanner.feed(*begin++))
+        {
+            break;
+        }
+    }
 
-    return context.read_offset() - read_offset;
+    return begin;
 }
 
-template<typename Context, typename Handler>
-std::size_t parse_array(Context& context, Handler&& handler)
+inline std::uint32_t read_frame_length(const char* const prefix) noexcept
 {
-    const std::size_t read_offset = context.read_offset();
-
-    const std::size_t nesting_level = context.nesting_level();
-    if (nesting_level > MJR_NESTING_LIMIT)
+    const auto byte = [prefix](const std::size_t i)
     {
-        throw parse_error(context, parse_error::EXCEEDED_NESTING_LIMIT);
-    }
+        return static_cast<std::uint32_t>(
+            static_cast<unsigned char>(prefix[i]));
+    };
 
-    char c = 0;
-    bool must_read = false;
+    return byte(0) << 24 | byte(1) << 16 | byte(2) << 8 | byte(3);
+}
 
-    detail::parse_init(context, c, must_read);
-    context.reset_nested_status();
+} // namespace detail
 
-    enum
-    {
-        OPENING_BRACKET,
-        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
-        VALUE,
-        COMMA_OR_CLOSING_BRACKET,
-        END
-    } state = OPENING_BRACKET;
+// Parses concatenated JSON objects or arrays, optionally separated by
+// whitespace, calling the handler once per message with a
+// const_buffer_context positioned at the beginning of the message. The
+// messages are delimited by tracking their nesting depth. The same context is
+// reused for all the messages. Returns the number of messages parsed.
+template<typename Handler>
+std::size_t parse_concatenated(
+    const char* const buffer,
+    const std::size_t length,
+    Handler&& handler)
+{
+    const_buffer_context context(nullptr, 0);
+    std::size_t index = 0;
 
-    while (state != END)
+    const char* const end = buffer + length;
+    const char* begin = std::find_if_not(buffer, end, detail::is_whitespace);
+    while (begin != end)
     {
-        if (context.nesting_level() != nesting_level)
-        {
-            throw parse_error(
-                context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
-        }
+        const char* const message_end = detail::find_message_end(begin, end);
+        detail::parse_record(
+            context, begin, message_end, index, begin - buffer, handler);
+        ++index;
 
-        if (must_read)
-        {
-            c = context.read();
-        }
+        begin = std::find_if_not(message_end, end, detail::is_whitespace);
+    }
 
-        must_read = true;
+    return index;
+}
+
+// Like the above, but reads the messages from a stream
+template<typename Handler>
+std::size_t parse_concatenated(std::istream& stream, Handler&& handler)
+{
+    const_buffer_context context(nullptr, 0);
+    std::size_t index = 0;
+    std::size_t offset = 0;
 
+    std::string message;
+    char c;
+    while (stream.get(c))
+    {
         if (detail::is_whitespace(c))
         {
+            ++offset;
             continue;
         }
 
-        switch (state)
+        message.assign(1, c);
+        if (detail::is_opening_bracket(c))
         {
-        case OPENING_BRACKET:
-            if (c != '[')
-            {
-                throw parse_error(
-                    context, parse_error::EXPECTED_OPENING_BRACKET);
-            }
-            state = VALUE_OR_CLOSING_BRACKET;
-            break;
-
-        case VALUE_OR_CLOSING_BRACKET:
-            if (c == ']')
-            {
-                state = END;
-                break;
-            }
-            [[fallthrough]];
-
-        case VALUE:
+            detail::message_scanner scanner;
+            scanner.feed(c);
+            while (stream.get(c))
             {
-                const value v = detail::parse_value(context, c, must_read);
-
-                // Try calling the handler with the context as the last argument
-                if constexpr (
-                    std::is_invocable_v<
-                        decltype(handler),
-                        decltype(v),
-                        decltype(context)>)
-                {
-                    std::invoke(handler, v, context);
-                }
-                else
+                message.push_back(c);
+                if (scanner.feed(c))
                 {
-                    // Now try again without the context. Generate a compile
-                    // error if it does not work.
-                    std::invoke(handler, v);
+                    break;
                 }
             }
-            state = COMMA_OR_CLOSING_BRACKET;
-            break;
-
-        case COMMA_OR_CLOSING_BRACKET:
-            if (c == ',')
-            {
-                state = VALUE;
-            }
-            else if (c == ']')
-            {
-                state = END;
-            }
-            else
+        }
+        else
+        {
+            // Not an object or array: the handler reports the error
+            while (stream.get(c))
             {
-                throw parse_error(
-                    context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+                message.push_back(c);
             }
-            break;
-
-        // LCOV_EXCL_START
-        case END:
-            throw std::runtime_error(
-                "[minijson_reader] this line should never be reached, "
-                "please file a bug report");
-        // LCOV_EXCL_STOP
         }
 
-        if (c == 0)
-        {
-            throw std::runtime_error( // LCOV_EXCL_LINE
-                "[minijson_reader] this line should never be reached, "
-                "please file a bug report");
-        }
+        detail::parse_record(
+            context,
+            message.data(),
+            message.data() + message.size(),
+            index,
+            offset,
+            handler);
+        ++index;
+        offset += message.size();
     }
 
-    context.end_nested();
-
-    return context.read_offset() - read_offset;
+    return index;
 }
 
-namespace detail
-{
-
-template<typename Context>
-class ignore final
+// Parses messages framed by their length in bytes, as a 32-bit big-endian
+// unsigned integer, calling the handler once per non-empty frame with a
+// const_buffer_context positioned at the beginning of the message. The same
+// context is reused for all the messages. Returns the number of messages
+// parsed. Throws framing_error if the buffer ends in the middle of a frame.
+template<typename Handler>
+std::size_t parse_length_prefixed(
+    const char* const buffer,
+    const std::size_t length,
+    Handler&& handler)
 {
-public:
-    explicit ignore(Context& context) noexcept
-    : m_context(context)
-    {
-    }
-
-    ignore(const ignore&) = delete;
-    ignore(ignore&&) = delete;
-    ignore& operator=(const ignore&) = delete;
-    ignore& operator=(ignore&&) = delete;
-
-    void operator()(std::string_view, value) const
-    {
-        (*this)();
-    }
+    const_buffer_context context(nullptr, 0);
+    std::size_t index = 0;
 
-    void operator()(value) const
+    std::size_t offset = 0;
+    while (offset < length)
     {
-        (*this)();
-    }
+        if (length - offset < 4)
+        {
+            throw framing_error(offset);
+        }
+        const std::size_t size = detail::read_frame_length(buffer + offset);
+        if (length - offset - 4 < size)
+        {
+            throw framing_error(offset);
+        }
 
-    void operator()() const
-    {
-        switch (m_context.nested_status())
+        const char* const begin = buffer + offset + 4;
+        if (detail::parse_record(
+            context, begin, begin + size, index, offset, handler))
         {
-        case Context::NESTED_STATUS_NONE:
-            break;
-        case Context::NESTED_STATUS_OBJECT:
-            parse_object(m_context, *this);
-            break;
-        case Context::NESTED_STATUS_ARRAY:
-            parse_array(m_context, *this);
-            break;
+            ++index;
         }
+
+        offset += 4 + size;
     }
 
-private:
-    Context& m_context;
-}; // class ignore
+    return index;
+}
 
-// Base for unhandled_field_error and missing_field_error
-class dispatcher_error_base : public std::exception
+// Like the above, but reads the frames from a stream
+template<typename Handler>
+std::size_t parse_length_prefixed(std::istream& stream, Handler&& handler)
 {
-public:
-    explicit dispatcher_error_base(const std::string_view field_name) noexcept
-    : m_field_name_truncated_length(
-        std::min(MAX_FIELD_NAME_LENGTH, field_name.size()))
-    {
-        std::copy_n(
-            field_name.begin(),
-            m_field_name_truncated_length,
-            m_field_name_truncated.begin());
-    }
+    const_buffer_context context(nullptr, 0);
+    std::size_t index = 0;
+    std::size_t offset = 0;
 
-    std::string_view field_name_truncated() const noexcept
+    std::string message;
+    char prefix[4];
+    while (stream.read(prefix, sizeof(prefix)) || stream.gcount() > 0)
     {
-        return {m_field_name_truncated.data(), m_field_name_truncated_length};
-    }
-
-    inline static constexpr std::size_t MAX_FIELD_NAME_LENGTH = 55;
+        if (stream.gcount() < 4)
+        {
+            throw framing_error(offset);
+        }
+        // The message grows as the data actually arrives, so that a corrupted
+        // length cannot cause a huge allocation
+        const std::size_t size = detail::read_frame_length(prefix);
+        message.clear();
+        while (message.size() < size)
+        {
+            const std::size_t chunk_offset = message.size();
+            const std::size_t chunk_size =
+                std::min<std::size_t>(size - chunk_offset, 1 << 20);
+            message.resize(chunk_offset + chunk_size);
+            if (!stream.read(
+                message.data() + chunk_offset,
+                static_cast<std::streamsize>(chunk_size)))
+            {
+                throw framing_error(offset);
+            }
+        }
 
-private:
-    // The temptation of storing a the field name here as a std::string_view
-    // is almost irresistible, but it would tie the validity of this exception
-    // to that of the dispatcher or, even worse, the parsing context
-    std::size_t m_field_name_truncated_length = 0;
-    std::array<char, MAX_FIELD_NAME_LENGTH + 1> m_field_name_truncated {};
-}; // class dispatcher_error_base
+        if (detail::parse_record(
+            context,
+            message.data(),
+            message.data() + message.size(),
+            index,
+            offset,
+            handler))
+        {
+            ++index;
+        }
 
-} // namespace detail
+        offset += 4 + message.size();
+    }
 
-template<typename Context>
-void ignore(Context& context)
-{
-    detail::ignore<Context> ignore(context);
-    ignore();
+    return index;
 }
 
-namespace handlers
-{
-
-namespace detail
-{
-
-// Tags to declare handler traits
-struct handler_tag {};
-struct field_specific_handler_tag {};
-struct required_field_handler_tag {};
-struct ignore_handler_tag {};
-
-// Base class for field-specific handlers
-template<typename Functor, typename... Tag>
-class field_specific_handler_base
-    : public handler_tag
-    , public field_specific_handler_tag
-    , public Tag...
+// A fixed-size pool of threads running batches of tasks. The thread calling
+// run() takes part in the work, so a pool of size 1 spawns no threads at all.
+class thread_pool final
 {
 public:
-    explicit field_specific_handler_base(
-        const std::string_view field_name,
-        Functor functor)
-    : m_field_name(field_name)
-    , m_functor(std::move(functor))
+    explicit thread_pool(
+        const std::size_t size = std::thread::hardware_concurrency())
     {
+        const std::size_t thread_count = std::max<std::size_t>(size, 1) - 1;
+        m_threads.reserve(thread_count);
+        try
+        {
+            for (std::size_t i = 1; i <= thread_count; ++i)
+            {
+                m_threads.emplace_back([this, i] { work(i); });
+            }
+        }
+        // LCOV_EXCL_START
+        catch (...)
+        {
+            stop();
+            throw;
+        }
+        // LCOV_EXCL_STOP
     }
 
-    std::string_view field_name() const noexcept
+    thread_pool(const thread_pool&) = delete;
+    thread_pool(thread_pool&&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    ~thread_pool() noexcept
     {
-        return m_field_name;
+        stop();
     }
 
-    const Functor& functor() const noexcept
+    // The number of workers, including the thread calling run()
+    std::size_t size() const noexcept
     {
-        return m_functor;
+        return m_threads.size() + 1;
     }
 
-    template<typename Context, typename... Target>
-    bool operator()(
-        const std::string_view parsed_field_name,
-        const value value,
-        Context& context,
-        Target&... target) const
+    // Calls task(worker_index, task_index) for each task_index in [0, count),
+    // with worker_index in [0, size()), and blocks until all the tasks are
+    // done. Workers claim tasks in increasing order of task_index. If a task
+    // throws, no more tasks are started, and the first exception is rethrown.
+    // Must not be called from within a task.
+    template<typename Task>
+    void run(const std::size_t count, Task&& task)
     {
-        if (parsed_field_name != m_field_name)
-        {
-            return false;
-        }
+        const std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+        batch current_batch(
+            count,
+            &task,
+            [](void* const task, const std::size_t worker, std::size_t index)
+            {
+                (*static_cast<std::remove_reference_t<Task>*>(task))(
+                    worker,
+                    index);
+            });
 
-        // Try calling the functor with the context as the last argument
-        if constexpr (
-            std::is_invocable_v<
-                decltype(m_functor),
-                decltype(target)...,
-                decltype(value),
-                decltype(context)>)
         {
-            std::invoke(m_functor, target..., value, context);
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_batch = &current_batch;
+            ++m_generation;
         }
-        else
+        m_wake.notify_all();
+
+        work_on(current_batch, 0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&] { return current_batch.active_workers == 0; });
+        m_batch = nullptr;
+
+        if (current_batch.error)
         {
-            // Now try again without the context. Generate a compile error if
-            // it does not work.
-            std::invoke(m_functor, target..., value);
+            std::rethrow_exception(current_batch.error);
         }
-
-        return true;
     }
 
 private:
-    std::string_view m_field_name;
-    Functor m_functor;
-}; // class field_specific_handler_base
+    struct batch final
+    {
+        using call_type = void (*)(void*, std::size_t, std::size_t);
+
+        explicit batch(
+            const std::size_t count,
+            void* const task,
+            const call_type call) noexcept
+        : count(count)
+        , task(task)
+        , call(call)
+        {
+        }
 
-// Base class for non-field-specific handlers
-template<typename Functor, typename... Tag>
-class any_handler_base : public handler_tag, public Tag...
-{
-public:
-    any_handler_base(Functor functor)
-    : m_functor(std::move(functor))
+        const std::size_t count;
+        void* const task;
+        const call_type call;
+        std::atomic<std::size_t> next {0};
+        std::size_t active_workers = 0; // guarded by m_mutex
+        std::exception_ptr error; // guarded by m_mutex
+    };
+
+    void work_on(batch& b, const std::size_t worker) noexcept
     {
+        for (;;)
+        {
+            const std::size_t index = b.next.fetch_add(1);
+            if (index >= b.count)
+            {
+                break;
+            }
+
+            try
+            {
+                b.call(b.task, worker, index);
+            }
+            catch (...)
+            {
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                if (!b.error)
+                {
+                    b.error = std::current_exception();
+                }
+                b.next = b.count;
+            }
+        }
     }
 
-    const Functor& functor() const noexcept
+    void work(const std::size_t worker)
     {
-        return m_functor;
+        std::size_t generation = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_wake.wait(
+                lock,
+                [&] { return m_stopping || m_generation != generation; });
+            if (m_stopping)
+            {
+                return;
+            }
+            generation = m_generation;
+
+            // The batch may already be over if the other workers were quick
+            batch* const b = m_batch;
+            if (b != nullptr)
+            {
+                ++b->active_workers;
+                lock.unlock();
+                work_on(*b, worker);
+                lock.lock();
+                if (--b->active_workers == 0)
+                {
+                    m_done.notify_all();
+                }
+            }
+        }
     }
 
-    template<typename Context, typename... Target>
-    bool operator()(
-        const std::string_view parsed_field_name,
-        const value value,
-        Context& context,
-        Target&... target) const
+    void stop() noexcept
     {
-        // Try calling the functor with the context as the last argument
-        if constexpr (
-            std::is_invocable_v<
-                decltype(m_functor),
-                decltype(target)...,
-                decltype(parsed_field_name),
-                decltype(value),
-                decltype(context)>)
         {
-            return std::invoke(
-                m_functor,
-                target...,
-                parsed_field_name,
-                value,
-                context);
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
         }
-        else
+        m_wake.notify_all();
+
+        for (std::thread& thread : m_threads)
         {
-            // Now try again without the context. Generate a compile error if
-            // it does not work.
-            return std::invoke(m_functor, target..., parsed_field_name, value);
+            thread.join();
         }
     }
 
-private:
-    Functor m_functor;
-}; // class any_handler_base
+    std::vector<std::thread> m_threads;
+    std::mutex m_run_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    batch* m_batch = nullptr;
+    std::size_t m_generation = 0;
+    bool m_stopping = false;
+}; // class thread_pool
+
+enum class delivery_order
+{
+    Ordered,
+    Unordered
+};
 
-// Functor for all handlers which ignore the field
-struct ignore_functor final
+namespace detail
 {
-    template<typename... Args>
-    bool operator()(Args&&... args) const
-    {
-        // The context is the last argument we are being passed, extract it
-        const auto args_tuple =
-            std::forward_as_tuple(std::forward<Args>(args)...);
-        auto& context = std::get<sizeof...(args) - 1>(args_tuple);
 
-        // Call ignore to discard the current value
-        ignore(context);
+// Input buffers are split into about this many chunks per worker, so that
+// workers which are done early can claim the chunks left to the others
+inline constexpr std::size_t chunks_per_worker = 8;
+inline constexpr std::size_t min_chunk_size = 16 * 1024;
 
-        return true;
+// Atomically lowers value to bound, unless it is lower already
+inline void atomic_min(
+    std::atomic<std::size_t>& value,
+    const std::size_t bound) noexcept
+{
+    std::size_t expected = value.load();
+    while (bound < expected && !value.compare_exchange_weak(expected, bound))
+    {
     }
-}; // struct ignore_functor
+}
 
-} // namespace handlers::detail
+inline std::size_t chunk_size(
+    const thread_pool& pool,
+    const std::size_t length) noexcept
+{
+    return std::max(length / (pool.size() * chunks_per_worker), min_chunk_size);
+}
 
-template<typename Functor>
-class handler final
-    : public detail::field_specific_handler_base<
-        Functor,
-        detail::required_field_handler_tag>
+// Splits the buffer into chunks of at least chunk_size bytes (except for the
+// last one), each ending right after a newline
+inline std::vector<std::pair<const char*, const char*>> split_lines(
+    const char* const buffer,
+    const std::size_t length,
+    const std::size_t chunk_size)
 {
-public:
-    handler(const std::string_view field_name, Functor functor)
-    : detail::field_specific_handler_base<
-        Functor,
-        detail::required_field_handler_tag>(
-            field_name,
-            std::move(functor))
+    std::vector<std::pair<const char*, const char*>> chunks;
+
+    const char* begin = buffer;
+    const char* const end = buffer + length;
+    while (begin != end)
     {
+        const char* chunk_end =
+            begin + std::min<std::size_t>(chunk_size, end - begin) - 1;
+        chunk_end = static_cast<const char*>(
+            std::memchr(chunk_end, '\n', end - chunk_end));
+        chunk_end = (chunk_end != nullptr) ? chunk_end + 1 : end;
+
+        chunks.emplace_back(begin, chunk_end);
+        begin = chunk_end;
     }
-}; // class handler
 
-template<typename Functor>
-class optional_handler final
-    : public detail::field_specific_handler_base<Functor>
+    return chunks;
+}
+
+// Parses the lines of each chunk in parallel, calling
+// handler(worker, chunk, context) for each record and chunk_done(chunk,
+// failed) after each chunk. Errors are reported like the sequential
+// parse_ndjson() would: chunks following a failed one are not parsed, while
+// preceding chunks always are.
+template<typename Handler, typename ChunkDone>
+std::size_t parse_ndjson_chunks(
+    thread_pool& pool,
+    const char* const buffer,
+    const std::vector<std::pair<const char*, const char*>>& chunks,
+    Handler& handler,
+    ChunkDone& chunk_done)
 {
-public:
-    optional_handler(const std::string_view field_name, Functor functor)
-    : detail::field_specific_handler_base<Functor>(
-        field_name,
-        std::move(functor))
+    struct chunk_state final
+    {
+        std::size_t records = 0;
+        std::exception_ptr error;
+        std::size_t error_offset = 0;
+    };
+
+    std::vector<chunk_state> states(chunks.size());
+    std::atomic<std::size_t> first_failed(chunks.size());
+
+    std::vector<const_buffer_context> contexts;
+    contexts.reserve(pool.size());
+    for (std::size_t i = 0; i < pool.size(); ++i)
     {
+        contexts.emplace_back(nullptr, 0);
     }
-}; // class optional_handler
 
-template<typename Functor>
-class any_handler final : public detail::any_handler_base<Functor>
-{
-public:
-    any_handler(Functor functor)
-    : detail::any_handler_base<Functor>(std::move(functor))
+    pool.run(
+        chunks.size(),
+        [&](const std::size_t worker, const std::size_t chunk)
+        {
+            if (chunk > first_failed.load())
+            {
+                return;
+            }
+
+            const auto record_handler =
+                [&](const_buffer_context& context)
+                {
+                    handler(worker, chunk, context);
+                };
+
+            chunk_state& state = states[chunk];
+            const char* line = nullptr;
+            try
+            {
+                for_each_line(
+                    chunks[chunk].first,
+                    chunks[chunk].second,
+                    [&](const char* const begin, const char* const end)
+                    {
+                        line = begin;
+                        if (parse_line(
+                            contexts[worker], begin, end, record_handler))
+                        {
+                            ++state.records;
+                        }
+                    });
+            }
+            catch (...)
+            {
+                state.error = std::current_exception();
+                state.error_offset = line - buffer;
+
+                atomic_min(first_failed, chunk);
+            }
+
+            chunk_done(chunk, static_cast<bool>(state.error));
+        });
+
+    std::size_t records = 0;
+    for (const chunk_state& state : states)
     {
+        if (state.error)
+        {
+            try
+            {
+                std::rethrow_exception(state.error);
+            }
+            catch (...)
+            {
+                std::throw_with_nested(
+                    record_error(records + state.records, state.error_offset));
+            }
+        }
+        records += state.records;
     }
-}; // class any_handler
 
-class ignore_handler final
-    : public detail::field_specific_handler_base<
-        detail::ignore_functor,
-        detail::ignore_handler_tag>
+    return records;
+}
+
+} // namespace detail
+
+// Like the sequential parse_ndjson(), but parses the lines in parallel on
+// the workers of the pool, each using its own context. The handler is called
+// concurrently from different threads.
+template<typename Handler>
+std::size_t parse_ndjson(
+    thread_pool& pool,
+    const char* const buffer,
+    const std::size_t length,
+    Handler&& handler)
 {
-public:
-    ignore_handler(const std::string_view field_name)
-    : detail::field_specific_handler_base<
-        detail::ignore_functor,
-        detail::ignore_handler_tag>(
-            field_name,
-            detail::ignore_functor())
+    const auto chunks = detail::split_lines(
+        buffer,
+        length,
+        detail::chunk_size(pool, length));
+
+    auto record_handler =
+        [&](std::size_t, std::size_t, const_buffer_context& context)
+        {
+            handler(context);
+        };
+    auto chunk_done = [](std::size_t, bool) {};
+
+    return detail::parse_ndjson_chunks(
+        pool, buffer, chunks, record_handler, chunk_done);
+}
+
+// Like the above, but the values returned by the handler for each record are
+// passed to the consumer, which is never called concurrently. With
+// delivery_order::Ordered, the consumer receives the values in the order of
+// the records; with delivery_order::Unordered, it receives them as soon as
+// they are available, in no particular order.
+template<typename Handler, typename Consumer>
+std::size_t parse_ndjson(
+    thread_pool& pool,
+    const char* const buffer,
+    const std::size_t length,
+    Handler&& handler,
+    Consumer&& consumer,
+    const delivery_order order = delivery_order::Ordered)
+{
+    using result_type = std::decay_t<
+        std::invoke_result_t<Handler&, const_buffer_context&>>;
+
+    const auto chunks = detail::split_lines(
+        buffer,
+        length,
+        detail::chunk_size(pool, length));
+
+    std::vector<std::vector<result_type>> results(chunks.size());
+    enum chunk_status : char
     {
-    }
-}; // class ignore_handler
+        PENDING,
+        DONE,
+        FAILED
+    };
+    std::vector<chunk_status> statuses(chunks.size(), PENDING);
+    std::size_t next_chunk = 0;
+    bool stopped = false;
+    std::mutex mutex;
 
-class ignore_any_handler final
-    : public detail::any_handler_base<
-        detail::ignore_functor,
-        detail::ignore_handler_tag>
+    auto record_handler =
+        [&](std::size_t, const std::size_t chunk, const_buffer_context& ctx)
+        {
+            results[chunk].push_back(handler(ctx));
+        };
+
+    const auto deliver = [&](const std::size_t chunk)
+    {
+        for (result_type& result : results[chunk])
+        {
+            consumer(std::move(result));
+        }
+        results[chunk] = {};
+    };
+
+    auto chunk_done = [&](const std::size_t chunk, const bool failed)
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        try
+        {
+            if (order == delivery_order::Unordered)
+            {
+                if (!stopped)
+                {
+                    deliver(chunk);
+                }
+            }
+            else
+            {
+                // Deliver all the chunks which are now ready in order,
+                // stopping after a failed one like the sequential
+                // parse_ndjson() would
+                statuses[chunk] = failed ? FAILED : DONE;
+                while (!stopped
+                    && next_chunk < chunks.size()
+                    && statuses[next_chunk] != PENDING)
+                {
+                    deliver(next_chunk);
+                    stopped = (statuses[next_chunk] == FAILED);
+                    ++next_chunk;
+                }
+            }
+        }
+        catch (...)
+        {
+            stopped = true;
+            throw;
+        }
+    };
+
+    return detail::parse_ndjson_chunks(
+        pool, buffer, chunks, record_handler, chunk_done);
+}
+
+namespace detail
 {
-public:
-    ignore_any_handler()
-    : detail::any_handler_base<
-        detail::ignore_functor,
-        detail::ignore_handler_tag>(
-            detail::ignore_functor())
+
+// Calls f(i, inside) for each bracket, brace and comma in [begin, end) of the
+// buffer, where inside tells whether it is inside a string assuming that the
+// chunk does not begin inside one, until f returns true. A quote delimits a
+// string unless it follows an odd number of backslashes, which in valid
+// messages only appear inside strings. Returns whether the string state at
+// the end of the chunk differs from the one at its beginning.
+template<typename Function>
+bool for_each_structural(
+    const char* const buffer,
+    const std::size_t begin,
+    const std::size_t end,
+    Function&& f)
+{
+    // Backslashes preceding the chunk may escape its first character
+    std::size_t preceding_backslashes = 0;
+    while (preceding_backslashes < begin
+        && buffer[begin - preceding_backslashes - 1] == '\\')
     {
+        ++preceding_backslashes;
     }
-}; // class ignore_any_handler
+    bool escaped = (preceding_backslashes % 2 != 0);
+    bool inside = false;
 
-template<typename Handler, typename Enable = void>
-struct traits;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        switch (buffer[i])
+        {
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ',':
+            if (f(i, inside))
+            {
+                return inside;
+            }
+            break;
 
-template<typename Handler>
-struct traits<
-    Handler,
-    std::enable_if_t<
-        std::is_base_of_v<
-            detail::handler_tag,
-            std::remove_reference_t<Handler>>>> final
+        case '"':
+            inside = (inside != !escaped);
+            break;
+
+        case '\\':
+            escaped = !escaped;
+            continue;
+        }
+        escaped = false;
+    }
+
+    return inside;
+}
+
+// What split_array() needs to know about a chunk of the buffer before the
+// state at its beginning is known. The arrays are indexed by whether the
+// chunk begins inside a string.
+struct chunk_summary final
 {
-    static inline constexpr bool is_field_specific =
-        std::is_base_of_v<
-            detail::field_specific_handler_tag,
-            std::remove_reference_t<Handler>>;
+    static constexpr std::ptrdiff_t NO_DEPTH =
+        std::numeric_limits<std::ptrdiff_t>::max();
+    static constexpr std::size_t NO_OFFSET =
+        std::numeric_limits<std::size_t>::max();
 
-    static inline constexpr bool is_required_field =
-        std::is_base_of_v<
-            detail::required_field_handler_tag,
-            std::remove_reference_t<Handler>>;
+    // Change in nesting depth from the beginning to the end of the chunk
+    std::ptrdiff_t depth_change[2] = {0, 0};
 
-    static inline constexpr bool is_ignore =
-        std::is_base_of_v<
-            detail::ignore_handler_tag,
-            std::remove_reference_t<Handler>>;
+    // Lowest depth, relative to the beginning of the chunk, reached by a
+    // closing bracket or brace within the chunk
+    std::ptrdiff_t lowest_depth[2] = {NO_DEPTH, NO_DEPTH};
+
+    bool flips_string_state = false; // odd number of unescaped quotes
+
+    // Known once the chunks preceding this one have been summarized
+    bool begins_inside_string = false;
+    std::ptrdiff_t initial_depth = 0;
+
+    // The first comma at depth 1, and the closing bracket of the array, if
+    // within the chunk
+    std::size_t first_comma = NO_OFFSET;
+    std::size_t array_end = NO_OFFSET;
 };
 
-} // namespace handlers
+inline void summarize_chunk(
+    const char* const buffer,
+    const std::size_t begin,
+    const std::size_t end,
+    chunk_summary& summary)
+{
+    std::ptrdiff_t depth[2] = {0, 0};
+
+    summary.flips_string_state = for_each_structural(
+        buffer,
+        begin,
+        end,
+        [&](const std::size_t i, const bool inside)
+        {
+            // Outside a string under one assumption about the beginning of
+            // the chunk iff inside a string under the other
+            const std::size_t assumption = inside ? 1 : 0;
+            switch (buffer[i])
+            {
+            case '{':
+            case '[':
+                ++depth[assumption];
+                break;
+
+            case '}':
+            case ']':
+                --depth[assumption];
+                summary.lowest_depth[assumption] = std::min(
+                    summary.lowest_depth[assumption],
+                    depth[assumption]);
+                break;
+            }
+            return false;
+        });
+
+    summary.depth_change[0] = depth[0];
+    summary.depth_change[1] = depth[1];
+}
 
-class unhandled_field_error final : public detail::dispatcher_error_base
+// Finds the first comma at depth 1 in a chunk whose initial state is known,
+// and the closing bracket of the array if contains_array_end
+inline void find_split_points(
+    const char* const buffer,
+    const std::size_t begin,
+    const std::size_t end,
+    const bool contains_array_end,
+    chunk_summary& summary)
 {
-public:
-    using detail::dispatcher_error_base::dispatcher_error_base;
+    std::ptrdiff_t depth = summary.initial_depth;
 
-    virtual const char* what() const noexcept override
-    {
-        return "a JSON field was not handled";
-    }
-}; // class unhandled_field_error
+    for_each_structural(
+        buffer,
+        begin,
+        end,
+        [&](const std::size_t i, const bool inside)
+        {
+            if (inside != summary.begins_inside_string)
+            {
+                return false;
+            }
 
-class missing_field_error final : public detail::dispatcher_error_base
+            switch (buffer[i])
+            {
+            case '{':
+            case '[':
+                ++depth;
+                break;
+
+            case '}':
+            case ']':
+                if (--depth == 0)
+                {
+                    summary.array_end = i;
+                    return true;
+                }
+                break;
+
+            case ',':
+                if (depth == 1
+                    && summary.first_comma == chunk_summary::NO_OFFSET)
+                {
+                    summary.first_comma = i;
+                    return !contains_array_end;
+                }
+                break;
+            }
+            return false;
+        });
+}
+
+// Stands in for a context when a parse_error must be reported at an offset
+// other than the one of the context it was detected by
+struct offset_context final
 {
-public:
-    using detail::dispatcher_error_base::dispatcher_error_base;
+    std::size_t offset;
 
-    virtual const char* what() const noexcept override
+    std::size_t read_offset() const noexcept
     {
-        return "at least one required JSON field is missing";
+        return offset;
     }
-}; // class missing_field_error
+};
 
-template<typename Dispatcher, typename... Target>
-class dispatcher_run final
+// Splits the elements of the top-level array in the buffer into chunks of
+// roughly chunk_size bytes, without validating it. Each chunk spans from the
+// first character after the opening bracket or comma preceding its first
+// element to the comma or closing bracket following its last element, both
+// included (except if the array is unterminated).
+//
+// The buffer is scanned in parallel, in chunks of chunk_size bytes. Since a
+// chunk can begin inside a string, the first scan summarizes each chunk under
+// both assumptions; a quick pass over the summaries in order then finds out
+// the state at the beginning of each chunk, so that a second scan can find
+// the first comma at depth 1 in each chunk, where the array is split. Only a
+// summary per chunk is kept.
+inline std::vector<std::pair<std::size_t, std::size_t>> split_array(
+    thread_pool& pool,
+    const char* const buffer,
+    const std::size_t length,
+    const std::size_t chunk_size)
 {
-public:
-    dispatcher_run(Dispatcher& dispatcher, Target&... target) noexcept
-    : m_dispatcher(dispatcher)
-    , m_targets(target...)
+    const std::size_t opening_bracket = std::find_if_not(
+        buffer, buffer + length, is_whitespace) - buffer;
+    if (opening_bracket == length || buffer[opening_bracket] != '[')
     {
+        throw parse_error(
+            offset_context {std::min(opening_bracket + 1, length)},
+            parse_error::EXPECTED_OPENING_BRACKET);
     }
 
-    dispatcher_run(const dispatcher_run&) = delete;
-    dispatcher_run(dispatcher_run&&) = default;
-    dispatcher_run& operator=(const dispatcher_run&) = delete;
-    dispatcher_run& operator=(dispatcher_run&&) = delete;
+    const std::size_t chunk_count = (length + chunk_size - 1) / chunk_size;
+    std::vector<chunk_summary> summaries(chunk_count);
+    const auto chunk_end = [&](const std::size_t chunk)
+    {
+        return std::min((chunk + 1) * chunk_size, length);
+    };
 
-    template<typename Context>
-    void operator()(
-        const std::string_view parsed_field_name,
-        const value value,
-        Context& context)
+    pool.run(
+        chunk_count,
+        [&](std::size_t, const std::size_t chunk)
+        {
+            summarize_chunk(
+                buffer,
+                chunk * chunk_size,
+                chunk_end(chunk),
+                summaries[chunk]);
+        });
+
+    // Only whitespace precedes the opening bracket, so the first chunk begins
+    // outside any string at depth 0
+    std::size_t last_chunk = chunk_count - 1;
+    bool inside = false;
+    std::ptrdiff_t depth = 0;
+    for (std::size_t chunk = 0; chunk <= last_chunk; ++chunk)
     {
-        // AFAIK, in pre-C++20 we are forced to resort to a helper function
-        // rather than use a template lambda which would be more readable
-        call_helper(
-            parsed_field_name,
-            value,
-            context,
-            std::make_index_sequence<Dispatcher::n_handlers>());
+        chunk_summary& summary = summaries[chunk];
+        const std::size_t assumption = inside ? 1 : 0;
+        summary.begins_inside_string = inside;
+        summary.initial_depth = depth;
+        if (summary.lowest_depth[assumption] != chunk_summary::NO_DEPTH
+            && depth + summary.lowest_depth[assumption] <= 0)
+        {
+            last_chunk = chunk; // the array is closed within this chunk
+        }
+        depth += summary.depth_change[assumption];
+        inside = (inside != summary.flips_string_state);
     }
 
-    template<typename Inspector>
-    void inspect(Inspector&& inspector) const
+    pool.run(
+        last_chunk + 1,
+        [&](std::size_t, const std::size_t chunk)
+        {
+            find_split_points(
+                buffer,
+                chunk * chunk_size,
+                chunk_end(chunk),
+                chunk == last_chunk,
+                summaries[chunk]);
+        });
+
+    std::vector<std::pair<std::size_t, std::size_t>> chunks;
+    std::size_t chunk_begin = opening_bracket + 1;
+    for (std::size_t chunk = 0; chunk <= last_chunk; ++chunk)
     {
-        // AFAIK, in pre-C++20 we are forced to resort to a helper function
-        // rather than use a template lambda which would be more readable
-        inspect_helper(
-            inspector,
-            std::make_index_sequence<Dispatcher::n_handlers>());
+        const chunk_summary& summary = summaries[chunk];
+        if (summary.first_comma != chunk_summary::NO_OFFSET)
+        {
+            chunks.emplace_back(chunk_begin, summary.first_comma + 1);
+            chunk_begin = summary.first_comma + 1;
+        }
     }
 
-    void enforce_required() const
+    const std::size_t array_end = summaries[last_chunk].array_end;
+    chunks.emplace_back(
+        chunk_begin,
+        array_end != chunk_summary::NO_OFFSET ? array_end + 1 : length);
+
+    return chunks;
+}
+
+// Parses the elements in a chunk found by split_array(), like parse_array()
+// would. The context must be positioned at the beginning of the chunk.
+template<typename Handler>
+void parse_array_chunk(
+    const_buffer_context& context,
+    Handler& handler,
+    const bool first,
+    const bool last)
+{
+    char c = 0;
+    bool must_read = true;
+
+    enum
     {
-        inspect(
-            [](const auto& handler, const std::size_t handle_count)
+        VALUE_OR_CLOSING_BRACKET, // in case the array is empty
+        VALUE,
+        COMMA_OR_CLOSING_BRACKET
+    } state = first ? VALUE_OR_CLOSING_BRACKET : VALUE;
+
+    for (;;)
+    {
+        if (context.nesting_level() != 0)
+        {
+            throw parse_error(
+                context, parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED);
+        }
+
+        if (must_read)
+        {
+            c = context.read();
+        }
+
+        must_read = true;
+
+        if (is_whitespace(c))
+        {
+            continue;
+        }
+
+        switch (state)
+        {
+        case VALUE_OR_CLOSING_BRACKET:
+            if (c == ']')
+            {
+                return;
+            }
+            [[fallthrough]];
+
+        case VALUE:
             {
+                const value v = parse_value(context, c, must_read);
+
                 if constexpr (
-                    handlers::traits<decltype(handler)>::is_required_field)
+                    std::is_invocable_v<
+                        decltype(handler),
+                        decltype(v),
+                        decltype(context)>)
                 {
-                    if (handle_count == 0)
-                    {
-                        throw missing_field_error(handler.field_name());
-                    }
+                    std::invoke(handler, v, context);
                 }
-            });
-    }
+                else
+                {
+                    std::invoke(handler, v);
+                }
+            }
+            state = COMMA_OR_CLOSING_BRACKET;
+            break;
 
-private:
-    // Helper of operator()() to get a sequence of indices
-    template<typename Context, std::size_t... I>
-    void call_helper(
-        const std::string_view parsed_field_name,
-        const value value,
-        Context& context,
-        std::index_sequence<I...>)
-    {
-        if (!(... || offer_to_handler<I>(parsed_field_name, value, context)))
-        {
-            throw unhandled_field_error(parsed_field_name);
+        case COMMA_OR_CLOSING_BRACKET:
+            // All the chunks but the last end with the comma following their
+            // last element
+            if (c == ','
+                && (last
+                    || context.read_offset() < context.read_buffer_length()))
+            {
+                state = VALUE;
+            }
+            else if (c == ',' || c == ']')
+            {
+                return;
+            }
+            else
+            {
+                throw parse_error(
+                    context, parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+            }
+            break;
         }
     }
+}
 
-    template<typename Inspector, std::size_t... I>
-    void inspect_helper(Inspector& inspector, std::index_sequence<I...>) const
+template<typename Handler>
+std::size_t parse_array_chunks(
+    thread_pool& pool,
+    const char* const buffer,
+    const std::size_t length,
+    const std::size_t chunk_size,
+    Handler& handler)
+{
+    const auto chunks = split_array(pool, buffer, length, chunk_size);
+
+    std::vector<std::exception_ptr> errors(chunks.size());
+    std::atomic<std::size_t> first_failed(chunks.size());
+
+    std::vector<const_buffer_context> contexts;
+    contexts.reserve(pool.size());
+    for (std::size_t i = 0; i < pool.size(); ++i)
     {
-        (..., std::invoke(
-            inspector,
-            std::get<I>(m_dispatcher.handlers()),
-            std::get<I>(m_handle_count)));
+        contexts.emplace_back(nullptr, 0);
     }
 
-    // Offer this field to the I-th handler of the dispatcher.
-    // If the handler chooses to handle it, then increment the I-th
-    // m_handle_count entry and return true. Otherwise, return false.
-    template<std::size_t I, typename Context>
-    bool offer_to_handler(
-        const std::string_view parsed_field_name,
-        const value value,
-        Context& context)
-    {
-        std::size_t& handle_count = std::get<I>(m_handle_count);
-        auto& handler = std::get<I>(m_dispatcher.handlers());
+    pool.run(
+        chunks.size(),
+        [&](const std::size_t worker, const std::size_t chunk)
+        {
+            if (chunk > first_failed.load())
+            {
+                return;
+            }
 
-        return std::apply(
-            [&](auto&... target)
+            const auto [begin, end] = chunks[chunk];
+            const_buffer_context& context = contexts[worker];
+            context.reset(buffer + begin, end - begin);
+            try
             {
-                if (handler(parsed_field_name, value, context, target...))
-                {
-                    ++handle_count;
-                    return true;
-                }
-                return false;
-            },
-            m_targets);
+                parse_array_chunk(
+                    context,
+                    handler,
+                    chunk == 0,
+                    chunk + 1 == chunks.size());
+            }
+            catch (const parse_error& e)
+            {
+                // Report the error at its offset in the whole buffer
+                errors[chunk] = std::make_exception_ptr(
+                    parse_error(
+                        offset_context {begin + context.read_offset()},
+                        e.reason()));
+                atomic_min(first_failed, chunk);
+            }
+            catch (...)
+            {
+                errors[chunk] = std::current_exception();
+                atomic_min(first_failed, chunk);
+            }
+        });
+
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
     }
 
-    Dispatcher& m_dispatcher;
-    std::tuple<Target&...> m_targets;
+    return chunks.back().second;
+}
 
-    // Tracks how many times the i-th handler decided to handle a field
-    std::array<std::size_t, Dispatcher::n_handlers> m_handle_count {};
-}; // class dispatcher_run
+} // namespace detail
 
-template<typename... Handler>
-class dispatcher final
+// Like parse_array(), but parses the elements of the top-level array in the
+// buffer in parallel on the workers of the pool, each using its own context.
+// The handler is called concurrently from different threads, and can take
+// the worker's context as the second argument to parse nested objects and
+// arrays.
+template<typename Handler>
+std::size_t parse_array(
+    thread_pool& pool,
+    const char* const buffer,
+    const std::size_t length,
+    Handler&& handler)
+{
+    return detail::parse_array_chunks(
+        pool,
+        buffer,
+        length,
+        detail::chunk_size(pool, length),
+        handler);
+}
+
+// The outcome of parsing one message of a batch by means of parse_batch()
+class batch_result final
 {
 public:
-    dispatcher(Handler... handler)
-    : m_handlers {std::move(handler)...}
+    explicit batch_result() noexcept = default;
+
+    explicit batch_result(const std::exception_ptr& error) noexcept
+    : m_error(error)
     {
     }
 
-    template<typename Context, typename... Target>
-    void run(Context& context, Target&... target) const
+    explicit batch_result(const parse_error& error) noexcept
+    : m_error(std::make_exception_ptr(error))
+    , m_parse_error(error)
     {
-        dispatcher_run run(*this, target...);
-        minijson::parse_object(context, run);
-        run.enforce_required();
     }
 
-    const std::tuple<Handler...>& handlers() const noexcept
+    bool ok() const noexcept
     {
-        return m_handlers;
+        return !m_error;
     }
 
-    inline static constexpr std::size_t n_handlers = sizeof...(Handler);
+    // The exception thrown while parsing the message, if any
+    const std::exception_ptr& error() const noexcept
+    {
+        return m_error;
+    }
+
+    // The parse_error thrown while parsing the message, if any
+    const parse_error* parse_failure() const noexcept
+    {
+        return m_parse_error ? &*m_parse_error : nullptr;
+    }
 
 private:
-    std::tuple<Handler...> m_handlers;
-}; // class dispatcher
+    std::exception_ptr m_error;
+    std::optional<parse_error> m_parse_error;
+}; // class batch_result
+
+// Parses a batch of messages, held in a random-access container (e.g. a
+// std::vector<std::string_view>), in parallel on the workers of the pool,
+// each using its own context. The handler is called concurrently as
+// handler(index, context) for each message, and must parse it. Errors do not
+// stop the batch, but are reported in the result of each message.
+template<typename Messages, typename Handler>
+std::vector<batch_result> parse_batch(
+    thread_pool& pool,
+    const Messages& messages,
+    Handler&& handler)
+{
+    std::vector<batch_result> results(std::size(messages));
+
+    std::vector<const_buffer_context> contexts;
+    contexts.reserve(pool.size());
+    for (std::size_t i = 0; i < pool.size(); ++i)
+    {
+        contexts.emplace_back(nullptr, 0);
+    }
+
+    pool.run(
+        results.size(),
+        [&](const std::size_t worker, const std::size_t index)
+        {
+            const std::string_view message = messages[index];
+            const_buffer_context& context = contexts[worker];
+            try
+            {
+                context.reset(message.data(), message.size());
+                handler(index, context);
+                detail::check_end_of_message(context);
+            }
+            catch (const parse_error& e)
+            {
+                results[index] = batch_result(e);
+            }
+            catch (...)
+            {
+                results[index] = batch_result(std::current_exception());
+            }
+        });
+
+    return results;
+}
+
+// Like the above, but parses each message by means of the dispatcher, with
+// targets[index] as the target
+template<typename Messages, typename... Handler, typename Targets>
+std::vector<batch_result> parse_batch(
+    thread_pool& pool,
+    const Messages& messages,
+    const dispatcher<Handler...>& dispatcher,
+    Targets& targets)
+{
+    return parse_batch(
+        pool,
+        messages,
+        [&](const std::size_t index, const_buffer_context& context)
+        {
+            dispatcher.run(context, targets[index]);
+        });
+}
 
 } // namespace minijson
 
 #endif // MINIJSON_READER_H
 
-#undef MJR_STRINGIFY
-#undef MJR_STRINGIFY_HELPER
@@ -0,0 +1,294 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+std::string encode_base64(
+    const std::string_view data,
+    const minijson::base64_alphabet alphabet,
+    const bool padding)
+{
+    const char* const characters =
+        alphabet == minijson::base64_alphabet::Standard ?
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" :
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    std::string result;
+    for (std::size_t i = 0; i < data.size(); i += 3)
+    {
+        const std::size_t size = std::min<std::size_t>(3, data.size() - i);
+        std::uint32_t quantum = 0;
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            quantum <<= 8;
+            if (j < size)
+            {
+                quantum |= static_cast<unsigned char>(data[i + j]);
+            }
+        }
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            if (j <= size)
+            {
+                result += characters[(quantum >> (18 - 6 * j)) & 0x3f];
+            }
+            else if (padding)
+            {
+                result += '=';
+            }
+        }
+    }
+
+    return result;
+}
+
+std::string decode(
+    const std::string_view encoded,
+    const minijson::base64_alphabet alphabet =
+        minijson::base64_alphabet::Standard)
+{
+    std::string result(minijson::base64_decoded_size(encoded.size()), '?');
+    result.resize(
+        minijson::decode_base64(
+            encoded,
+            result.data(),
+            result.size(),
+            alphabet));
+
+    return result;
+}
+
+// Decodes the text in chunks of the given sizes, used cyclically
+std::string decode_chunked(
+    const std::string_view encoded,
+    const std::vector<std::size_t>& chunk_sizes,
+    const minijson::base64_alphabet alphabet)
+{
+    minijson::base64_decoder decoder(alphabet);
+    std::string result;
+    std::size_t offset = 0;
+    for (std::size_t i = 0; offset < encoded.size(); ++i)
+    {
+        const std::string_view chunk =
+            encoded.substr(offset, chunk_sizes[i % chunk_sizes.size()]);
+        const std::size_t size = result.size();
+        result.resize(size + minijson::base64_decoded_size(chunk.size()));
+        result.resize(size + decoder.update(chunk, result.data() + size));
+        offset += chunk.size();
+    }
+    char tail[2];
+    result.append(tail, decoder.finish(tail));
+
+    return result;
+}
+
+} // namespace
+
+TEST(minijson_base64, rfc4648)
+{
+    ASSERT_EQ("", decode(""));
+    ASSERT_EQ("f", decode("Zg=="));
+    ASSERT_EQ("fo", decode("Zm8="));
+    ASSERT_EQ("foo", decode("Zm9v"));
+    ASSERT_EQ("foob", decode("Zm9vYg=="));
+    ASSERT_EQ("fooba", decode("Zm9vYmE="));
+    ASSERT_EQ("foobar", decode("Zm9vYmFy"));
+
+    // Padding is optional
+    ASSERT_EQ("f", decode("Zg"));
+    ASSERT_EQ("fo", decode("Zm8"));
+    ASSERT_EQ("fooba", decode("Zm9vYmE"));
+
+    ASSERT_EQ(0U, minijson::base64_decoded_size(0));
+    ASSERT_EQ(3U, minijson::base64_decoded_size(2));
+    ASSERT_EQ(3U, minijson::base64_decoded_size(4));
+    ASSERT_EQ(6U, minijson::base64_decoded_size(5));
+}
+
+TEST(minijson_base64, round_trip)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (const auto alphabet :
+        {minijson::base64_alphabet::Standard, minijson::base64_alphabet::Url})
+    {
+        for (std::size_t length = 0; length < 300; ++length)
+        {
+            SCOPED_TRACE(length);
+
+            std::string data;
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                data += static_cast<char>(byte(generator));
+            }
+
+            for (const bool padding : {true, false})
+            {
+                const std::string encoded =
+                    encode_base64(data, alphabet, padding);
+                ASSERT_EQ(data, decode(encoded, alphabet));
+                ASSERT_EQ(data, decode_chunked(encoded, {1}, alphabet));
+                ASSERT_EQ(data, decode_chunked(encoded, {5, 17}, alphabet));
+                ASSERT_EQ(data, decode_chunked(encoded, {3, 32}, alphabet));
+            }
+        }
+    }
+}
+
+TEST(minijson_base64, invalid)
+{
+    const auto check_invalid = [](
+        const std::string_view encoded,
+        const minijson::base64_alphabet alphabet =
+            minijson::base64_alphabet::Standard)
+    {
+        SCOPED_TRACE(encoded);
+        ASSERT_THROW(decode(encoded, alphabet), minijson::bad_value_cast);
+        ASSERT_THROW(
+            decode_chunked(encoded, {1}, alphabet),
+            minijson::bad_value_cast);
+    };
+
+    check_invalid("Zm9v!");
+    check_invalid("Zm9vZm9vZm9vZm9vZm9v!m9vZm9v"); // in the fast path
+    check_invalid("Zm9v Zm9v");
+    check_invalid("-_-_");
+    check_invalid("+/+/", minijson::base64_alphabet::Url);
+
+    // Truncated
+    check_invalid("Z");
+    check_invalid("Zm9vZ");
+    check_invalid("Zg=");
+
+    // Misplaced padding
+    check_invalid("=");
+    check_invalid("Z===");
+    check_invalid("Zg=A");
+    check_invalid("Zg==Zg==");
+    check_invalid("Zm8==");
+
+    // After an error, the decoder can be reused
+    minijson::base64_decoder decoder;
+    char output[16];
+    ASSERT_EQ(0U, decoder.update("Zg=", output));
+    ASSERT_THROW(decoder.finish(output), minijson::bad_value_cast);
+    ASSERT_EQ(3U, decoder.update("Zm9v", output));
+    ASSERT_EQ(0U, decoder.finish(output));
+    ASSERT_EQ("foo", std::string_view(output, 3));
+
+    // The output buffer must be large enough
+    ASSERT_THROW(
+        minijson::decode_base64("Zg==", output, 2),
+        std::length_error);
+}
+
+TEST(minijson_base64, value)
+{
+    char buffer[] = "{\"data\":\"Zm9vYmFy\",\"url\":\"-_8\",\"n\":1}";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+
+    std::vector<std::string> decoded;
+    minijson::parse_object(
+        context,
+        [&](const std::string_view name, const minijson::value v)
+        {
+            char output[16];
+            if (name == "n")
+            {
+                ASSERT_THROW(
+                    minijson::decode_base64(v, output, sizeof(output)),
+                    minijson::bad_value_cast);
+                return;
+            }
+
+            const minijson::base64_alphabet alphabet = name == "url" ?
+                minijson::base64_alphabet::Url :
+                minijson::base64_alphabet::Standard;
+            decoded.emplace_back(
+                output,
+                minijson::decode_base64(v, output, sizeof(output), alphabet));
+        });
+
+    ASSERT_EQ(2U, decoded.size());
+    ASSERT_EQ("foobar", decoded[0]);
+    ASSERT_EQ("\xfb\xff", decoded[1]);
+}
+
+TEST(minijson_base64, stream_string)
+{
+    std::string data;
+    for (int i = 0; i < 100000; ++i)
+    {
+        data += static_cast<char>(i * 7 % 256);
+    }
+    const std::string encoded =
+        encode_base64(data, minijson::base64_alphabet::Standard, true);
+
+    // The "/" characters are escaped, as some JSON encoders do
+    std::string escaped;
+    for (const char c : encoded)
+    {
+        escaped += (c == '/') ? "\\/" : std::string(1, c);
+    }
+    std::istringstream stream("{\"blob\":\"" + escaped + "\"}");
+    minijson::istream_context context(stream);
+
+    minijson::cursor cursor(context);
+    ASSERT_EQ(minijson::BeginObject, cursor.next());
+    ASSERT_EQ(minijson::FieldName, cursor.next());
+
+    minijson::base64_decoder decoder;
+    std::string decoded;
+    std::vector<char> output;
+    ASSERT_TRUE(
+        cursor.stream_string(
+            [&](const std::string_view chunk)
+            {
+                output.resize(minijson::base64_decoded_size(chunk.size()));
+                decoded.append(
+                    output.data(),
+                    decoder.update(chunk, output.data()));
+            }));
+    char tail[2];
+    decoded.append(tail, decoder.finish(tail));
+
+    ASSERT_EQ(data, decoded);
+    ASSERT_EQ(minijson::EndObject, cursor.next());
+}
@@ -0,0 +1,360 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+struct Point
+{
+    int x = 0;
+    int y = 0;
+};
+
+struct Order
+{
+    std::string_view ticker;
+    unsigned int price = 0;
+    std::optional<unsigned int> size;
+    bool urgent = false;
+    std::string note;
+    Point position;
+    std::optional<Point> target;
+    std::vector<int> quantities;
+    std::vector<Point> path;
+    std::optional<std::vector<std::string>> tags;
+    std::optional<std::string> comment;
+};
+
+struct Empty
+{
+};
+
+// Enough fields to need a table larger than the number of fields
+struct Wide
+{
+    int f0 = 0, f1 = 0, f2 = 0, f3 = 0, f4 = 0, f5 = 0, f6 = 0, f7 = 0;
+    int f8 = 0, f9 = 0, f10 = 0, f11 = 0, f12 = 0, f13 = 0, f14 = 0;
+    int f15 = 0, f16 = 0, f17 = 0, f18 = 0, f19 = 0;
+};
+
+} // namespace {anonymous}
+
+namespace minijson
+{
+
+template<>
+struct binding<Point>
+{
+    static constexpr auto fields = std::make_tuple(
+        required_field("x", &Point::x),
+        required_field("y", &Point::y));
+};
+
+template<>
+struct binding<Order>
+{
+    static constexpr auto fields = std::make_tuple(
+        required_field("ticker", &Order::ticker),
+        required_field("price", &Order::price),
+        optional_field("size", &Order::size),
+        optional_field("urgent", &Order::urgent),
+        optional_field("note", &Order::note),
+        optional_field("position", &Order::position),
+        optional_field("target", &Order::target),
+        optional_field("quantities", &Order::quantities),
+        optional_field("path", &Order::path),
+        optional_field("tags", &Order::tags),
+        optional_field("comment", &Order::comment),
+        ignored_field("sender"));
+};
+
+template<>
+struct binding<Empty>
+{
+    static constexpr std::tuple<> fields {};
+};
+
+template<>
+struct binding<Wide>
+{
+    static constexpr auto fields = std::make_tuple(
+        required_field("f0", &Wide::f0),
+        required_field("f1", &Wide::f1),
+        required_field("f2", &Wide::f2),
+        required_field("f3", &Wide::f3),
+        required_field("f4", &Wide::f4),
+        required_field("f5", &Wide::f5),
+        required_field("f6", &Wide::f6),
+        required_field("f7", &Wide::f7),
+        required_field("f8", &Wide::f8),
+        required_field("f9", &Wide::f9),
+        required_field("f10", &Wide::f10),
+        required_field("f11", &Wide::f11),
+        required_field("f12", &Wide::f12),
+        required_field("f13", &Wide::f13),
+        required_field("f14", &Wide::f14),
+        required_field("f15", &Wide::f15),
+        required_field("f16", &Wide::f16),
+        required_field("f17", &Wide::f17),
+        required_field("f18", &Wide::f18),
+        required_field("f19", &Wide::f19));
+};
+
+} // namespace minijson
+
+TEST(minijson_binding, parse_into)
+{
+    const auto test = [](auto& context)
+    {
+        Order order;
+        order.size = 42;
+        order.target = Point {1, 1};
+        minijson::parse_into(context, order);
+
+        ASSERT_EQ("ABC", order.ticker);
+        ASSERT_EQ(120U, order.price);
+        ASSERT_EQ(42U, order.size); // untouched
+        ASSERT_TRUE(order.urgent);
+        ASSERT_EQ("hello", order.note);
+        ASSERT_EQ(3, order.position.x);
+        ASSERT_EQ(-4, order.position.y);
+        ASSERT_FALSE(order.target.has_value());
+        ASSERT_EQ((std::vector<int> {1, 2, 3}), order.quantities);
+        ASSERT_EQ(2U, order.path.size());
+        ASSERT_EQ(5, order.path[1].x);
+        ASSERT_EQ(6, order.path[1].y);
+        ASSERT_EQ((std::vector<std::string> {"a", "b"}), *order.tags);
+        ASSERT_EQ("c", *order.comment);
+    };
+
+    const char json[] =
+        R"json({"ticker":"ABC","price":120,"urgent":true,"note":"hello",)json"
+        R"json("sender":{"name":[1,{}]},"position":{"y":-4,"x":3},)json"
+        R"json("target":null,"quantities":[1,2,3],)json"
+        R"json("path":[{"x":1,"y":2},{"x":5,"y":6}],)json"
+        R"json("tags":["a","b"],"comment":"c"})json";
+
+    {
+        minijson::const_buffer_context context(json, sizeof(json) - 1);
+        test(context);
+    }
+    {
+        char buffer[sizeof(json)];
+        std::copy(std::begin(json), std::end(json), buffer);
+        minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+        test(context);
+    }
+    {
+        std::istringstream stream(json);
+        minijson::istream_context context(stream);
+        test(context);
+    }
+}
+
+TEST(minijson_binding, optional_members)
+{
+    const char json[] =
+        R"json({"ticker":"ABC","price":1,"size":null,)json"
+        R"json("target":{"x":1,"y":2},"tags":null,"comment":null})json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    Order order;
+    order.size = 42;
+    order.tags.emplace();
+    order.comment = "x";
+    minijson::parse_into(context, order);
+
+    ASSERT_FALSE(order.size.has_value());
+    ASSERT_EQ(2, order.target->y);
+    ASSERT_FALSE(order.tags.has_value());
+    ASSERT_FALSE(order.comment.has_value());
+}
+
+TEST(minijson_binding, nested)
+{
+    const char json[] = R"json({"a":{"x":1,"y":2},"b":[{"x":3,"y":4}]})json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    Point a;
+    std::vector<Point> b;
+    minijson::parse_object(
+        context,
+        [&](const std::string_view name, minijson::value)
+        {
+            if (name == "a")
+            {
+                minijson::parse_into(context, a);
+            }
+            else
+            {
+                minijson::parse_array(
+                    context,
+                    [&](minijson::value)
+                    {
+                        minijson::parse_into(context, b.emplace_back());
+                    });
+            }
+        });
+
+    ASSERT_EQ(2, a.y);
+    ASSERT_EQ(1U, b.size());
+    ASSERT_EQ(3, b[0].x);
+}
+
+TEST(minijson_binding, empty)
+{
+    {
+        const char json[] = "{}";
+        minijson::const_buffer_context context(json, sizeof(json) - 1);
+        Empty empty;
+        minijson::parse_into(context, empty);
+    }
+    {
+        const char json[] = R"json({"a":1})json";
+        minijson::const_buffer_context context(json, sizeof(json) - 1);
+        Empty empty;
+        ASSERT_THROW(
+            minijson::parse_into(context, empty),
+            minijson::unhandled_field_error);
+    }
+}
+
+TEST(minijson_binding, wide)
+{
+    std::string json = "{";
+    for (int i = 19; i >= 0; --i)
+    {
+        json += "\"f" + std::to_string(i) + "\":" + std::to_string(i * i);
+        json += (i > 0) ? "," : "}";
+    }
+    minijson::const_buffer_context context(json.data(), json.size());
+
+    Wide wide;
+    minijson::parse_into(context, wide);
+    ASSERT_EQ(0, wide.f0);
+    ASSERT_EQ(49, wide.f7);
+    ASSERT_EQ(361, wide.f19);
+}
+
+TEST(minijson_binding, missing_field)
+{
+    const char json[] = R"json({"ticker":"ABC","position":{"x":1}})json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    Order order;
+    try
+    {
+        minijson::parse_into(context, order);
+        FAIL();
+    }
+    catch (const minijson::missing_field_error& e)
+    {
+        ASSERT_EQ("y", e.field_name_truncated());
+    }
+
+    const char json2[] = R"json({"ticker":"ABC"})json";
+    minijson::const_buffer_context context2(json2, sizeof(json2) - 1);
+    try
+    {
+        minijson::parse_into(context2, order);
+        FAIL();
+    }
+    catch (const minijson::missing_field_error& e)
+    {
+        ASSERT_EQ("price", e.field_name_truncated());
+    }
+}
+
+TEST(minijson_binding, unhandled_field)
+{
+    for (const std::string_view name : {"tickers", "x", "", "sende"})
+    {
+        const std::string json = "{\"" + std::string(name) + "\":1}";
+        minijson::const_buffer_context context(json.data(), json.size());
+
+        Order order;
+        try
+        {
+            minijson::parse_into(context, order);
+            FAIL();
+        }
+        catch (const minijson::unhandled_field_error& e)
+        {
+            ASSERT_EQ(name, e.field_name_truncated());
+        }
+    }
+}
+
+TEST(minijson_binding, wrong_type)
+{
+    const auto test = [](const char* json, const char* what)
+    {
+        SCOPED_TRACE(json);
+        minijson::const_buffer_context context(json, std::strlen(json));
+
+        Order order;
+        try
+        {
+            minijson::parse_into(context, order);
+            FAIL();
+        }
+        catch (const minijson::bad_value_cast& e)
+        {
+            ASSERT_STREQ(what, e.what());
+        }
+    };
+
+    test(
+        R"json({"position":1})json",
+        "parse_into(): value type is not Object");
+    test(
+        R"json({"target":[]})json",
+        "parse_into(): value type is not Object");
+    test(
+        R"json({"quantities":{}})json",
+        "parse_into(): value type is not Array");
+    test(
+        R"json({"path":[1]})json",
+        "parse_into(): value type is not Object");
+    test(
+        R"json({"note":1})json",
+        "value::as<T>(): value type is not String");
+    test(
+        R"json({"price":"1"})json",
+        "value::as<T>(): value type is not Number");
+}
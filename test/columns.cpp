@@ -0,0 +1,199 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(minijson_columns, parse_columns)
+{
+    const char json[] =
+        R"json([{"ticker":"ABC","price":1.5,"size":100,"urgent":true},)json"
+        R"json({"size":null,"price":2,"ticker":"DéF","extra":{"a":[]}},)json"
+        R"json({"ticker":null,"urgent":false,"price":3.25,"size":7},)json"
+        R"json({}])json";
+
+    const auto test = [&](auto& context)
+    {
+        minijson::string_column ticker;
+        minijson::column<double> price;
+        minijson::column<std::int64_t> size;
+        minijson::column<bool> urgent;
+
+        minijson::parse_columns(
+            context,
+            minijson::column_field("ticker", ticker),
+            minijson::column_field("price", price),
+            minijson::column_field("size", size),
+            minijson::column_field("urgent", urgent));
+
+        ASSERT_EQ(4U, ticker.size());
+        ASSERT_EQ("ABC", ticker[0]);
+        ASSERT_EQ("D\xc3\xa9" "F", ticker[1]);
+        ASSERT_EQ("", ticker[2]);
+        ASSERT_EQ("", ticker[3]);
+        ASSERT_EQ("ABCD\xc3\xa9" "F", std::string_view(
+            ticker.chars().data(),
+            ticker.chars().size()));
+        ASSERT_EQ(
+            (std::vector<std::size_t> {0, 3, 7, 7, 7}),
+            ticker.offsets());
+        ASSERT_EQ((std::vector<std::uint64_t> {0b0011}), ticker.validity());
+        ASSERT_TRUE(ticker.is_valid(1));
+        ASSERT_FALSE(ticker.is_valid(2));
+
+        ASSERT_EQ(4U, price.size());
+        ASSERT_EQ((std::vector<double> {1.5, 2, 3.25, 0}), price.values());
+        ASSERT_EQ((std::vector<std::uint64_t> {0b0111}), price.validity());
+
+        ASSERT_EQ((std::vector<std::int64_t> {100, 0, 7, 0}), size.values());
+        ASSERT_EQ((std::vector<std::uint64_t> {0b0101}), size.validity());
+        ASSERT_FALSE(size.is_valid(1));
+
+        ASSERT_EQ(
+            (std::vector<bool> {true, false, false, false}),
+            urgent.values());
+        ASSERT_EQ((std::vector<std::uint64_t> {0b0101}), urgent.validity());
+    };
+
+    {
+        minijson::const_buffer_context context(json, sizeof(json) - 1);
+        test(context);
+    }
+    {
+        std::istringstream stream(json);
+        minijson::istream_context context(stream);
+        test(context);
+    }
+}
+
+TEST(minijson_columns, many_records)
+{
+    std::string json = "[";
+    for (int i = 0; i < 200; ++i)
+    {
+        json += (i > 0) ? "," : "";
+        json += (i % 3 == 0) ?
+            "{\"v\":null}" :
+            "{\"v\":" + std::to_string(i) + "}";
+    }
+    json += "]";
+    minijson::const_buffer_context context(json.data(), json.size());
+
+    minijson::column<int> v;
+    minijson::parse_columns(context, minijson::column_field("v", v));
+
+    ASSERT_EQ(200U, v.size());
+    ASSERT_EQ(4U, v.validity().size());
+    for (std::size_t i = 0; i < v.size(); ++i)
+    {
+        ASSERT_EQ(i % 3 != 0, v.is_valid(i));
+        ASSERT_EQ((i % 3 != 0) ? int(i) : 0, v.values()[i]);
+    }
+
+    v.clear();
+    ASSERT_EQ(0U, v.size());
+    ASSERT_TRUE(v.values().empty());
+    ASSERT_TRUE(v.validity().empty());
+}
+
+TEST(minijson_columns, duplicate_fields)
+{
+    const char json[] = R"json([{"a":1,"a":2,"b":"x","b":{}}])json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    minijson::column<int> a;
+    minijson::string_column b;
+    minijson::parse_columns(
+        context,
+        minijson::column_field("a", a),
+        minijson::column_field("b", b));
+
+    ASSERT_EQ((std::vector<int> {1}), a.values());
+    ASSERT_EQ(1U, b.size());
+    ASSERT_EQ("x", b[0]);
+
+    b.clear();
+    ASSERT_EQ(0U, b.size());
+    ASSERT_EQ((std::vector<std::size_t> {0}), b.offsets());
+    ASSERT_TRUE(b.chars().empty());
+}
+
+TEST(minijson_columns, no_columns)
+{
+    const char json[] = R"json([{"a":1},{"b":[{}]}])json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+    ASSERT_EQ(sizeof(json) - 1, minijson::parse_columns(context));
+}
+
+TEST(minijson_columns, wrong_type)
+{
+    const auto test = [](const char* json)
+    {
+        SCOPED_TRACE(json);
+        minijson::const_buffer_context context(json, std::strlen(json));
+
+        minijson::column<int> a;
+        minijson::string_column b;
+        ASSERT_THROW(
+            minijson::parse_columns(
+                context,
+                minijson::column_field("a", a),
+                minijson::column_field("b", b)),
+            minijson::bad_value_cast);
+    };
+
+    test(R"json([1])json");
+    test(R"json([[]])json");
+    test(R"json([{"a":"1"}])json");
+    test(R"json([{"a":{}}])json");
+    test(R"json([{"b":1}])json");
+    test(R"json([{"b":[]}])json");
+}
+
+TEST(minijson_columns, invalid)
+{
+    const char json[] = R"json([{"a":1},{"a":])json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    minijson::column<int> a;
+    try
+    {
+        minijson::parse_columns(context, minijson::column_field("a", a));
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXPECTED_VALUE, e.reason());
+    }
+}
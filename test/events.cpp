@@ -0,0 +1,538 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+// Records the events as a compact string, e.g. {k:s,k:[n,b,z]}
+struct recording_handler
+{
+    std::string events;
+
+    void start_object()
+    {
+        events += '{';
+    }
+
+    void end_object()
+    {
+        events += '}';
+    }
+
+    void start_array()
+    {
+        events += '[';
+    }
+
+    void end_array()
+    {
+        events += ']';
+    }
+
+    void key(const std::string_view name)
+    {
+        events += name;
+        events += ':';
+    }
+
+    void string(const std::string_view value)
+    {
+        events += '"';
+        events += value;
+        events += '"';
+    }
+
+    void number(const minijson::value value)
+    {
+        ASSERT_EQ(minijson::Number, value.type());
+        events += value.raw();
+    }
+
+    void boolean(const bool value)
+    {
+        events += value ? "true" : "false";
+    }
+
+    void null()
+    {
+        events += "null";
+    }
+};
+
+template<std::size_t Length>
+void parse_events_invalid_helper(
+    const char (&buffer)[Length],
+    const minijson::parse_error::error_reason expected_reason)
+{
+    SCOPED_TRACE(buffer);
+    minijson::const_buffer_context context(buffer, Length - 1);
+
+    recording_handler handler;
+    try
+    {
+        minijson::parse_events(context, handler);
+        FAIL(); // should never get here
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(expected_reason, e.reason());
+    }
+}
+
+} // namespace {anonymous}
+
+TEST(minijson_events, parse_events)
+{
+    char buffer[] =
+        " {\"a\" : \"x\\ty\", \"b\":[1, -2.5e3,true , false,null,{}, []],"
+        "\"\":{\"c\":{\"d\":[[\"e\"]]}}, \"f\":0} ";
+    const std::string expected =
+        "{a:\"x\ty\"b:[1-2.5e3truefalsenull{}[]]:{c:{d:[[\"e\"]]}}f:0}";
+
+    {
+        minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+        recording_handler handler;
+        ASSERT_EQ(
+            sizeof(buffer) - 2,
+            minijson::parse_events(context, handler));
+        ASSERT_EQ(expected, handler.events);
+    }
+    {
+        std::istringstream ss(buffer);
+        minijson::istream_context context(ss);
+        recording_handler handler;
+        ASSERT_EQ(
+            sizeof(buffer) - 2,
+            minijson::parse_events(context, handler));
+        ASSERT_EQ(expected, handler.events);
+    }
+    {
+        minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+        recording_handler handler;
+        ASSERT_EQ(
+            sizeof(buffer) - 2,
+            minijson::parse_events(context, handler));
+        ASSERT_EQ(expected, handler.events);
+    }
+}
+
+TEST(minijson_events, parse_events_array)
+{
+    char buffer[] = "[[], \"a\", [{\"b\": [2]}]][3]";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+
+    recording_handler handler;
+    ASSERT_EQ(23U, minijson::parse_events(context, handler));
+    ASSERT_EQ("[[]\"a\"[{b:[2]}]]", handler.events);
+
+    // Keep on using the same context to parse the next array
+    handler.events.clear();
+    ASSERT_EQ(3U, minijson::parse_events(context, handler));
+    ASSERT_EQ("[3]", handler.events);
+}
+
+TEST(minijson_events, parse_events_nested)
+{
+    char buffer[] = "{\"a\": 1, \"b\": {\"c\": [true]}, \"d\": [{}], \"e\": 2}";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+
+    recording_handler handler;
+    minijson::parse_object(
+        context,
+        [&](std::string_view name, minijson::value v)
+        {
+            if (v.type() == minijson::Object || v.type() == minijson::Array)
+            {
+                handler.key(name);
+                minijson::parse_events(context, handler);
+            }
+        });
+    ASSERT_EQ("b:{c:[true]}d:[{}]", handler.events);
+    ASSERT_EQ(0U, context.nesting_level());
+}
+
+TEST(minijson_events, parse_events_deep)
+{
+    // The maximum nesting allowed (32 levels below the outermost array)
+    std::string buffer =
+        std::string(MJR_NESTING_LIMIT + 1, '[') +
+        std::string(MJR_NESTING_LIMIT + 1, ']');
+    {
+        minijson::const_buffer_context context(buffer.data(), buffer.size());
+        recording_handler handler;
+        minijson::parse_events(context, handler);
+        ASSERT_EQ(buffer, handler.events);
+    }
+
+    // One level too many
+    buffer = "[" + buffer + "]";
+    {
+        minijson::const_buffer_context context(buffer.data(), buffer.size());
+        recording_handler handler;
+        try
+        {
+            minijson::parse_events(context, handler);
+            FAIL(); // should never get here
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(
+                minijson::parse_error::EXCEEDED_NESTING_LIMIT,
+                e.reason());
+        }
+    }
+}
+
+TEST(minijson_events, parse_events_invalid)
+{
+    using minijson::parse_error;
+
+    parse_events_invalid_helper("", parse_error::EXPECTED_OPENING_BRACKET);
+    parse_events_invalid_helper("\"a\"", parse_error::EXPECTED_OPENING_BRACKET);
+    parse_events_invalid_helper("{", parse_error::EXPECTED_OPENING_QUOTE);
+    parse_events_invalid_helper("{a", parse_error::EXPECTED_OPENING_QUOTE);
+    parse_events_invalid_helper("{\"a\"", parse_error::EXPECTED_COLON);
+    parse_events_invalid_helper("{\"a\" 1}", parse_error::EXPECTED_COLON);
+    parse_events_invalid_helper("{\"a\":}", parse_error::EXPECTED_VALUE);
+    parse_events_invalid_helper(
+        "{\"a\":1]",
+        parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    parse_events_invalid_helper(
+        "{\"a\":1,}",
+        parse_error::EXPECTED_OPENING_QUOTE);
+    parse_events_invalid_helper("[", parse_error::UNTERMINATED_VALUE);
+    parse_events_invalid_helper("[1", parse_error::UNTERMINATED_VALUE);
+    parse_events_invalid_helper(
+        "[1}",
+        parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    parse_events_invalid_helper("[1,]", parse_error::EXPECTED_VALUE);
+    parse_events_invalid_helper(
+        "[[1] 2]",
+        parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    parse_events_invalid_helper("[\"a]", parse_error::UNTERMINATED_VALUE);
+    parse_events_invalid_helper("[tru]", parse_error::INVALID_VALUE);
+    parse_events_invalid_helper("[01]", parse_error::INVALID_VALUE);
+}
+
+TEST(minijson_events, cursor)
+{
+    char buffer[] =
+        "{\"a\": [1, \"x\", {}], \"b\": {\"c\": null}, \"d\": true}";
+
+    const auto test = [](auto& context)
+    {
+        minijson::cursor cursor(context);
+        ASSERT_EQ(0U, cursor.depth());
+
+        ASSERT_EQ(minijson::BeginObject, cursor.peek_type());
+        ASSERT_EQ(minijson::BeginObject, cursor.peek_type());
+        ASSERT_EQ(minijson::BeginObject, cursor.next());
+        ASSERT_EQ(minijson::Object, cursor.get_value().type());
+        ASSERT_EQ(1U, cursor.depth());
+
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_EQ("a", cursor.field_name());
+        ASSERT_EQ(minijson::BeginArray, cursor.next());
+        ASSERT_EQ(minijson::Array, cursor.get_value().type());
+        ASSERT_EQ(2U, cursor.depth());
+        ASSERT_EQ(minijson::Scalar, cursor.peek_type());
+        ASSERT_EQ(minijson::Scalar, cursor.next());
+        ASSERT_EQ(1, cursor.get_value().template as<int>());
+        ASSERT_EQ(minijson::Scalar, cursor.next());
+        ASSERT_EQ("x", cursor.get_value().template as<std::string_view>());
+        ASSERT_EQ(minijson::BeginObject, cursor.next());
+        ASSERT_EQ(minijson::EndObject, cursor.peek_type());
+        ASSERT_EQ(minijson::EndObject, cursor.next());
+        ASSERT_EQ(minijson::EndArray, cursor.next());
+        ASSERT_EQ(1U, cursor.depth());
+
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_EQ("b", cursor.field_name());
+        ASSERT_EQ(minijson::BeginObject, cursor.next());
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_EQ("c", cursor.field_name());
+        ASSERT_EQ(minijson::Scalar, cursor.next());
+        ASSERT_EQ(minijson::Null, cursor.get_value().type());
+        ASSERT_EQ(minijson::EndObject, cursor.next());
+
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_EQ("d", cursor.field_name());
+        ASSERT_EQ(minijson::Scalar, cursor.next());
+        ASSERT_TRUE(cursor.get_value().template as<bool>());
+        ASSERT_EQ(minijson::EndObject, cursor.next());
+        ASSERT_EQ(0U, cursor.depth());
+
+        ASSERT_EQ(minijson::EndOfInput, cursor.peek_type());
+        ASSERT_EQ(minijson::EndOfInput, cursor.next());
+        ASSERT_EQ(minijson::EndOfInput, cursor.next());
+    };
+
+    {
+        minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+        test(context);
+    }
+    {
+        std::istringstream ss(buffer);
+        minijson::istream_context context(ss);
+        test(context);
+    }
+    {
+        minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+        test(context);
+    }
+}
+
+TEST(minijson_events, cursor_skip)
+{
+    char buffer[] =
+        "{\"skip1\": {\"x\": [1, {\"y\": []}]}, \"skip2\": 42,"
+        " \"skip3\": [[], [\"]\"]], \"keep\": \"k\"}";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+
+    minijson::cursor cursor(context);
+    ASSERT_EQ(minijson::BeginObject, cursor.next());
+
+    // Skip a whole field (name and value)
+    cursor.skip();
+
+    // Skip the value only
+    ASSERT_EQ(minijson::FieldName, cursor.next());
+    ASSERT_EQ("skip2", cursor.field_name());
+    cursor.skip();
+
+    // Skip a whole field with an array value
+    cursor.skip();
+
+    ASSERT_EQ(minijson::FieldName, cursor.next());
+    ASSERT_EQ("keep", cursor.field_name());
+    ASSERT_EQ(minijson::Scalar, cursor.next());
+    ASSERT_EQ("k", cursor.get_value().as<std::string_view>());
+
+    // Skipping does nothing at the end of an object
+    cursor.skip();
+    ASSERT_EQ(minijson::EndObject, cursor.next());
+    cursor.skip();
+    ASSERT_EQ(minijson::EndOfInput, cursor.next());
+}
+
+TEST(minijson_events, cursor_skip_all)
+{
+    char buffer[] = "[{\"a\": [1, 2]}, 3] [4]";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+
+    {
+        minijson::cursor cursor(context);
+        cursor.skip();
+        ASSERT_EQ(minijson::EndOfInput, cursor.next());
+    }
+    {
+        // Keep on using the same context to read the next array
+        minijson::cursor cursor(context);
+        ASSERT_EQ(minijson::BeginArray, cursor.next());
+        ASSERT_EQ(minijson::Scalar, cursor.next());
+        ASSERT_EQ(4, cursor.get_value().as<int>());
+    }
+}
+
+TEST(minijson_events, cursor_early_exit)
+{
+    const auto find_id = [](minijson::buffer_context& context) -> int
+    {
+        minijson::cursor cursor(context);
+        minijson::token_type token;
+        while ((token = cursor.next()) != minijson::EndOfInput)
+        {
+            if (token == minijson::FieldName &&
+                cursor.depth() == 1 &&
+                cursor.field_name() == "id")
+            {
+                cursor.next();
+                return cursor.get_value().as<int>();
+            }
+        }
+        return -1;
+    };
+
+    char buffer[] = "{\"id\": 7, \"huge\": [1, 2, 3, 4, 5, 6, 7, 8, 9]}";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+    ASSERT_EQ(7, find_id(context));
+    // Nothing has been read past the comma following the id
+    ASSERT_EQ(9U, context.read_offset());
+
+    // field_name() is not cleared by the tokens following the field name
+    char nested[] = "{\"a\":{\"id\":1},\"b\":2}";
+    minijson::buffer_context nested_context(nested, sizeof(nested) - 1);
+    ASSERT_EQ(-1, find_id(nested_context));
+}
+
+TEST(minijson_events, cursor_nested)
+{
+    char buffer[] = "{\"a\": 1, \"b\": [10, 20, 30], \"c\": 2}";
+    minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+
+    int sum = 0;
+    minijson::parse_object(
+        context,
+        [&](std::string_view, minijson::value v, auto& ctx)
+        {
+            if (v.type() == minijson::Array)
+            {
+                minijson::cursor cursor(ctx);
+                ASSERT_EQ(minijson::BeginArray, cursor.next());
+                while (cursor.next() == minijson::Scalar)
+                {
+                    const minijson::value element = cursor.get_value();
+                    sum += element.as<int>();
+                }
+                ASSERT_EQ(minijson::EndOfInput, cursor.next());
+            }
+            else
+            {
+                sum += v.as<int>();
+            }
+        });
+    ASSERT_EQ(63, sum);
+}
+
+TEST(minijson_events, parse_events_deep_runtime_limit)
+{
+    const std::string buffer =
+        std::string(250, '[') + "{\"a\":[[{}]]}" + std::string(250, ']');
+
+    minijson::const_buffer_context context(buffer.data(), buffer.size());
+    context.set_nesting_limit(253);
+    recording_handler handler;
+    minijson::parse_events(context, handler);
+    ASSERT_EQ(
+        std::string(250, '[') + "{a:[[{}]]}" + std::string(250, ']'),
+        handler.events);
+}
+
+TEST(minijson_events, cursor_stream_string)
+{
+    // A string much larger than a chunk, with escape sequences
+    std::string blob;
+    std::string expected;
+    for (int i = 0; i < 3000; ++i)
+    {
+        blob += "ab\\n\\u00e8\\ud83d\\ude00";
+        expected += "ab\n\xc3\xa8\xf0\x9f\x98\x80";
+    }
+    const std::string buffer =
+        "{\"id\": 7, \"blob\": \"" + blob + "\", \"empty\": \"\", "
+        "\"tail\": [\"t\"]}";
+
+    const auto test = [&](auto& context)
+    {
+        minijson::cursor cursor(context);
+        std::string streamed;
+        std::size_t chunks = 0;
+        const auto sink = [&](const std::string_view chunk)
+        {
+            ASSERT_FALSE(chunk.empty());
+            ASSERT_LE(chunk.size(), std::size_t(MJR_STRING_CHUNK_SIZE));
+            streamed += chunk;
+            ++chunks;
+        };
+
+        // Only string values can be streamed
+        ASSERT_FALSE(cursor.stream_string(sink));
+        ASSERT_EQ(minijson::BeginObject, cursor.next());
+        ASSERT_FALSE(cursor.stream_string(sink));
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_FALSE(cursor.stream_string(sink));
+        ASSERT_EQ(minijson::Scalar, cursor.next());
+        ASSERT_EQ(7, cursor.get_value().template as<int>());
+
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_EQ("blob", cursor.field_name());
+        ASSERT_TRUE(cursor.stream_string(sink));
+        ASSERT_EQ(expected, streamed);
+        ASSERT_LT(1U, chunks);
+
+        // The sink is not called for empty strings
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_TRUE(cursor.stream_string(sink));
+        ASSERT_EQ(expected, streamed);
+
+        ASSERT_EQ(minijson::FieldName, cursor.next());
+        ASSERT_EQ(minijson::BeginArray, cursor.next());
+        ASSERT_TRUE(cursor.stream_string(sink));
+        ASSERT_EQ(expected + "t", streamed);
+        ASSERT_FALSE(cursor.stream_string(sink));
+        ASSERT_EQ(minijson::EndArray, cursor.next());
+        ASSERT_EQ(minijson::EndObject, cursor.next());
+        ASSERT_FALSE(cursor.stream_string(sink));
+        ASSERT_EQ(minijson::EndOfInput, cursor.next());
+    };
+
+    {
+        minijson::const_buffer_context context(buffer.data(), buffer.size());
+        test(context);
+    }
+    {
+        std::istringstream ss(buffer);
+        minijson::istream_context context(ss);
+        test(context);
+    }
+}
+
+TEST(minijson_events, cursor_stream_string_invalid)
+{
+    const std::string buffer =
+        "[\"" + std::string(10000, 'x') + "\\q\"]";
+    minijson::const_buffer_context context(buffer.data(), buffer.size());
+
+    minijson::cursor cursor(context);
+    ASSERT_EQ(minijson::BeginArray, cursor.next());
+    std::size_t streamed = 0;
+    try
+    {
+        cursor.stream_string(
+            [&](const std::string_view chunk) { streamed += chunk.size(); });
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::INVALID_ESCAPE_SEQUENCE, e.reason());
+        ASSERT_EQ(10003U, e.offset());
+    }
+
+    // The chunks decoded before the error have been delivered
+    ASSERT_LT(0U, streamed);
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -29,6 +29,7 @@
 
 #include <bitset>
 #include <climits>
+#include <thread>
 
 template<typename Context>
 void test_context_helper(Context& context)
@@ -178,6 +179,54 @@ TEST(minijson_reader, const_buffer_context)
     ASSERT_DEATH({const_buffer_context.write('x');}, "");
 }
 
+TEST(minijson_reader, const_buffer_context_reset)
+{
+    const char first[] = "\"abc\"";
+    const char second[] = "\"a\"";
+    const char third[] = "\"abcdefgh\"";
+
+    minijson::const_buffer_context context(first, sizeof(first) - 1);
+    context.set_nesting_limit(3);
+    ASSERT_EQ('"', context.read());
+    ASSERT_EQ("abc", minijson::detail::parse_string(context));
+    const char* const original_write_buffer = context.current_literal();
+    context.begin_nested(minijson::detail::context_base::NESTED_STATUS_ARRAY);
+
+    // Smaller buffer: the write buffer is reused
+    context.reset(second, sizeof(second) - 1);
+    ASSERT_EQ(0U, context.read_offset());
+    ASSERT_EQ(0U, context.nesting_level());
+    ASSERT_EQ(3U, context.nesting_limit());
+    ASSERT_EQ(
+        minijson::detail::context_base::NESTED_STATUS_NONE,
+        context.nested_status());
+    ASSERT_EQ('"', context.read());
+    ASSERT_EQ("a", minijson::detail::parse_string(context));
+    ASSERT_EQ(original_write_buffer, context.current_literal());
+    ASSERT_EQ(0, context.read());
+
+    // Larger buffer: the write buffer grows
+    context.reset(third, sizeof(third) - 1);
+    ASSERT_EQ('"', context.read());
+    ASSERT_EQ("abcdefgh", minijson::detail::parse_string(context));
+
+    // The capacity follows the write buffer when swapping and moving
+    minijson::const_buffer_context other(second, sizeof(second) - 1);
+    swap(context, other);
+    context.reset(third, sizeof(third) - 1);
+    ASSERT_EQ('"', context.read());
+    ASSERT_EQ("abcdefgh", minijson::detail::parse_string(context));
+
+    minijson::const_buffer_context moved(std::move(other));
+    other.reset(second, sizeof(second) - 1);
+    ASSERT_EQ('"', other.read());
+    ASSERT_EQ("a", minijson::detail::parse_string(other));
+    other = std::move(moved);
+    other.reset(third, sizeof(third) - 1);
+    ASSERT_EQ('"', other.read());
+    ASSERT_EQ("abcdefgh", minijson::detail::parse_string(other));
+}
+
 TEST(minijson_reader, istream_context)
 {
     std::istringstream buffer("hello world.");
@@ -234,18 +283,10 @@ TEST(minijson_reader_detail, utf16_to_utf32)
 
 TEST(minijson_reader_detail, utf16_to_utf32_invalid)
 {
-    ASSERT_THROW(
-        minijson::detail::utf16_to_utf32(0x0000, 0x0001),
-        minijson::detail::encoding_error);
-    ASSERT_THROW(
-        minijson::detail::utf16_to_utf32(0xD800, 0xDBFF),
-        minijson::detail::encoding_error);
-    ASSERT_THROW(
-        minijson::detail::utf16_to_utf32(0xD800, 0xE000),
-        minijson::detail::encoding_error);
-    ASSERT_THROW(
-        minijson::detail::utf16_to_utf32(0xDC00, 0xDC00),
-        minijson::detail::encoding_error);
+    ASSERT_EQ(std::nullopt, minijson::detail::utf16_to_utf32(0x0000, 0x0001));
+    ASSERT_EQ(std::nullopt, minijson::detail::utf16_to_utf32(0xD800, 0xDBFF));
+    ASSERT_EQ(std::nullopt, minijson::detail::utf16_to_utf32(0xD800, 0xE000));
+    ASSERT_EQ(std::nullopt, minijson::detail::utf16_to_utf32(0xDC00, 0xDC00));
 }
 
 TEST(minijson_reader_detail, utf32_to_utf8)
@@ -326,9 +367,7 @@ TEST(minijson_reader_detail, utf32_to_utf8)
 TEST(minijson_reader_detail, utf32_to_utf8_invalid)
 {
     // invalid code unit
-    ASSERT_THROW(
-        minijson::detail::utf32_to_utf8(0x200000),
-        minijson::detail::encoding_error);
+    ASSERT_EQ(std::nullopt, minijson::detail::utf32_to_utf8(0x200000));
 }
 
 TEST(minijson_reader_detail, utf16_to_utf8)
@@ -337,54 +376,51 @@ TEST(minijson_reader_detail, utf16_to_utf8)
     // and utf32_to_utf8, and other cases have been covered by previous tests
 
     const std::array<std::uint8_t, 4> expected {0xF4, 0x8F, 0xBF, 0xBF};
-    ASSERT_EQ(expected, minijson::detail::utf16_to_utf8(0xDBFF, 0xDFFF));
+    ASSERT_EQ(expected, *minijson::detail::utf16_to_utf8(0xDBFF, 0xDFFF));
 }
 
-TEST(minijson_reader_detail, parse_utf16_escape_sequence)
+template<std::size_t Length>
+std::uint16_t read_utf16_code_unit(const char (&buffer)[Length])
 {
-    ASSERT_EQ(
-        0x0000u,
-        minijson::detail::parse_utf16_escape_sequence({'0', '0', '0', '0'}));
-    ASSERT_EQ(
-        0x1000u,
-        minijson::detail::parse_utf16_escape_sequence({'1', '0', '0', '0'}));
-    ASSERT_EQ(
-        0x2345u,
-        minijson::detail::parse_utf16_escape_sequence({'2', '3', '4', '5'}));
-    ASSERT_EQ(
-        0x6789u,
-        minijson::detail::parse_utf16_escape_sequence({'6', '7', '8', '9'}));
-    ASSERT_EQ(
-        0xA6BCu,
-        minijson::detail::parse_utf16_escape_sequence({'A', '6', 'B', 'C'}));
-    ASSERT_EQ(
-        0xabcdu,
-        minijson::detail::parse_utf16_escape_sequence({'a', 'b', 'c', 'd'}));
-    ASSERT_EQ(
-        0xabcdu,
-        minijson::detail::parse_utf16_escape_sequence({'A', 'B', 'C', 'D'}));
-    ASSERT_EQ(
-        0xEFefu,
-        minijson::detail::parse_utf16_escape_sequence({'E', 'F', 'e', 'f'}));
-    ASSERT_EQ(
-        0xFFFFu,
-        minijson::detail::parse_utf16_escape_sequence({'F', 'F', 'F', 'F'}));
+    minijson::const_buffer_context context(buffer, Length - 1);
+    return minijson::detail::read_utf16_code_unit(context);
+}
+
+TEST(minijson_reader_detail, read_utf16_code_unit)
+{
+    ASSERT_EQ(0x0000u, read_utf16_code_unit("0000"));
+    ASSERT_EQ(0x1000u, read_utf16_code_unit("1000"));
+    ASSERT_EQ(0x2345u, read_utf16_code_unit("2345"));
+    ASSERT_EQ(0x6789u, read_utf16_code_unit("6789"));
+    ASSERT_EQ(0xA6BCu, read_utf16_code_unit("A6BC"));
+    ASSERT_EQ(0xabcdu, read_utf16_code_unit("abcd"));
+    ASSERT_EQ(0xabcdu, read_utf16_code_unit("ABCD"));
+    ASSERT_EQ(0xEFefu, read_utf16_code_unit("EFef"));
+    ASSERT_EQ(0xFFFFu, read_utf16_code_unit("FFFF"));
+    ASSERT_EQ(0x1234u, read_utf16_code_unit("12345")); // reads four digits
 }
 
-TEST(minijson_reader_detail, parse_utf16_escape_sequence_invalid)
+TEST(minijson_reader_detail, read_utf16_code_unit_invalid)
 {
-    ASSERT_THROW(
-        minijson::detail::parse_utf16_escape_sequence({'f', 'f', 'F', 'p'}),
-        minijson::detail::encoding_error);
-    ASSERT_THROW(
-        minijson::detail::parse_utf16_escape_sequence({'-', 'b', 'c', 'd'}),
-        minijson::detail::encoding_error);
-    ASSERT_THROW(
-        minijson::detail::parse_utf16_escape_sequence({' ', 'a', 'b', 'c'}),
-        minijson::detail::encoding_error);
-    ASSERT_THROW(
-        minijson::detail::parse_utf16_escape_sequence({'a', 'b', 'c', 0}),
-        minijson::detail::encoding_error);
+    const auto check = [](const auto& buffer, const auto expected_reason)
+    {
+        SCOPED_TRACE(buffer);
+        try
+        {
+            read_utf16_code_unit(buffer);
+            FAIL();
+        }
+        catch (const minijson::parse_error& parse_error)
+        {
+            ASSERT_EQ(expected_reason, parse_error.reason());
+        }
+    };
+
+    check("ffFp", minijson::parse_error::INVALID_ESCAPE_SEQUENCE);
+    check("-bcd", minijson::parse_error::INVALID_ESCAPE_SEQUENCE);
+    check(" abc", minijson::parse_error::INVALID_ESCAPE_SEQUENCE);
+    check("abcg", minijson::parse_error::INVALID_ESCAPE_SEQUENCE);
+    check("abc", minijson::parse_error::UNTERMINATED_VALUE);
 }
 
 static void test_write_utf8_char(
@@ -581,6 +617,105 @@ TEST(minijson_reader_detail, parse_string_invalid)
         minijson::parse_error::EXPECTED_UTF16_LOW_SURROGATE,
         6,
         "Expected UTF-16 low surrogate");
+
+    parse_string_invalid_helper(
+        "\\uD800\\n\\uDC00\"",
+        minijson::parse_error::EXPECTED_UTF16_LOW_SURROGATE,
+        7,
+        "Expected UTF-16 low surrogate");
+
+    parse_string_invalid_helper(
+        "\\uD800\\uDBFF\"",
+        minijson::parse_error::INVALID_UTF16_CHARACTER,
+        11,
+        "Invalid UTF-16 character");
+
+    parse_string_invalid_helper(
+        "\\u12",
+        minijson::parse_error::UNTERMINATED_VALUE,
+        3,
+        "Unterminated value");
+
+    parse_string_invalid_helper(
+        "\\uD800\\",
+        minijson::parse_error::UNTERMINATED_VALUE,
+        6,
+        "Unterminated value");
+
+    parse_string_invalid_helper(
+        "\\uD800\\u",
+        minijson::parse_error::UNTERMINATED_VALUE,
+        7,
+        "Unterminated value");
+}
+
+template<std::size_t Length>
+void parse_string_utf8_helper(
+    const char (&buffer)[Length],
+    const std::optional<std::size_t> expected_error_offset)
+{
+    SCOPED_TRACE(buffer);
+
+    // Without validation, the bytes are passed through
+    {
+        minijson::const_buffer_context context(buffer, Length - 1);
+        ASSERT_NO_THROW(minijson::detail::parse_string(context));
+    }
+
+    minijson::const_buffer_context context(buffer, Length - 1);
+    context.set_validate_utf8(true);
+    try
+    {
+        const std::string_view result =
+            minijson::detail::parse_string(context);
+        ASSERT_EQ(std::nullopt, expected_error_offset);
+        ASSERT_EQ(std::string_view(buffer, Length - 2), result);
+    }
+    catch (const minijson::parse_error& parse_error)
+    {
+        ASSERT_EQ(minijson::parse_error::INVALID_UTF8, parse_error.reason());
+        ASSERT_EQ(expected_error_offset, parse_error.offset());
+        ASSERT_STREQ("Invalid UTF-8", parse_error.what());
+    }
+}
+
+TEST(minijson_reader_detail, parse_string_validate_utf8)
+{
+    const minijson::const_buffer_context context("", 0);
+    ASSERT_FALSE(context.validate_utf8()); // default from MJR_VALIDATE_UTF8
+
+    // Valid, including the boundaries of each range
+    parse_string_utf8_helper("ascii only\"", std::nullopt);
+    parse_string_utf8_helper("\xC2\x80" "\xDF\xBF\"", std::nullopt);
+    parse_string_utf8_helper("\xE0\xA0\x80" "\xED\x9F\xBF\"", std::nullopt);
+    parse_string_utf8_helper("\xEE\x80\x80" "\xEF\xBF\xBF\"", std::nullopt);
+    parse_string_utf8_helper(
+        "\xF0\x90\x80\x80" "\xF4\x8F\xBF\xBF\"",
+        std::nullopt);
+    parse_string_utf8_helper(
+        "a\xC3\xA0" "b\xE4\xBD\xA0" "c\xF0\x9F\x98\x80" "d\"",
+        std::nullopt);
+
+    // Unexpected continuation byte
+    parse_string_utf8_helper("a\x80\"", 1);
+    parse_string_utf8_helper("\xC3\xA0\xA0\"", 2);
+
+    // Invalid leading byte
+    parse_string_utf8_helper("\xC0\x80\"", 0);
+    parse_string_utf8_helper("\xC1\xBF\"", 0);
+    parse_string_utf8_helper("\xF5\x80\x80\x80\"", 0);
+    parse_string_utf8_helper("ab\xFF\"", 2);
+
+    // Overlong encodings, UTF-16 surrogates and code points above U+10FFFF
+    parse_string_utf8_helper("\xE0\x9F\xBF\"", 1);
+    parse_string_utf8_helper("\xED\xA0\x80\"", 1);
+    parse_string_utf8_helper("\xF0\x8F\xBF\xBF\"", 1);
+    parse_string_utf8_helper("\xF4\x90\x80\x80\"", 1);
+
+    // Truncated characters
+    parse_string_utf8_helper("\xE4\xBD" "a\"", 2);
+    parse_string_utf8_helper("\xC3\"", 1);
+    parse_string_utf8_helper("\xF0\x9F\x98\\n\"", 3);
 }
 
 TEST(minijson_reader, value_default_constructed)
@@ -2176,7 +2311,7 @@ TEST(minijson_reader, parse_object_invalid)
         "[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":["
         "]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}",
         minijson::parse_error::EXCEEDED_NESTING_LIMIT,
-        "Exceeded nesting limit (32)");
+        "Exceeded nesting limit");
 }
 
 TEST(minijson_reader, parse_array_invalid)
@@ -2290,7 +2425,7 @@ TEST(minijson_reader, parse_array_invalid)
         "[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{\"\":[{"
         "}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]}]",
         minijson::parse_error::EXCEEDED_NESTING_LIMIT,
-        "Exceeded nesting limit (32)");
+        "Exceeded nesting limit");
 }
 
 TEST(minijson_reader, nested_not_parsed)
@@ -2336,6 +2471,424 @@ TEST(minijson_reader, nested_not_parsed)
     }
 }
 
+TEST(minijson_reader, capture)
+{
+    const char buffer[] =
+        "{\"a\":1,\"payload\": {\"x\":[1,\"]}\\\"\",{\"y\":null}]} ,"
+        "\"list\":[ [], {} ],\"tail\":\"\\u0041-long-enough-to-overwrite\"}";
+
+    const auto test = [&](auto& context)
+    {
+        std::string payload;
+        std::string list;
+        std::bitset<4> flags;
+
+        minijson::parse_object(
+            context,
+            [&](std::string_view name, minijson::value v, auto& ctx)
+            {
+                if (name == "a")
+                {
+                    flags[0] = 1;
+                    ASSERT_EQ("", minijson::capture(ctx));
+                    ASSERT_EQ(1, v.as<int>());
+                }
+                else if (name == "payload")
+                {
+                    flags[1] = 1;
+                    ASSERT_EQ(minijson::Object, v.type());
+                    payload = minijson::capture(ctx);
+                }
+                else if (name == "list")
+                {
+                    flags[2] = 1;
+                    ASSERT_EQ(minijson::Array, v.type());
+                    list = minijson::capture(ctx);
+                }
+                else if (name == "tail")
+                {
+                    flags[3] = 1;
+                    ASSERT_EQ(
+                        "A-long-enough-to-overwrite",
+                        v.as<std::string_view>());
+                }
+                else
+                {
+                    FAIL();
+                }
+            });
+
+        ASSERT_TRUE(flags.all());
+        ASSERT_EQ("{\"x\":[1,\"]}\\\"\",{\"y\":null}]}", payload);
+        ASSERT_EQ("[ [], {} ]", list);
+    };
+
+    {
+        minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+        test(context);
+    }
+    {
+        char copy[sizeof(buffer)];
+        std::copy_n(buffer, sizeof(buffer), copy);
+        minijson::buffer_context context(copy, sizeof(copy) - 1);
+        test(context);
+    }
+}
+
+TEST(minijson_reader, capture_const_buffer_context_lifetime)
+{
+    const char buffer[] = "[{\"a\":\"\\n\"},\"some string\",[true]]";
+    minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+
+    std::vector<std::string_view> captured;
+    minijson::parse_array(
+        context,
+        [&](minijson::value v)
+        {
+            if (v.type() == minijson::String)
+            {
+                return;
+            }
+            captured.push_back(minijson::capture(context));
+        });
+
+    // The input buffer is untouched, hence the captured spans stay valid
+    ASSERT_EQ(2U, captured.size());
+    ASSERT_EQ("{\"a\":\"\\n\"}", captured[0]);
+    ASSERT_EQ("[true]", captured[1]);
+    ASSERT_EQ(buffer + 1, captured[0].data());
+}
+
+TEST(minijson_reader, capture_invalid)
+{
+    const auto test = [](
+        const char* buffer,
+        const minijson::parse_error::error_reason expected_reason)
+    {
+        SCOPED_TRACE(buffer);
+        minijson::const_buffer_context context(buffer, strlen(buffer));
+
+        try
+        {
+            minijson::parse_array(
+                context,
+                [&](minijson::value) {minijson::capture(context);});
+            FAIL(); // should never get here
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(expected_reason, e.reason());
+        }
+    };
+
+    test("[{\"a\" 1}]", minijson::parse_error::EXPECTED_COLON);
+    test("[[1 2]]", minijson::parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    test("[[\"\\u0000\"]]", minijson::parse_error::NULL_UTF16_CHARACTER);
+    test("[[[]", minijson::parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET);
+    test(
+        "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]",
+        minijson::parse_error::EXCEEDED_NESTING_LIMIT);
+}
+
+TEST(minijson_reader, defer)
+{
+    const char buffer[] =
+        "{\"name\":\"shards\",\"shards\":[[1,2,3],[4,5],[],[6]],"
+        "\"meta\":{\"count\":4}}";
+    minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+
+    std::vector<minijson::deferred_value> work_items;
+    minijson::deferred_value meta;
+
+    minijson::parse_object(
+        context,
+        [&](std::string_view name, minijson::value v)
+        {
+            if (name == "shards")
+            {
+                minijson::parse_array(
+                    context,
+                    [&](minijson::value)
+                    {
+                        work_items.push_back(minijson::defer(context));
+                    });
+            }
+            else if (name == "meta")
+            {
+                meta = minijson::defer(context);
+            }
+            else
+            {
+                ASSERT_EQ(minijson::Null, minijson::defer(context).type());
+                ASSERT_EQ("shards", v.as<std::string_view>());
+            }
+        });
+
+    ASSERT_EQ(4U, work_items.size());
+    ASSERT_EQ(minijson::Array, work_items[0].type());
+    ASSERT_EQ("[1,2,3]", work_items[0].raw());
+    ASSERT_EQ(2U, work_items[0].nesting_level());
+    ASSERT_EQ(minijson::Object, meta.type());
+    ASSERT_EQ("{\"count\":4}", meta.raw());
+    ASSERT_EQ(1U, meta.nesting_level());
+
+    std::vector<int> sums(work_items.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < work_items.size(); ++i)
+    {
+        threads.emplace_back(
+            [&, i]
+            {
+                minijson::const_buffer_context ctx(work_items[i]);
+                ASSERT_EQ(2U, ctx.nesting_level());
+                minijson::parse_array(
+                    ctx,
+                    [&](minijson::value v) {sums[i] += v.as<int>();});
+                ASSERT_EQ(1U, ctx.nesting_level());
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ((std::vector<int> {6, 9, 0, 6}), sums);
+
+    minijson::const_buffer_context meta_context(meta);
+    minijson::parse_object(
+        meta_context,
+        [&](std::string_view name, minijson::value v)
+        {
+            ASSERT_EQ("count", name);
+            ASSERT_EQ(4, v.as<int>());
+        });
+}
+
+TEST(minijson_reader, defer_nesting_limit)
+{
+    // The nesting level is preserved in the deferred context, so the nesting
+    // limit is enforced as if the value was parsed in place
+    const minijson::deferred_value deferred(minijson::Array, "[[]]", 32);
+    minijson::const_buffer_context context(deferred);
+
+    try
+    {
+        minijson::parse_array(context, minijson::detail::ignore(context));
+        FAIL(); // should never get here
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXCEEDED_NESTING_LIMIT, e.reason());
+    }
+}
+
+TEST(minijson_reader, validate_utf8)
+{
+    const auto check_invalid = [](auto&& parse, const std::size_t offset)
+    {
+        try
+        {
+            parse();
+            FAIL(); // should never get here
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(minijson::parse_error::INVALID_UTF8, e.reason());
+            ASSERT_EQ(offset, e.offset());
+        }
+    };
+
+    // Field names are validated as well as string values
+    const std::string bad_name = "{\"a\xC3\":1}";
+    const std::string bad_value = "{\"a\":[{\"b\":\"\xC3\"}]}";
+
+    minijson::const_buffer_context context(bad_name.data(), bad_name.size());
+    minijson::parse_object(context, minijson::detail::ignore(context));
+
+    context.reset(bad_name.data(), bad_name.size());
+    context.set_validate_utf8(true);
+    check_invalid(
+        [&]
+        {
+            minijson::parse_object(
+                context,
+                minijson::detail::ignore(context));
+        },
+        4);
+
+    // The setting survives a reset, and ignored values are validated too
+    context.reset(bad_value.data(), bad_value.size());
+    ASSERT_TRUE(context.validate_utf8());
+    check_invalid(
+        [&]
+        {
+            minijson::parse_object(
+                context,
+                minijson::detail::ignore(context));
+        },
+        13);
+
+    // Deferred values keep the setting of the context they come from
+    const std::string nested = "{\"a\":[\"\xC3\xA0\"]}";
+    context.reset(nested.data(), nested.size());
+    minijson::deferred_value deferred;
+    minijson::parse_object(
+        context,
+        [&](std::string_view, minijson::value)
+        {
+            deferred = minijson::defer(context);
+        });
+    ASSERT_TRUE(deferred.validate_utf8());
+
+    const minijson::deferred_value bad_deferred(
+        minijson::Array,
+        "[\"\xC3\"]",
+        1,
+        MJR_NESTING_LIMIT,
+        true);
+    minijson::const_buffer_context deferred_context(bad_deferred);
+    ASSERT_TRUE(deferred_context.validate_utf8());
+    check_invalid(
+        [&]
+        {
+            minijson::parse_array(
+                deferred_context,
+                minijson::detail::ignore(deferred_context));
+        },
+        3);
+
+    // Valid UTF-8 passes
+    const std::string good = "{\"\xC3\xA0\":\"\xF0\x9F\x98\x80\"}";
+    context.reset(good.data(), good.size());
+    std::string name;
+    std::string value;
+    minijson::parse_object(
+        context,
+        [&](std::string_view n, minijson::value v)
+        {
+            name = n;
+            value = v.as<std::string_view>();
+        });
+    ASSERT_EQ("\xC3\xA0", name);
+    ASSERT_EQ("\xF0\x9F\x98\x80", value);
+}
+
+TEST(minijson_reader, nesting_limit)
+{
+    const std::string deep = std::string(250, '[') + std::string(250, ']');
+
+    // The default limit comes from MJR_NESTING_LIMIT
+    {
+        minijson::const_buffer_context context(deep.data(), deep.size());
+        ASSERT_EQ(32U, context.nesting_limit());
+        try
+        {
+            minijson::parse_array(context, minijson::detail::ignore(context));
+            FAIL(); // should never get here
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(
+                minijson::parse_error::EXCEEDED_NESTING_LIMIT,
+                e.reason());
+        }
+    }
+
+    // The limit can be raised at runtime, and the limit survives a move
+    {
+        minijson::const_buffer_context temp(deep.data(), deep.size());
+        temp.set_nesting_limit(249);
+        minijson::const_buffer_context context(std::move(temp));
+        ASSERT_EQ(249U, context.nesting_limit());
+        minijson::parse_array(context, minijson::detail::ignore(context));
+        ASSERT_EQ(0U, context.nesting_level());
+    }
+    {
+        minijson::const_buffer_context context(deep.data(), deep.size());
+        context.set_nesting_limit(248);
+        ASSERT_THROW(
+            minijson::parse_array(context, minijson::detail::ignore(context)),
+            minijson::parse_error);
+    }
+
+    // ...and it can be lowered
+    {
+        char buffer[] = "{\"a\":{\"b\":{}}}";
+        minijson::buffer_context context(buffer, sizeof(buffer) - 1);
+        context.set_nesting_limit(1);
+        try
+        {
+            minijson::parse_object(
+                context,
+                [&](std::string_view, minijson::value)
+                {
+                    minijson::parse_object(
+                        context,
+                        [&](std::string_view, minijson::value)
+                        {
+                            minijson::parse_object(context, [](auto...) {});
+                        });
+                });
+            FAIL(); // should never get here
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(
+                minijson::parse_error::EXCEEDED_NESTING_LIMIT,
+                e.reason());
+        }
+    }
+}
+
+TEST(minijson_reader, nesting_limit_deferred)
+{
+    const std::string deep =
+        "{\"a\":" + std::string(100, '[') + std::string(100, ']') + "}";
+    minijson::const_buffer_context context(deep.data(), deep.size());
+    context.set_nesting_limit(100);
+
+    minijson::deferred_value deferred;
+    minijson::parse_object(
+        context,
+        [&](std::string_view, minijson::value)
+        {
+            deferred = minijson::defer(context);
+        });
+    ASSERT_EQ(1U, deferred.nesting_level());
+    ASSERT_EQ(100U, deferred.nesting_limit());
+
+    minijson::const_buffer_context deferred_context(deferred);
+    ASSERT_EQ(100U, deferred_context.nesting_limit());
+    // The 100 levels, the outermost one nested in the original object, are
+    // within the limit
+    ASSERT_EQ(
+        200U,
+        minijson::parse_array(
+            deferred_context,
+            minijson::detail::ignore(deferred_context)));
+}
+
+TEST(minijson_reader, ignore_deep_nesting)
+{
+    // Deeply nested values are ignored without recursion, so this does not
+    // consume any more stack than ignoring a flat array
+    std::string deep = "[";
+    for (std::size_t i = 0; i < 10000; ++i)
+    {
+        deep += "{\"a\":[";
+    }
+    for (std::size_t i = 0; i < 10000; ++i)
+    {
+        deep += "]}";
+    }
+    deep += "]";
+
+    minijson::const_buffer_context context(deep.data(), deep.size());
+    context.set_nesting_limit(20001);
+    minijson::parse_array(context, minijson::detail::ignore(context));
+    ASSERT_EQ(deep.size(), context.read_offset());
+}
+
 int main(int argc, char** argv)
 {
     testing::InitGoogleTest(&argc, argv);
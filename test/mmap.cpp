@@ -0,0 +1,496 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#ifdef MJR_HAS_MMAP
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+
+namespace
+{
+
+// A temporary file, removed on destruction
+class temporary_file final
+{
+public:
+    explicit temporary_file(const std::string_view content)
+    {
+        m_fd = mkstemp(m_path);
+        EXPECT_NE(-1, m_fd);
+        EXPECT_EQ(
+            static_cast<ssize_t>(content.size()),
+            ::write(m_fd, content.data(), content.size()));
+    }
+
+    temporary_file(const temporary_file&) = delete;
+    temporary_file& operator=(const temporary_file&) = delete;
+
+    ~temporary_file()
+    {
+        close(m_fd);
+        unlink(m_path);
+    }
+
+    int fd() const noexcept
+    {
+        return m_fd;
+    }
+
+    const char* path() const noexcept
+    {
+        return m_path;
+    }
+
+private:
+    char m_path[32] = "/tmp/minijson_mmap_XXXXXX";
+    int m_fd;
+};
+
+std::string generate_message(const std::size_t count)
+{
+    std::string message = "[";
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            message += ',';
+        }
+        message += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\\t" +
+            std::to_string(i) + "\"}";
+    }
+    message += ']';
+
+    return message;
+}
+
+template<typename Context>
+std::vector<std::string> parse_message(Context& context)
+{
+    std::vector<std::string> names;
+    minijson::parse_array(
+        context,
+        [&](minijson::value)
+        {
+            minijson::parse_object(
+                context,
+                [&](std::string_view field, minijson::value v)
+                {
+                    if (field == "name")
+                    {
+                        names.emplace_back(v.as<std::string_view>());
+                    }
+                });
+        });
+
+    return names;
+}
+
+// Parses {"id":...,"name":"..."} messages
+std::pair<int, std::string> parse_record(minijson::buffer_context& context)
+{
+    std::pair<int, std::string> result;
+    minijson::parse_object(
+        context,
+        [&](std::string_view field, minijson::value v)
+        {
+            if (field == "id")
+            {
+                v.to(result.first);
+            }
+            else
+            {
+                result.second = v.as<std::string_view>();
+            }
+        });
+
+    return result;
+}
+
+std::string record(const int id)
+{
+    return "{\"id\":" + std::to_string(id) + ",\"name\":\"n\\u00e8" +
+        std::string(id % 13, 'x') + "\"}";
+}
+
+} // namespace
+
+TEST(minijson_mmap, parse)
+{
+    const std::string message = generate_message(20000);
+    const temporary_file file(message);
+
+    minijson::const_buffer_context reference_context(
+        message.data(),
+        message.size());
+    const std::vector<std::string> expected = parse_message(reference_context);
+    ASSERT_EQ(20000U, expected.size());
+    ASSERT_EQ("item\t19999", expected.back());
+
+    const std::size_t page_size =
+        static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    for (const std::size_t window_size :
+        {
+            std::size_t(0),
+            page_size,
+            4 * page_size,
+            9 * page_size + 1,
+            minijson::mmap_context::DEFAULT_WINDOW_SIZE,
+        })
+    {
+        SCOPED_TRACE(window_size);
+
+        minijson::mmap_context context(file.fd(), window_size);
+        ASSERT_EQ(0U, context.window_size() % page_size);
+        ASSERT_LE(4 * page_size, context.window_size());
+
+        ASSERT_EQ(expected, parse_message(context));
+        ASSERT_EQ(message.size(), context.read_offset());
+
+        // The end of the file is sticky
+        ASSERT_EQ(0, context.read());
+        ASSERT_EQ(0, context.read());
+        ASSERT_EQ(message.size(), context.read_offset());
+    }
+}
+
+TEST(minijson_mmap, parse_error)
+{
+    std::string message = generate_message(1000);
+    message.back() = '}';
+    const temporary_file file(message);
+
+    minijson::mmap_context context(file.fd(), 0);
+    try
+    {
+        parse_message(context);
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(
+            minijson::parse_error::EXPECTED_COMMA_OR_CLOSING_BRACKET,
+            e.reason());
+        ASSERT_EQ(message.size() - 1, e.offset());
+    }
+}
+
+TEST(minijson_mmap, empty_file)
+{
+    const temporary_file file("");
+
+    minijson::mmap_context context(file.fd());
+    ASSERT_EQ(0, context.read());
+    ASSERT_EQ(0U, context.read_offset());
+}
+
+TEST(minijson_mmap, errors)
+{
+    ASSERT_THROW(minijson::mmap_context(-1), std::system_error);
+
+    // A file open for writing only cannot be mapped for reading
+    const temporary_file file("[]");
+    const int fd = open(file.path(), O_WRONLY);
+    ASSERT_NE(-1, fd);
+    minijson::mmap_context context(fd);
+    ASSERT_THROW(context.read(), std::system_error);
+    close(fd);
+}
+
+TEST(minijson_mmap, move)
+{
+    const temporary_file file1("[1,2]");
+    const temporary_file file2("[3,4,5]");
+
+    minijson::mmap_context context1(file1.fd());
+    ASSERT_EQ('[', context1.read());
+
+    minijson::mmap_context context2(std::move(context1));
+    ASSERT_EQ('1', context2.read());
+    ASSERT_EQ(2U, context2.read_offset());
+
+    context1 = minijson::mmap_context(file2.fd());
+    std::vector<int> values;
+    minijson::parse_array(
+        context1,
+        [&](minijson::value v) { values.push_back(v.as<int>()); });
+    ASSERT_EQ((std::vector<int>{3, 4, 5}), values);
+
+    context1 = std::move(context2);
+    ASSERT_EQ(',', context1.read());
+    ASSERT_EQ('2', context1.read());
+    ASSERT_EQ(']', context1.read());
+    ASSERT_EQ(0, context1.read());
+
+    // Self-assignment is harmless
+    minijson::mmap_context& self = context1;
+    context1 = std::move(self);
+    ASSERT_EQ(0, context1.read());
+}
+
+TEST(minijson_shm_ring, write_and_consume)
+{
+    const temporary_file file("");
+    minijson::shm_ring producer = minijson::shm_ring::create(file.fd(), 100);
+    ASSERT_EQ(104U, producer.capacity());
+    minijson::shm_ring consumer = minijson::shm_ring::attach(file.fd());
+    ASSERT_EQ(104U, consumer.capacity());
+
+    const auto consume_failing = [](minijson::buffer_context&)
+    {
+        FAIL();
+    };
+    ASSERT_FALSE(consumer.try_consume(consume_failing));
+
+    // The ring wraps around many times, with messages of varying sizes
+    int written = 0;
+    int consumed = 0;
+    while (consumed < 1000)
+    {
+        while (written < 1000 && producer.try_write(record(written)))
+        {
+            ++written;
+        }
+        ASSERT_LT(consumed, written);
+
+        const bool result = consumer.try_consume(
+            [&](minijson::buffer_context& context)
+            {
+                const auto [id, name] = parse_record(context);
+                ASSERT_EQ(consumed, id);
+                ASSERT_EQ("n\u00e8" + std::string(id % 13, 'x'), name);
+            });
+        ASSERT_TRUE(result);
+        ++consumed;
+    }
+    ASSERT_FALSE(consumer.try_consume(consume_failing));
+
+    // An empty message can be written as well
+    ASSERT_TRUE(producer.try_write(""));
+    ASSERT_TRUE(
+        consumer.try_consume(
+            [](minijson::buffer_context& context)
+            {
+                ASSERT_EQ(0, context.read());
+            }));
+}
+
+TEST(minijson_shm_ring, full)
+{
+    const temporary_file file("");
+    minijson::shm_ring ring = minijson::shm_ring::create(file.fd(), 0);
+    ASSERT_EQ(8U, ring.capacity());
+
+    ASSERT_TRUE(ring.try_write("1234"));
+    ASSERT_FALSE(ring.try_write("1"));
+    ASSERT_THROW(ring.try_write("12345"), std::length_error);
+}
+
+TEST(minijson_shm_ring, wrap_empty_ring)
+{
+    const temporary_file file("");
+    minijson::shm_ring ring = minijson::shm_ring::create(file.fd(), 64);
+    const auto consume_failing = [](minijson::buffer_context&)
+    {
+        FAIL();
+    };
+
+    // Empties the ring, with the tail 40 bytes in
+    ASSERT_TRUE(ring.try_write(std::string(36, ' ')));
+    ASSERT_TRUE(ring.try_consume([](minijson::buffer_context&) {}));
+
+    // The 48-byte frame does not fit in the 24 bytes left before the end of
+    // the ring: the first attempt only writes the padding, which the
+    // consumer skips, so that the next attempt starts at the beginning
+    const std::string message = "[" + std::string(42, ' ') + "]";
+    ASSERT_FALSE(ring.try_write(message));
+    ASSERT_FALSE(ring.try_consume(consume_failing));
+    ASSERT_TRUE(ring.try_write(message));
+    ASSERT_TRUE(
+        ring.try_consume(
+            [&](minijson::buffer_context& context)
+            {
+                ASSERT_EQ(
+                    message.size(),
+                    minijson::parse_array(
+                        context,
+                        [](minijson::value)
+                        {
+                            FAIL();
+                        }));
+            }));
+    ASSERT_FALSE(ring.try_consume(consume_failing));
+
+    // The padding is not written if even it does not fit
+    ASSERT_TRUE(ring.try_write(std::string(36, ' ')));
+    ASSERT_FALSE(ring.try_write(std::string(36, ' ')));
+    ASSERT_TRUE(ring.try_consume([](minijson::buffer_context&) {}));
+    ASSERT_FALSE(ring.try_consume(consume_failing));
+}
+
+TEST(minijson_shm_ring, handler_error)
+{
+    const temporary_file file("");
+    minijson::shm_ring ring = minijson::shm_ring::create(file.fd(), 64);
+    ASSERT_TRUE(ring.try_write("{\"id\":}"));
+    ASSERT_TRUE(ring.try_write(record(1)));
+
+    // The frame is released even if parsing fails
+    ASSERT_THROW(ring.try_consume(parse_record), minijson::parse_error);
+    ASSERT_TRUE(
+        ring.try_consume(
+            [](minijson::buffer_context& context)
+            {
+                ASSERT_EQ(1, parse_record(context).first);
+            }));
+}
+
+TEST(minijson_shm_ring, errors)
+{
+    ASSERT_THROW(minijson::shm_ring::create(-1, 64), std::system_error);
+    ASSERT_THROW(minijson::shm_ring::attach(-1), std::system_error);
+
+    {
+        const temporary_file file("too short");
+        ASSERT_THROW(
+            minijson::shm_ring::attach(file.fd()),
+            minijson::shm_ring_error);
+    }
+    {
+        const temporary_file file(std::string(200, 'x'));
+        ASSERT_THROW(
+            minijson::shm_ring::attach(file.fd()),
+            minijson::shm_ring_error);
+    }
+    {
+        // The consumer needs to write to the shared memory
+        const temporary_file file("");
+        minijson::shm_ring::create(file.fd(), 64);
+        const int fd = open(file.path(), O_RDONLY);
+        ASSERT_NE(-1, fd);
+        ASSERT_THROW(minijson::shm_ring::attach(fd), std::system_error);
+        close(fd);
+    }
+}
+
+TEST(minijson_shm_ring, corrupted)
+{
+    const auto consume = [](minijson::buffer_context&) {};
+
+    for (const std::uint32_t length : {60U, minijson::shm_ring::PADDING})
+    {
+        const temporary_file file("");
+        minijson::shm_ring ring = minijson::shm_ring::create(file.fd(), 64);
+        ASSERT_TRUE(ring.try_write("{}"));
+        ASSERT_EQ(
+            static_cast<ssize_t>(sizeof(length)),
+            pwrite(
+                file.fd(),
+                &length,
+                sizeof(length),
+                minijson::shm_ring::DATA_OFFSET));
+        ASSERT_THROW(ring.try_consume(consume), minijson::shm_ring_error);
+    }
+}
+
+TEST(minijson_shm_ring, move)
+{
+    const temporary_file file1("");
+    const temporary_file file2("");
+
+    minijson::shm_ring ring1 = minijson::shm_ring::create(file1.fd(), 64);
+    ASSERT_TRUE(ring1.try_write(record(1)));
+
+    minijson::shm_ring ring2(std::move(ring1));
+    ring1 = minijson::shm_ring::create(file2.fd(), 64);
+    ASSERT_TRUE(ring1.try_write(record(2)));
+
+    ring1 = std::move(ring2);
+    ASSERT_TRUE(
+        ring1.try_consume(
+            [](minijson::buffer_context& context)
+            {
+                ASSERT_EQ(1, parse_record(context).first);
+            }));
+
+    // Self-assignment is harmless
+    minijson::shm_ring& self = ring1;
+    ring1 = std::move(self);
+    ASSERT_EQ(64U, ring1.capacity());
+}
+
+TEST(minijson_shm_ring, processes)
+{
+    const temporary_file file("");
+    minijson::shm_ring ring = minijson::shm_ring::create(file.fd(), 256);
+
+    const pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0)
+    {
+        // The producer process attaches to the ring on its own
+        minijson::shm_ring producer = minijson::shm_ring::attach(file.fd());
+        for (int i = 0; i < 10000; ++i)
+        {
+            while (!producer.try_write(record(i)))
+            {
+                std::this_thread::yield();
+            }
+        }
+        _exit(0);
+    }
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        const auto consume = [&](minijson::buffer_context& context)
+        {
+            ASSERT_EQ(i, parse_record(context).first);
+        };
+        while (!ring.try_consume(consume))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+}
+
+#endif // MJR_HAS_MMAP
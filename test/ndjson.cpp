@@ -0,0 +1,466 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+constexpr std::string_view records =
+    "{\"id\":1,\"name\":\"a\"}\n"
+    "\n"
+    "  {\"id\":2,\"name\":\"b\\nc\"}\r\n"
+    "\t\r\n"
+    "{\"name\":\"d\",\"id\":3,\"tags\":[1,{}]}";
+
+struct record
+{
+    int id = 0;
+    std::string name;
+};
+
+template<typename Parse>
+void test_records(const Parse& parse)
+{
+    using namespace minijson::handlers;
+
+    std::vector<record> result;
+    const minijson::const_buffer_context* previous_context = nullptr;
+
+    const std::size_t count = parse(
+        [&](minijson::const_buffer_context& context)
+        {
+            // The same context is reused for all the records
+            if (previous_context != nullptr)
+            {
+                ASSERT_EQ(previous_context, &context);
+            }
+            previous_context = &context;
+
+            record& r = result.emplace_back();
+            minijson::dispatcher
+            {
+                handler("id", [&](minijson::value v) { v.to(r.id); }),
+                handler(
+                    "name",
+                    [&](minijson::value v)
+                    {
+                        r.name = v.as<std::string_view>();
+                    }),
+                ignore_handler("tags"),
+            }.run(context);
+        });
+
+    ASSERT_EQ(3U, count);
+    ASSERT_EQ(3U, result.size());
+    ASSERT_EQ(1, result[0].id);
+    ASSERT_EQ("a", result[0].name);
+    ASSERT_EQ(2, result[1].id);
+    ASSERT_EQ("b\nc", result[1].name);
+    ASSERT_EQ(3, result[2].id);
+    ASSERT_EQ("d", result[2].name);
+}
+
+template<typename Parse>
+void check_record_error(
+    const Parse& parse,
+    const std::size_t expected_index,
+    const std::size_t expected_offset,
+    const minijson::parse_error::error_reason expected_reason,
+    const std::size_t expected_parse_error_offset)
+{
+    try
+    {
+        parse(
+            [](minijson::const_buffer_context& context)
+            {
+                minijson::parse_object(
+                    context,
+                    [&](std::string_view, minijson::value)
+                    {
+                        minijson::ignore(context);
+                    });
+            });
+        FAIL();
+    }
+    catch (const minijson::record_error& e)
+    {
+        ASSERT_EQ(expected_index, e.index());
+        ASSERT_EQ(expected_offset, e.offset());
+        ASSERT_STREQ("Error while parsing record", e.what());
+        try
+        {
+            std::rethrow_if_nested(e);
+            FAIL();
+        }
+        catch (const minijson::parse_error& nested)
+        {
+            ASSERT_EQ(expected_reason, nested.reason());
+            ASSERT_EQ(expected_parse_error_offset, nested.offset());
+        }
+    }
+}
+
+auto parse_buffer(const std::string_view input)
+{
+    return [input](auto&& handler)
+    {
+        return minijson::parse_ndjson(input.data(), input.size(), handler);
+    };
+}
+
+auto parse_stream(const std::string_view input)
+{
+    return [input](auto&& handler)
+    {
+        std::istringstream stream{std::string(input)};
+        return minijson::parse_ndjson(stream, handler);
+    };
+}
+
+// The records above, as concatenated JSON
+constexpr std::string_view concatenated_records =
+    "{\"id\":1,\"name\":\"a\"}"
+    "{\"id\":2,\"name\":\"b\\nc\"}\r\n\t"
+    "{\"name\":\"d\",\"id\":3,\"tags\":[1,{\"s\":\"]}\\\"[{\"}]} ";
+
+auto parse_concatenated_buffer(const std::string_view input)
+{
+    return [input](auto&& handler)
+    {
+        return minijson::parse_concatenated(
+            input.data(),
+            input.size(),
+            handler);
+    };
+}
+
+auto parse_concatenated_stream(const std::string_view input)
+{
+    return [input](auto&& handler)
+    {
+        std::istringstream stream{std::string(input)};
+        return minijson::parse_concatenated(stream, handler);
+    };
+}
+
+std::string frame(const std::string_view message)
+{
+    const std::size_t size = message.size();
+    std::string result = {
+        static_cast<char>(size >> 24),
+        static_cast<char>(size >> 16 & 0xff),
+        static_cast<char>(size >> 8 & 0xff),
+        static_cast<char>(size & 0xff),
+    };
+
+    return result.append(message);
+}
+
+auto parse_length_prefixed_buffer(const std::string_view input)
+{
+    return [input](auto&& handler)
+    {
+        return minijson::parse_length_prefixed(
+            input.data(),
+            input.size(),
+            handler);
+    };
+}
+
+auto parse_length_prefixed_stream(const std::string_view input)
+{
+    return [input](auto&& handler)
+    {
+        std::istringstream stream{std::string(input)};
+        return minijson::parse_length_prefixed(stream, handler);
+    };
+}
+
+// The records above, as length-prefixed frames, including an empty one
+const std::string length_prefixed_records =
+    frame("{\"id\":1,\"name\":\"a\"}") +
+    frame("") +
+    frame(" {\"id\":2,\"name\":\"b\\nc\"}\n") +
+    frame("{\"name\":\"d\",\"id\":3,\"tags\":[1,{}]}");
+
+template<typename Parse>
+void check_framing_error(const Parse& parse, const std::size_t offset)
+{
+    try
+    {
+        parse([](minijson::const_buffer_context&) {});
+        FAIL();
+    }
+    catch (const minijson::framing_error& e)
+    {
+        ASSERT_EQ(offset, e.offset());
+        ASSERT_STREQ("Truncated frame", e.what());
+    }
+}
+
+} // namespace
+
+TEST(minijson_ndjson, parse_ndjson_buffer)
+{
+    test_records(parse_buffer(records));
+    test_records(parse_buffer(std::string(records) + "\n"));
+}
+
+TEST(minijson_ndjson, parse_ndjson_stream)
+{
+    test_records(parse_stream(records));
+    test_records(parse_stream(std::string(records) + "\n"));
+}
+
+TEST(minijson_ndjson, empty)
+{
+    const auto handler = [](minijson::const_buffer_context&)
+    {
+        FAIL();
+    };
+
+    ASSERT_EQ(0U, parse_buffer("")(handler));
+    ASSERT_EQ(0U, parse_buffer("\n \n\r\n")(handler));
+    ASSERT_EQ(0U, parse_stream("")(handler));
+    ASSERT_EQ(0U, parse_stream("\n \n\r\n")(handler));
+}
+
+TEST(minijson_ndjson, skipped_records)
+{
+    // Records the handler does not read are neither parsed nor validated
+    const std::string_view input = "{\"a\":1}\nnot JSON\n{\"a\":3}\n";
+    std::size_t parsed = 0;
+    std::size_t count = 0;
+
+    const auto handler = [&](minijson::const_buffer_context& context)
+    {
+        if (count++ != 1)
+        {
+            minijson::parse_object(
+                context,
+                [](std::string_view, minijson::value) {});
+            ++parsed;
+        }
+    };
+
+    ASSERT_EQ(3U, parse_buffer(input)(handler));
+    ASSERT_EQ(2U, parsed);
+}
+
+TEST(minijson_ndjson, errors)
+{
+    const std::string_view invalid = "{}\n\n{\"a\":1}\n{\"a\":}\n{}";
+    check_record_error(
+        parse_buffer(invalid), 2, 12, minijson::parse_error::EXPECTED_VALUE, 5);
+    check_record_error(
+        parse_stream(invalid), 2, 12, minijson::parse_error::EXPECTED_VALUE, 5);
+
+    const std::string_view trailing = "{\"a\":1}\n{\"a\":[2]} \t,\n";
+    check_record_error(
+        parse_buffer(trailing),
+        1,
+        8,
+        minijson::parse_error::EXPECTED_END_OF_MESSAGE,
+        11);
+    check_record_error(
+        parse_stream(trailing),
+        1,
+        8,
+        minijson::parse_error::EXPECTED_END_OF_MESSAGE,
+        11);
+
+    const std::string_view two_objects = "{}{}";
+    check_record_error(
+        parse_buffer(two_objects),
+        0,
+        0,
+        minijson::parse_error::EXPECTED_END_OF_MESSAGE,
+        2);
+
+    const char expected_what[] = "Expected end of message";
+    ASSERT_STREQ(
+        expected_what,
+        minijson::parse_error(
+            minijson::buffer_context(nullptr, 0),
+            minijson::parse_error::EXPECTED_END_OF_MESSAGE).what());
+}
+
+TEST(minijson_ndjson, handler_errors)
+{
+    // Errors thrown by the handler are nested as well
+    const std::string_view input = "{\"a\":1}\n{\"a\":\"x\"}";
+    try
+    {
+        parse_buffer(input)(
+            [](minijson::const_buffer_context& context)
+            {
+                minijson::parse_object(
+                    context,
+                    [](std::string_view, minijson::value v)
+                    {
+                        v.as<int>();
+                    });
+            });
+        FAIL();
+    }
+    catch (const minijson::record_error& e)
+    {
+        ASSERT_EQ(1U, e.index());
+        ASSERT_EQ(8U, e.offset());
+        ASSERT_THROW(std::rethrow_if_nested(e), minijson::bad_value_cast);
+    }
+}
+
+TEST(minijson_ndjson, parse_concatenated)
+{
+    test_records(parse_concatenated_buffer(concatenated_records));
+    test_records(parse_concatenated_stream(concatenated_records));
+
+    const auto handler = [](minijson::const_buffer_context&)
+    {
+        FAIL();
+    };
+    ASSERT_EQ(0U, parse_concatenated_buffer("")(handler));
+    ASSERT_EQ(0U, parse_concatenated_buffer(" \n\t")(handler));
+    ASSERT_EQ(0U, parse_concatenated_stream("")(handler));
+    ASSERT_EQ(0U, parse_concatenated_stream(" \n\t")(handler));
+
+    // Top-level arrays are delimited as well
+    std::size_t arrays = 0;
+    const std::size_t count = parse_concatenated_buffer("[1,[2]][]")(
+        [&](minijson::const_buffer_context& context)
+        {
+            minijson::parse_array(
+                context,
+                [&](minijson::value)
+                {
+                    minijson::ignore(context);
+                });
+            ++arrays;
+        });
+    ASSERT_EQ(2U, count);
+    ASSERT_EQ(2U, arrays);
+}
+
+TEST(minijson_ndjson, parse_concatenated_errors)
+{
+    const auto check = [](const auto& parse)
+    {
+        check_record_error(
+            parse("{\"a\":1} {\"a\":}"),
+            1,
+            8,
+            minijson::parse_error::EXPECTED_VALUE,
+            5);
+        check_record_error(
+            parse("{}\n{\"a\":[1,2"),
+            1,
+            3,
+            minijson::parse_error::UNTERMINATED_VALUE,
+            8);
+        check_record_error(
+            parse("{} 42 {}"),
+            1,
+            3,
+            minijson::parse_error::EXPECTED_OPENING_BRACKET,
+            0);
+    };
+    check(parse_concatenated_buffer);
+    check(parse_concatenated_stream);
+}
+
+TEST(minijson_ndjson, parse_length_prefixed)
+{
+    test_records(parse_length_prefixed_buffer(length_prefixed_records));
+    test_records(parse_length_prefixed_stream(length_prefixed_records));
+
+    const auto handler = [](minijson::const_buffer_context&)
+    {
+        FAIL();
+    };
+    ASSERT_EQ(0U, parse_length_prefixed_buffer("")(handler));
+    ASSERT_EQ(0U, parse_length_prefixed_stream("")(handler));
+
+    // Frames longer than 255 bytes
+    const std::string long_message =
+        "{\"name\":\"" + std::string(70000, 'x') + "\"}";
+    std::size_t length = 0;
+    parse_length_prefixed_buffer(frame(long_message))(
+        [&](minijson::const_buffer_context& context)
+        {
+            minijson::parse_object(
+                context,
+                [&](std::string_view, minijson::value v)
+                {
+                    length = v.as<std::string_view>().size();
+                });
+        });
+    ASSERT_EQ(70000U, length);
+}
+
+TEST(minijson_ndjson, parse_length_prefixed_errors)
+{
+    const auto check = [](const auto& parse)
+    {
+        // The frame offset is reported
+        check_record_error(
+            parse(frame("{}") + frame("{\"a\":}")),
+            1,
+            6,
+            minijson::parse_error::EXPECTED_VALUE,
+            5);
+        check_record_error(
+            parse(frame("{} {}")),
+            0,
+            0,
+            minijson::parse_error::EXPECTED_END_OF_MESSAGE,
+            3);
+
+        // Truncated length
+        check_framing_error(parse(frame("{}") + std::string(2, '\0')), 6);
+
+        // Truncated message
+        check_framing_error(parse(frame("{}") + frame("{}").substr(0, 5)), 6);
+
+        // Truncated message with a huge length, which must not be trusted
+        // before the message is read
+        check_framing_error(
+            parse(frame("{}") + std::string(4, '\xff') + "{}"),
+            6);
+    };
+    check(parse_length_prefixed_buffer);
+    check(parse_length_prefixed_stream);
+}
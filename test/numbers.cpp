@@ -0,0 +1,559 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+// Outcome of parsing, either the parsed numbers or a description of the error
+template<typename T>
+struct outcome
+{
+    std::vector<T> numbers;
+    std::string error;
+    std::size_t read_offset = 0;
+
+    bool operator==(const outcome& other) const
+    {
+        return numbers == other.numbers &&
+            error == other.error &&
+            read_offset == other.read_offset;
+    }
+};
+
+template<typename T>
+std::ostream& operator<<(std::ostream& stream, const outcome<T>& o)
+{
+    stream << "[";
+    for (const T n : o.numbers)
+    {
+        stream << n << ",";
+    }
+    return stream << "] " << o.error << " @" << o.read_offset;
+}
+
+template<typename T, typename Context, typename Function>
+outcome<T> run(Context& context, Function&& function)
+{
+    outcome<T> result;
+    try
+    {
+        function(context, result.numbers);
+    }
+    catch (const minijson::parse_error& e)
+    {
+        result.error = e.what();
+    }
+    catch (const minijson::bad_value_cast&)
+    {
+        result.error = "bad_value_cast";
+    }
+    catch (const std::range_error&)
+    {
+        result.error = "range_error";
+    }
+    result.read_offset = context.read_offset();
+    return result;
+}
+
+// Parses a message with parse_number_array() using all types of context, and
+// checks the outcome matches that of parse_array() plus value::as<T>()
+template<typename T>
+void check_consistency(const std::string_view json)
+{
+    SCOPED_TRACE(json);
+
+    const auto reference =
+        [](auto& context, std::vector<T>& numbers)
+    {
+        minijson::parse_array(
+            context,
+            [&](const minijson::value v, auto& context)
+            {
+                if (v.type() != minijson::Number)
+                {
+                    minijson::ignore(context);
+                    throw minijson::bad_value_cast("");
+                }
+                numbers.push_back(v.as<T>());
+            });
+    };
+
+    const auto bulk = [](auto& context, std::vector<T>& numbers)
+    {
+        minijson::parse_number_array(context, numbers);
+    };
+
+    minijson::const_buffer_context reference_context(json.data(), json.size());
+    const outcome<T> expected = run<T>(reference_context, reference);
+
+    {
+        minijson::const_buffer_context context(json.data(), json.size());
+        const outcome<T> actual = run<T>(context, bulk);
+        if (expected.error == "bad_value_cast")
+        {
+            // Bail out as early as possible
+            ASSERT_EQ(expected.error, actual.error);
+        }
+        else
+        {
+            ASSERT_EQ(expected, actual);
+        }
+    }
+    {
+        std::string buffer(json);
+        minijson::buffer_context context(buffer.data(), buffer.size());
+        const outcome<T> actual = run<T>(context, bulk);
+        ASSERT_EQ(expected.numbers.size(), actual.numbers.size());
+        ASSERT_EQ(expected.error, actual.error);
+    }
+    {
+        std::istringstream stream{std::string(json)};
+        minijson::istream_context context(stream);
+        const outcome<T> actual = run<T>(context, bulk);
+        ASSERT_EQ(expected.numbers, actual.numbers);
+        ASSERT_EQ(expected.error, actual.error);
+    }
+}
+
+} // namespace {anonymous}
+
+TEST(minijson_numbers, parse_number_array)
+{
+    const char json[] = " [1, -2.5e3 ,0,\t1234567890123.25E-2,-0.5 ] x";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    std::vector<double> numbers {42};
+    ASSERT_EQ(
+        sizeof(json) - 3,
+        minijson::parse_number_array(context, numbers));
+    ASSERT_EQ(
+        (std::vector<double> {42, 1, -2500, 0, 12345678901.2325, -0.5}),
+        numbers);
+    ASSERT_EQ(sizeof(json) - 3, context.read_offset());
+    ASSERT_EQ(0U, context.nesting_level());
+}
+
+TEST(minijson_numbers, parse_number_array_integers)
+{
+    const char json[] = "[1,-2,123456789012,0]";
+
+    std::vector<std::int64_t> numbers;
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+    minijson::parse_number_array(context, numbers);
+    ASSERT_EQ(
+        (std::vector<std::int64_t> {1, -2, 123456789012, 0}),
+        numbers);
+
+    std::vector<std::int32_t> small_numbers;
+    minijson::const_buffer_context context2(json, sizeof(json) - 1);
+    ASSERT_THROW(
+        minijson::parse_number_array(context2, small_numbers),
+        std::range_error);
+    ASSERT_EQ(2U, small_numbers.size());
+}
+
+TEST(minijson_numbers, parse_number_array_nested)
+{
+    const char json[] = R"json({"a":[1, 2, 3],"b":[[4.5],[]],"c":[]})json";
+
+    const auto test = [&](auto& context)
+    {
+        std::vector<int> a;
+        std::vector<float> b;
+        minijson::parse_object(
+            context,
+            [&](const std::string_view name, minijson::value)
+            {
+                if (name == "a")
+                {
+                    minijson::parse_number_array(context, a);
+                }
+                else if (name == "b")
+                {
+                    minijson::parse_array(
+                        context,
+                        [&](minijson::value)
+                        {
+                            minijson::parse_number_array(context, b);
+                        });
+                }
+                else
+                {
+                    minijson::parse_number_array(context, a);
+                }
+            });
+
+        ASSERT_EQ((std::vector<int> {1, 2, 3}), a);
+        ASSERT_EQ((std::vector<float> {4.5}), b);
+    };
+
+    {
+        minijson::const_buffer_context context(json, sizeof(json) - 1);
+        test(context);
+    }
+    {
+        std::istringstream stream(json);
+        minijson::istream_context context(stream);
+        test(context);
+    }
+}
+
+TEST(minijson_numbers, parse_number_array_long)
+{
+    std::string json = "[";
+    std::vector<std::uint64_t> expected;
+    for (std::uint64_t i = 0; i < 10000; ++i)
+    {
+        expected.push_back(i * i * i * 12345);
+        json += (i == 0) ? "" : ((i % 3 == 0) ? ",\n" : ",");
+        json += std::to_string(expected.back());
+    }
+    json += "]";
+
+    std::vector<std::uint64_t> numbers;
+    minijson::const_buffer_context context(json.data(), json.size());
+    minijson::parse_number_array(context, numbers);
+    ASSERT_EQ(expected, numbers);
+}
+
+TEST(minijson_numbers, parse_number_array_consistency)
+{
+    for (const char* json :
+         {"[]", " [ ] ", "[0]", "[-0]", "[1.5e+3, 2E-3 , 3e2]",
+          "[12345678901234567890]", "[1]  ", "[ 1 , 2 ]",
+          "", "   ", "{}", "x", "[", "[ ", "[1", "[1 ", "[1,", "[1, ",
+          "[,]", "[1,]", "[1,,2]", "[1 2]", "[1}", "[1]]",
+          "[-]", "[-a]", "[01]", "[00]", "[1.]", "[1.a]", "[.5]", "[1e]",
+          "[1e+]", "[1ea]", "[1E-a]", "[+1]", "[1x]", "[0x1]", "[-", "[1.",
+          "[1e", "[12345678", "[123456789012345678901234567890",
+          "[123456789a123]", "[1234567:]", "[12345678/]", "[inf]", "[nan]",
+          "[\"1\"]", "[1, {}]", "[1, []]", "[true]", "[false]", "[null]",
+          "[1,\"a]"})
+    {
+        check_consistency<double>(json);
+        check_consistency<std::int64_t>(json);
+        check_consistency<std::uint8_t>(json);
+    }
+
+    const char json_with_null[] = "[1\0]";
+    check_consistency<int>({json_with_null, sizeof(json_with_null) - 1});
+}
+
+namespace minijson
+{
+
+// A conversion that parse_number_array() must not use
+template<>
+struct value_as<short>
+{
+    short operator()(value) const
+    {
+        return -1;
+    }
+};
+
+} // namespace minijson
+
+TEST(minijson_numbers, parse_number_array_ignores_value_as)
+{
+    char buffer[] = "[1, 2]";
+    {
+        minijson::const_buffer_context context(buffer, sizeof(buffer) - 1);
+        std::vector<short> numbers;
+        minijson::parse_number_array(context, numbers);
+        ASSERT_EQ((std::vector<short> {1, 2}), numbers);
+    }
+    {
+        std::istringstream stream(buffer);
+        minijson::istream_context context(stream);
+        std::vector<short> numbers;
+        minijson::parse_number_array(context, numbers);
+        ASSERT_EQ((std::vector<short> {1, 2}), numbers);
+    }
+}
+
+TEST(minijson_numbers, parse_number_array_nesting_limit)
+{
+    const char json[] = "[[[1]]]";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+    context.set_nesting_limit(1);
+
+    std::vector<int> numbers;
+    try
+    {
+        minijson::parse_array(
+            context,
+            [&](minijson::value)
+            {
+                minijson::parse_array(
+                    context,
+                    [&](minijson::value)
+                    {
+                        minijson::parse_number_array(context, numbers);
+                    });
+            });
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXCEEDED_NESTING_LIMIT, e.reason());
+    }
+}
+
+namespace
+{
+
+template<typename T>
+void check_nested_consistency(
+    const std::string_view json,
+    const std::size_t depth,
+    const bool require_rectangular = false)
+{
+    SCOPED_TRACE(json);
+
+    const auto parse = [&](auto& context, std::string& error)
+    {
+        minijson::nested_number_array<T> result;
+        try
+        {
+            minijson::parse_nested_number_array(
+                context,
+                depth,
+                result,
+                require_rectangular);
+        }
+        catch (const std::range_error&)
+        {
+            error = "range_error";
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        return result;
+    };
+
+    minijson::const_buffer_context buffer_context(json.data(), json.size());
+    std::string buffer_error;
+    const minijson::nested_number_array<T> buffer_result =
+        parse(buffer_context, buffer_error);
+
+    std::istringstream stream{std::string(json)};
+    minijson::istream_context stream_context(stream);
+    std::string stream_error;
+    const minijson::nested_number_array<T> stream_result =
+        parse(stream_context, stream_error);
+
+    ASSERT_EQ(buffer_error, stream_error);
+    if (buffer_error.empty())
+    {
+        ASSERT_EQ(buffer_result.values, stream_result.values);
+        ASSERT_EQ(buffer_result.offsets, stream_result.offsets);
+        ASSERT_EQ(buffer_result.shape, stream_result.shape);
+        ASSERT_EQ(buffer_context.read_offset(), stream_context.read_offset());
+    }
+}
+
+} // namespace {anonymous}
+
+TEST(minijson_numbers, parse_nested_number_array)
+{
+    const char json[] =
+        "[ [[1, 2], [3,4]] , [[5.5,6],[7,8] ], [ [9, 10] ,[11,12]]] x";
+
+    const auto test = [&](auto& context)
+    {
+        minijson::nested_number_array<double> result;
+        result.values.push_back(42); // must be cleared
+        ASSERT_EQ(
+            sizeof(json) - 3,
+            minijson::parse_nested_number_array(context, 3, result, true));
+
+        ASSERT_EQ(
+            (std::vector<double> {1, 2, 3, 4, 5.5, 6, 7, 8, 9, 10, 11, 12}),
+            result.values);
+        ASSERT_EQ(3U, result.offsets.size());
+        ASSERT_EQ((std::vector<std::size_t> {0, 3}), result.offsets[0]);
+        ASSERT_EQ((std::vector<std::size_t> {0, 2, 4, 6}), result.offsets[1]);
+        ASSERT_EQ(
+            (std::vector<std::size_t> {0, 2, 4, 6, 8, 10, 12}),
+            result.offsets[2]);
+        ASSERT_EQ((std::vector<std::size_t> {3, 2, 2}), result.shape);
+        ASSERT_EQ(0U, context.nesting_level());
+    };
+
+    {
+        minijson::const_buffer_context context(json, sizeof(json) - 1);
+        test(context);
+    }
+    {
+        std::istringstream stream(json);
+        minijson::istream_context context(stream);
+        test(context);
+    }
+}
+
+TEST(minijson_numbers, parse_nested_number_array_ragged)
+{
+    const char json[] = "[[[1,2,3]],[],[[4],[]]]";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    minijson::nested_number_array<int> result;
+    result.shape.push_back(42); // must be cleared
+    minijson::parse_nested_number_array(context, 3, result);
+
+    ASSERT_EQ((std::vector<int> {1, 2, 3, 4}), result.values);
+    ASSERT_EQ((std::vector<std::size_t> {0, 3}), result.offsets[0]);
+    ASSERT_EQ((std::vector<std::size_t> {0, 1, 1, 3}), result.offsets[1]);
+    ASSERT_EQ((std::vector<std::size_t> {0, 3, 4, 4}), result.offsets[2]);
+    ASSERT_TRUE(result.shape.empty());
+
+    minijson::const_buffer_context context2(json, sizeof(json) - 1);
+    try
+    {
+        minijson::parse_nested_number_array(context2, 3, result, true);
+        FAIL();
+    }
+    catch (const minijson::bad_value_cast& e)
+    {
+        ASSERT_STREQ(
+            "parse_nested_number_array(): array is not rectangular",
+            e.what());
+    }
+}
+
+TEST(minijson_numbers, parse_nested_number_array_nested)
+{
+    const char json[] = R"json({"type":"Polygon","coordinates":[[[1,2]]]})json";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+
+    minijson::nested_number_array<float> coordinates;
+    minijson::parse_object(
+        context,
+        [&](const std::string_view name, minijson::value)
+        {
+            if (name == "coordinates")
+            {
+                minijson::parse_nested_number_array(context, 3, coordinates);
+            }
+        });
+
+    ASSERT_EQ((std::vector<float> {1, 2}), coordinates.values);
+    ASSERT_EQ((std::vector<std::size_t> {1, 1, 2}), coordinates.shape);
+}
+
+TEST(minijson_numbers, parse_nested_number_array_invalid_depth)
+{
+    const char json[] = "[]";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+    minijson::nested_number_array<int> result;
+    ASSERT_THROW(
+        minijson::parse_nested_number_array(context, 0, result),
+        std::invalid_argument);
+}
+
+TEST(minijson_numbers, parse_nested_number_array_consistency)
+{
+    for (const char* json :
+         {"[]", "[[]]", "[[],[]]", "[[[]]]", "[[1,2],[3,4]]", "[[1],[2,3]]",
+          " [ [ 1 ] , [ ] ] ", "", "x", "[", "[[", "[[1", "[[1]",
+          "[[1],", "[[1],]", "[[1] [2]]", "[[1]}", "[1]", "[[1],2]",
+          "[\"a\"]", "[[1],\"a\"]", "[{}]", "[[1],{}]", "[[[1]]]",
+          "[[1,\"a\"]]", "[[1,[2]]]", "[[1,]]", "[[-]]", "[,]", "[[1],,]",
+          "[true]", "[[1],nul]", "[[1]] ]", "[[1e999]]"})
+    {
+        check_nested_consistency<double>(json, 2);
+        check_nested_consistency<int>(json, 2);
+        check_nested_consistency<int>(json, 2, true);
+        check_nested_consistency<double>(json, 1);
+        check_nested_consistency<double>(json, 3);
+    }
+}
+
+TEST(minijson_numbers, parse_nested_number_array_nesting_limit)
+{
+    const char json[] = "[[[[1]]]]";
+
+    for (const std::size_t limit : {0, 1, 2, 3, 4})
+    {
+        minijson::const_buffer_context buffer_context(json, sizeof(json) - 1);
+        buffer_context.set_nesting_limit(limit);
+        std::istringstream stream(json);
+        minijson::istream_context stream_context(stream);
+        stream_context.set_nesting_limit(limit);
+
+        minijson::nested_number_array<int> result;
+        if (limit < 3)
+        {
+            ASSERT_THROW(
+                minijson::parse_nested_number_array(buffer_context, 4, result),
+                minijson::parse_error);
+            ASSERT_THROW(
+                minijson::parse_nested_number_array(stream_context, 4, result),
+                minijson::parse_error);
+        }
+        else
+        {
+            minijson::parse_nested_number_array(buffer_context, 4, result);
+            ASSERT_EQ((std::vector<int> {1}), result.values);
+            minijson::parse_nested_number_array(stream_context, 4, result);
+            ASSERT_EQ((std::vector<int> {1}), result.values);
+        }
+    }
+}
+
+TEST(minijson_numbers, parse_nested_number_array_nesting_limit_nested)
+{
+    const char json[] = "[[[1]]]";
+    minijson::const_buffer_context context(json, sizeof(json) - 1);
+    context.set_nesting_limit(0);
+
+    minijson::nested_number_array<int> result;
+    try
+    {
+        minijson::parse_array(
+            context,
+            [&](minijson::value)
+            {
+                minijson::parse_nested_number_array(context, 2, result);
+            });
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXCEEDED_NESTING_LIMIT, e.reason());
+    }
+}
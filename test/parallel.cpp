@@ -0,0 +1,935 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t pool_sizes[] = {1, 2, 3, 8};
+
+int parse_id(minijson::const_buffer_context& context)
+{
+    int id = -1;
+    minijson::parse_object(
+        context,
+        [&](const std::string_view name, const minijson::value v)
+        {
+            if (name == "id")
+            {
+                v.to(id);
+            }
+            else
+            {
+                minijson::ignore(context);
+            }
+        });
+
+    return id;
+}
+
+// Generates records with increasing ids, with a few blank lines and a long
+// record here and there
+std::string generate_records(const int count)
+{
+    std::string result;
+    for (int i = 0; i < count; ++i)
+    {
+        result += "{\"id\":" + std::to_string(i) + ",\"payload\":[\"";
+        result += (i % 1000 == 500) ? std::string(40000, 'x') : "abc";
+        result += "\",{\"x\":\"}\\n{\"}]}\n";
+        if (i % 97 == 0)
+        {
+            result += " \r\n";
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST(minijson_parallel, thread_pool)
+{
+    ASSERT_EQ(1U, minijson::thread_pool(0).size());
+    ASSERT_EQ(1U, minijson::thread_pool(1).size());
+    ASSERT_EQ(4U, minijson::thread_pool(4).size());
+    ASSERT_LE(1U, minijson::thread_pool().size());
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        minijson::thread_pool pool(pool_size);
+
+        pool.run(0, [](std::size_t, std::size_t) { FAIL(); });
+
+        for (std::size_t count : {1, 7, 1000})
+        {
+            std::vector<std::atomic<int>> calls(count);
+            std::atomic<bool> bad_worker(false);
+            pool.run(
+                count,
+                [&](const std::size_t worker, const std::size_t index)
+                {
+                    bad_worker = bad_worker || (worker >= pool.size());
+                    ++calls[index];
+                });
+
+            ASSERT_FALSE(bad_worker);
+            for (const std::atomic<int>& c : calls)
+            {
+                ASSERT_EQ(1, c);
+            }
+        }
+    }
+}
+
+TEST(minijson_parallel, thread_pool_single_worker)
+{
+    minijson::thread_pool pool(1);
+    const std::thread::id caller = std::this_thread::get_id();
+
+    std::vector<std::size_t> order;
+    pool.run(
+        5,
+        [&](const std::size_t worker, const std::size_t index)
+        {
+            ASSERT_EQ(0U, worker);
+            ASSERT_EQ(caller, std::this_thread::get_id());
+            order.push_back(index);
+        });
+
+    ASSERT_EQ((std::vector<std::size_t> {0, 1, 2, 3, 4}), order);
+}
+
+TEST(minijson_parallel, thread_pool_many_batches)
+{
+    minijson::thread_pool pool(4);
+
+    std::atomic<std::size_t> sum(0);
+    for (std::size_t i = 0; i < 2000; ++i)
+    {
+        pool.run(
+            i % 5,
+            [&](std::size_t, const std::size_t index) { sum += index; });
+    }
+
+    // Each group of five batches adds 0 + 0 + 1 + 3 + 6
+    ASSERT_EQ(400U * 10U, sum);
+}
+
+TEST(minijson_parallel, thread_pool_exceptions)
+{
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        minijson::thread_pool pool(pool_size);
+
+        std::atomic<std::size_t> calls(0);
+        try
+        {
+            pool.run(
+                1000,
+                [&](std::size_t, const std::size_t index)
+                {
+                    ++calls;
+                    if (index == 10)
+                    {
+                        throw std::runtime_error("task failed");
+                    }
+                });
+            FAIL();
+        }
+        catch (const std::runtime_error& e)
+        {
+            ASSERT_STREQ("task failed", e.what());
+        }
+        if (pool_size == 1)
+        {
+            ASSERT_EQ(11U, calls);
+        }
+
+        // The pool is still usable
+        calls = 0;
+        pool.run(100, [&](std::size_t, std::size_t) { ++calls; });
+        ASSERT_EQ(100U, calls);
+    }
+}
+
+TEST(minijson_parallel, parse_ndjson)
+{
+    const std::string input = generate_records(10000);
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        std::atomic<long long> sum(0);
+        std::atomic<std::size_t> calls(0);
+        const std::size_t count = minijson::parse_ndjson(
+            pool,
+            input.data(),
+            input.size(),
+            [&](minijson::const_buffer_context& context)
+            {
+                sum += parse_id(context);
+                ++calls;
+            });
+
+        ASSERT_EQ(10000U, count);
+        ASSERT_EQ(10000U, calls);
+        ASSERT_EQ(9999LL * 10000LL / 2, sum);
+    }
+}
+
+TEST(minijson_parallel, parse_ndjson_ordered)
+{
+    const std::string input = generate_records(10000);
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        std::vector<int> ids;
+        const std::size_t count = minijson::parse_ndjson(
+            pool,
+            input.data(),
+            input.size(),
+            parse_id,
+            [&](const int id) { ids.push_back(id); });
+
+        ASSERT_EQ(10000U, count);
+        std::vector<int> expected(10000);
+        std::iota(expected.begin(), expected.end(), 0);
+        ASSERT_EQ(expected, ids);
+    }
+}
+
+TEST(minijson_parallel, parse_ndjson_unordered)
+{
+    const std::string input = generate_records(10000);
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        std::vector<int> ids;
+        const std::size_t count = minijson::parse_ndjson(
+            pool,
+            input.data(),
+            input.size(),
+            parse_id,
+            [&](const int id) { ids.push_back(id); },
+            minijson::delivery_order::Unordered);
+
+        ASSERT_EQ(10000U, count);
+        std::sort(ids.begin(), ids.end());
+        std::vector<int> expected(10000);
+        std::iota(expected.begin(), expected.end(), 0);
+        ASSERT_EQ(expected, ids);
+    }
+}
+
+TEST(minijson_parallel, parse_ndjson_empty)
+{
+    minijson::thread_pool pool(2);
+    const auto consumer = [](int) { FAIL(); };
+
+    ASSERT_EQ(0U, minijson::parse_ndjson(pool, "", 0, parse_id));
+    ASSERT_EQ(0U, minijson::parse_ndjson(pool, "", 0, parse_id, consumer));
+    ASSERT_EQ(0U, minijson::parse_ndjson(pool, "\n\n", 2, parse_id));
+}
+
+TEST(minijson_parallel, parse_ndjson_errors)
+{
+    // The same error as the sequential parse_ndjson() is reported, and in
+    // ordered mode the consumer receives exactly the preceding records
+    std::string input = generate_records(10000);
+    const std::size_t first_error = input.find("{\"id\":4321,");
+    input[first_error + 1] = '!';
+    const std::size_t second_error = input.find("{\"id\":8765,");
+    input[second_error + 1] = '!';
+
+    std::size_t expected_index = 0;
+    try
+    {
+        minijson::parse_ndjson(input.data(), input.size(), parse_id);
+        FAIL();
+    }
+    catch (const minijson::record_error& e)
+    {
+        ASSERT_EQ(first_error, e.offset());
+        expected_index = e.index();
+    }
+    ASSERT_EQ(4321U, expected_index);
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        for (const auto order :
+            {minijson::delivery_order::Ordered,
+             minijson::delivery_order::Unordered})
+        {
+            std::vector<int> ids;
+            try
+            {
+                minijson::parse_ndjson(
+                    pool,
+                    input.data(),
+                    input.size(),
+                    parse_id,
+                    [&](const int id) { ids.push_back(id); },
+                    order);
+                FAIL();
+            }
+            catch (const minijson::record_error& e)
+            {
+                ASSERT_EQ(expected_index, e.index());
+                ASSERT_EQ(first_error, e.offset());
+                try
+                {
+                    std::rethrow_if_nested(e);
+                    FAIL();
+                }
+                catch (const minijson::parse_error& nested)
+                {
+                    ASSERT_EQ(
+                        minijson::parse_error::EXPECTED_OPENING_QUOTE,
+                        nested.reason());
+                    ASSERT_EQ(1U, nested.offset());
+                }
+            }
+
+            if (order == minijson::delivery_order::Ordered)
+            {
+                std::vector<int> expected(4321);
+                std::iota(expected.begin(), expected.end(), 0);
+                ASSERT_EQ(expected, ids);
+            }
+            else
+            {
+                // All the records preceding the error are delivered, plus
+                // possibly some records following it
+                std::sort(ids.begin(), ids.end());
+                ASSERT_LE(4321U, ids.size());
+                for (int i = 0; i < 4321; ++i)
+                {
+                    ASSERT_EQ(i, ids[i]);
+                }
+            }
+        }
+
+        ASSERT_THROW(
+            minijson::parse_ndjson(
+                pool,
+                input.data(),
+                input.size(),
+                parse_id),
+            minijson::record_error);
+    }
+}
+
+TEST(minijson_parallel, parse_ndjson_consumer_errors)
+{
+    const std::string input = generate_records(10000);
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        for (const auto order :
+            {minijson::delivery_order::Ordered,
+             minijson::delivery_order::Unordered})
+        {
+            std::size_t calls = 0;
+            ASSERT_THROW(
+                minijson::parse_ndjson(
+                    pool,
+                    input.data(),
+                    input.size(),
+                    parse_id,
+                    [&](int)
+                    {
+                        if (++calls == 5000)
+                        {
+                            throw std::logic_error("consumer failed");
+                        }
+                    },
+                    order),
+                std::logic_error);
+
+            // The consumer is not called anymore after it throws
+            ASSERT_EQ(5000U, calls);
+        }
+    }
+}
+
+TEST(minijson_parallel, split_lines)
+{
+    const std::string_view input = "a\nbb\n\nccc\ndddd";
+    const auto test = [&](
+        const std::size_t chunk_size,
+        const std::vector<std::string_view>& expected)
+    {
+        SCOPED_TRACE(chunk_size);
+        std::vector<std::string_view> chunks;
+        for (const auto& [begin, end] :
+            minijson::detail::split_lines(
+                input.data(),
+                input.size(),
+                chunk_size))
+        {
+            chunks.emplace_back(begin, end - begin);
+        }
+        ASSERT_EQ(expected, chunks);
+    };
+
+    test(1, {"a\n", "bb\n", "\n", "ccc\n", "dddd"});
+    test(2, {"a\n", "bb\n", "\nccc\n", "dddd"});
+    test(4, {"a\nbb\n", "\nccc\n", "dddd"});
+    test(6, {"a\nbb\n\n", "ccc\ndddd"});
+    test(100, {"a\nbb\n\nccc\ndddd"});
+}
+
+namespace
+{
+
+// Parses the array sequentially and in parallel with the given chunk size,
+// and checks that the outcome is the same
+void check_parse_array(
+    minijson::thread_pool& pool,
+    const std::string_view input,
+    const std::size_t chunk_size)
+{
+    SCOPED_TRACE(input);
+    SCOPED_TRACE(chunk_size);
+
+    std::vector<std::string> expected;
+    std::vector<std::string> actual;
+    std::mutex mutex;
+
+    const auto handler = [](std::vector<std::string>& elements)
+    {
+        return [&](const minijson::value v, auto& context)
+        {
+            std::string element = std::string(v.raw());
+            if (v.type() == minijson::Object || v.type() == minijson::Array)
+            {
+                element = minijson::capture(context);
+            }
+            elements.push_back(element);
+        };
+    };
+
+    std::size_t expected_result = 0;
+    std::optional<minijson::parse_error> expected_error;
+    try
+    {
+        minijson::const_buffer_context context(input.data(), input.size());
+        expected_result = minijson::parse_array(context, handler(expected));
+    }
+    catch (const minijson::parse_error& e)
+    {
+        expected_error = e;
+    }
+
+    try
+    {
+        const auto actual_handler = handler(actual);
+        const auto locked_handler =
+            [&](const minijson::value v, auto& context)
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                actual_handler(v, context);
+            };
+        const std::size_t actual_result =
+            minijson::detail::parse_array_chunks(
+                pool,
+                input.data(),
+                input.size(),
+                chunk_size,
+                locked_handler);
+        ASSERT_FALSE(expected_error);
+        ASSERT_EQ(expected_result, actual_result);
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_TRUE(expected_error);
+        ASSERT_EQ(expected_error->reason(), e.reason());
+        ASSERT_EQ(expected_error->offset(), e.offset());
+    }
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    if (!expected_error || pool.size() == 1)
+    {
+        ASSERT_EQ(expected, actual);
+    }
+}
+
+} // namespace
+
+TEST(minijson_parallel, parse_array_chunks)
+{
+    const std::string_view inputs[] =
+    {
+        "[]",
+        "  [ ]  ",
+        "[1]",
+        "[1,2,3]",
+        "[1,2]]",
+        "\\t[ 1 ,\\n\"a,]\" , [2, [3, \"]\"]], {\"b\": {\"c,\": [4]}}, null ]",
+        "[\"\\\\\", \"\\\\\\\"]\", \"\\\"\", \"x\"]",
+        "[true,false,null,-1.5e3,\"\\u00e9\",[],{}]",
+        "",
+        "  ",
+        "{}",
+        "x[]",
+        "[",
+        "[ ",
+        "[1",
+        "[1,",
+        "[1 ,",
+        "[1,]",
+        "[,1]",
+        "[1 2]",
+        "[1,2",
+        "[1,2}",
+        "[{]}",
+        "[\"a,b\\\",c\" x]",
+        "[\"abc",
+        "[\"a\",\"b",
+        "[tru]",
+        "[nul,1]",
+        "[1,2,{\"a\":}]",
+        "[[1,2],[3,]]",
+        "[[1,2],{\"x\":1,}]",
+        "[1,\"\\q\",2]",
+    };
+
+    for (const std::size_t pool_size : {1, 3})
+    {
+        minijson::thread_pool pool(pool_size);
+        for (const std::string_view input : inputs)
+        {
+            for (const std::size_t chunk_size : {1, 2, 3, 5, 1000})
+            {
+                check_parse_array(pool, input, chunk_size);
+            }
+        }
+    }
+}
+
+TEST(minijson_parallel, parse_array)
+{
+    std::string input = "[";
+    for (int i = 0; i < 20000; ++i)
+    {
+        input += (i > 0) ? ",\n  " : "";
+        input += "{\"id\":" + std::to_string(i) + ",\"s\":\"],\\\"[{\"";
+        if (i % 5000 == 1)
+        {
+            input += ",\"big\":\"" + std::string(50000, '[') + "\"";
+        }
+        input += ",\"a\":[[],{},[1,2,[3]]]}";
+    }
+    input += "] trailing garbage";
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        std::vector<std::atomic<int>> seen(20000);
+        const std::size_t result = minijson::parse_array(
+            pool,
+            input.data(),
+            input.size(),
+            [&](const minijson::value v, minijson::const_buffer_context& ctx)
+            {
+                ASSERT_EQ(minijson::Object, v.type());
+                ++seen[parse_id(ctx)];
+            });
+
+        ASSERT_EQ(input.find("] trailing") + 1, result);
+        for (const std::atomic<int>& s : seen)
+        {
+            ASSERT_EQ(1, s);
+        }
+
+        // Large inputs are checked against sequential parsing too, with the
+        // default chunk size
+        check_parse_array(
+            pool,
+            input,
+            minijson::detail::chunk_size(pool, input.size()));
+
+        // Errors are the same as with sequential parsing even when other
+        // chunks fail too
+        std::string invalid = input;
+        invalid[invalid.find("{\"id\":7777,") + 1] = '!';
+        invalid[invalid.find("{\"id\":15555,") + 1] = '!';
+        check_parse_array(
+            pool,
+            invalid,
+            minijson::detail::chunk_size(pool, invalid.size()));
+
+        // The same goes for exceptions thrown by the handler
+        try
+        {
+            minijson::parse_array(
+                pool,
+                input.data(),
+                input.size(),
+                [&](minijson::value, minijson::const_buffer_context& ctx)
+                {
+                    const int id = parse_id(ctx);
+                    if (id == 12345 || id == 19999)
+                    {
+                        throw std::runtime_error(std::to_string(id));
+                    }
+                });
+            FAIL();
+        }
+        catch (const std::runtime_error& e)
+        {
+            ASSERT_STREQ("12345", e.what());
+        }
+    }
+}
+
+TEST(minijson_parallel, parse_array_nested_not_parsed)
+{
+    const std::string_view input = "[1,[2],3]";
+    minijson::thread_pool pool(2);
+    const auto handler = [](minijson::value) {};
+
+    minijson::const_buffer_context context(input.data(), input.size());
+    try
+    {
+        minijson::parse_array(context, handler);
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(
+            minijson::parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED,
+            e.reason());
+        ASSERT_EQ(3U, e.offset());
+    }
+
+    for (const std::size_t chunk_size : {1, 1000})
+    {
+        try
+        {
+            minijson::detail::parse_array_chunks(
+                pool,
+                input.data(),
+                input.size(),
+                chunk_size,
+                handler);
+            FAIL();
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(
+                minijson::parse_error::NESTED_OBJECT_OR_ARRAY_NOT_PARSED,
+                e.reason());
+            ASSERT_EQ(3U, e.offset());
+        }
+    }
+}
+
+namespace
+{
+
+// The commas at depth 1 and the closing bracket of the array, found serially
+std::vector<std::size_t> reference_split_points(const std::string_view s)
+{
+    std::vector<std::size_t> result;
+    bool inside = false;
+    bool escaped = false;
+    int depth = 0;
+    for (std::size_t i = 0; i < s.size(); ++i)
+    {
+        const char c = s[i];
+        if (c == '\\')
+        {
+            escaped = !escaped;
+            continue;
+        }
+        if (c == '"' && !escaped)
+        {
+            inside = !inside;
+        }
+        else if (!inside && (c == '[' || c == '{'))
+        {
+            ++depth;
+        }
+        else if (!inside && (c == ']' || c == '}') && --depth == 0)
+        {
+            result.push_back(i);
+            break;
+        }
+        else if (!inside && c == ',' && depth == 1)
+        {
+            result.push_back(i);
+        }
+        escaped = false;
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST(minijson_parallel, split_array)
+{
+    const std::string_view alphabet = "{}[],,,\"\\\\\\ax";
+    std::mt19937 random(42);
+
+    for (const std::size_t pool_size : {1, 3})
+    {
+        minijson::thread_pool pool(pool_size);
+
+        for (int i = 0; i < 500; ++i)
+        {
+            std::string input = " [";
+            const std::size_t length = random() % 64;
+            for (std::size_t j = 0; j < length; ++j)
+            {
+                input += alphabet[random() % alphabet.size()];
+            }
+            SCOPED_TRACE(input);
+
+            const auto split_points = reference_split_points(input);
+            const bool terminated = !split_points.empty()
+                && input[split_points.back()] != ',';
+            for (std::size_t chunk_size = 1; chunk_size <= 10; ++chunk_size)
+            {
+                SCOPED_TRACE(chunk_size);
+
+                // The array is split after the first comma at depth 1 in
+                // each chunk_size bytes of the input
+                std::vector<std::pair<std::size_t, std::size_t>> expected;
+                std::size_t begin = 2;
+                for (std::size_t j = 0; j < split_points.size(); ++j)
+                {
+                    const std::size_t point = split_points[j];
+                    if (input[point] == ','
+                        && (j == 0
+                            || split_points[j - 1] / chunk_size
+                                != point / chunk_size))
+                    {
+                        expected.emplace_back(begin, point + 1);
+                        begin = point + 1;
+                    }
+                }
+                expected.emplace_back(
+                    begin,
+                    terminated ? split_points.back() + 1 : input.size());
+
+                ASSERT_EQ(
+                    expected,
+                    minijson::detail::split_array(
+                        pool,
+                        input.data(),
+                        input.size(),
+                        chunk_size));
+            }
+        }
+    }
+}
+
+TEST(minijson_parallel, parse_batch)
+{
+    std::vector<std::string> messages;
+    for (int i = 0; i < 1000; ++i)
+    {
+        switch (i % 4)
+        {
+        case 0:
+        case 1:
+            messages.push_back("{\"id\":" + std::to_string(i) + "}");
+            break;
+        case 2:
+            messages.push_back("{\"id\":" + std::to_string(i) + ",}");
+            break;
+        case 3:
+            messages.push_back(" {\"id\":\"x\"} ");
+            break;
+        }
+    }
+    messages.push_back("{} {}");
+
+    for (const std::size_t pool_size : pool_sizes)
+    {
+        SCOPED_TRACE(pool_size);
+        minijson::thread_pool pool(pool_size);
+
+        std::vector<int> ids(messages.size(), -1);
+        std::mutex mutex;
+        std::set<const void*> contexts;
+        const std::vector<minijson::batch_result> results =
+            minijson::parse_batch(
+                pool,
+                messages,
+                [&](
+                    const std::size_t index,
+                    minijson::const_buffer_context& context)
+                {
+                    {
+                        const std::lock_guard<std::mutex> lock(mutex);
+                        contexts.insert(&context);
+                    }
+                    ids[index] = parse_id(context);
+                });
+
+        // Each worker reuses the same context
+        ASSERT_LE(contexts.size(), pool_size);
+
+        ASSERT_EQ(messages.size(), results.size());
+        for (int i = 0; i < 1000; ++i)
+        {
+            SCOPED_TRACE(i);
+            const minijson::batch_result& result = results[i];
+            switch (i % 4)
+            {
+            case 0:
+            case 1:
+                ASSERT_TRUE(result.ok());
+                ASSERT_FALSE(result.error());
+                ASSERT_EQ(nullptr, result.parse_failure());
+                ASSERT_EQ(i, ids[i]);
+                break;
+            case 2:
+                ASSERT_FALSE(result.ok());
+                ASSERT_NE(nullptr, result.parse_failure());
+                ASSERT_EQ(
+                    minijson::parse_error::EXPECTED_OPENING_QUOTE,
+                    result.parse_failure()->reason());
+                ASSERT_EQ(
+                    messages[i].size() - 1,
+                    result.parse_failure()->offset());
+                ASSERT_THROW(
+                    std::rethrow_exception(result.error()),
+                    minijson::parse_error);
+                break;
+            case 3:
+                ASSERT_FALSE(result.ok());
+                ASSERT_EQ(nullptr, result.parse_failure());
+                ASSERT_THROW(
+                    std::rethrow_exception(result.error()),
+                    minijson::bad_value_cast);
+                break;
+            }
+        }
+
+        const minijson::batch_result& trailing = results.back();
+        ASSERT_NE(nullptr, trailing.parse_failure());
+        ASSERT_EQ(
+            minijson::parse_error::EXPECTED_END_OF_MESSAGE,
+            trailing.parse_failure()->reason());
+        ASSERT_EQ(3U, trailing.parse_failure()->offset());
+    }
+}
+
+TEST(minijson_parallel, parse_batch_dispatcher)
+{
+    using namespace minijson::handlers;
+
+    struct record
+    {
+        int id = 0;
+        std::optional<bool> flag;
+    };
+
+    const std::string_view messages[] =
+    {
+        R"json({"id":1,"flag":true})json",
+        R"json({"flag":false,"id":2})json",
+        R"json({"flag":false})json",
+        R"json({"id":4,"other":null})json",
+        R"json({"id":5})json",
+    };
+
+    const minijson::dispatcher dispatcher
+    {
+        handler("id", [](record& r, minijson::value v) { v.to(r.id); }),
+        optional_handler(
+            "flag",
+            [](record& r, minijson::value v) { v.to(r.flag); }),
+    };
+
+    minijson::thread_pool pool(2);
+    std::vector<record> records(std::size(messages));
+    const auto results =
+        minijson::parse_batch(pool, messages, dispatcher, records);
+
+    ASSERT_EQ(std::size(messages), results.size());
+    ASSERT_TRUE(results[0].ok());
+    ASSERT_EQ(1, records[0].id);
+    ASSERT_EQ(true, records[0].flag);
+    ASSERT_TRUE(results[1].ok());
+    ASSERT_EQ(2, records[1].id);
+    ASSERT_EQ(false, records[1].flag);
+    ASSERT_THROW(
+        std::rethrow_exception(results[2].error()),
+        minijson::missing_field_error);
+    ASSERT_THROW(
+        std::rethrow_exception(results[3].error()),
+        minijson::unhandled_field_error);
+    ASSERT_TRUE(results[4].ok());
+    ASSERT_EQ(5, records[4].id);
+    ASSERT_FALSE(records[4].flag);
+
+    ASSERT_TRUE(
+        minijson::parse_batch(
+            pool,
+            std::vector<std::string_view>(),
+            dispatcher,
+            records).empty());
+}
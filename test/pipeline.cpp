@@ -0,0 +1,390 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+// Allow std::fopen() and std::tmpfile() with MSVC
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <future>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Blocks the first read until the gate is opened
+class gated_streambuf final : public std::streambuf
+{
+public:
+    gated_streambuf(std::string data, std::shared_future<void> gate)
+    : m_data(std::move(data))
+    , m_gate(std::move(gate))
+    {
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (m_opened)
+        {
+            return traits_type::eof();
+        }
+
+        m_gate.wait();
+        m_opened = true;
+        setg(m_data.data(), m_data.data(), m_data.data() + m_data.size());
+
+        return traits_type::to_int_type(m_data.front());
+    }
+
+private:
+    std::string m_data;
+    std::shared_future<void> m_gate;
+    bool m_opened = false;
+};
+
+// Fails after the first read
+class failing_streambuf final : public std::streambuf
+{
+public:
+    explicit failing_streambuf(std::string data)
+    : m_data(std::move(data))
+    {
+        setg(m_data.data(), m_data.data(), m_data.data() + m_data.size());
+    }
+
+protected:
+    int_type underflow() override
+    {
+        throw std::runtime_error("read failure");
+    }
+
+private:
+    std::string m_data;
+};
+
+template<typename Predicate>
+void wait_until(const Predicate& predicate)
+{
+    while (!predicate())
+    {
+        std::this_thread::yield();
+    }
+}
+
+std::string generate_message(const std::size_t count)
+{
+    std::string message = "{\"items\":[";
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            message += ',';
+        }
+        message += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\\t" +
+            std::to_string(i) + "\"}";
+    }
+    message += "],\"end\":true}";
+
+    return message;
+}
+
+// Returns the names of the items, and checks the ids
+template<typename Context>
+std::vector<std::string> parse_message(Context& context)
+{
+    using minijson::value;
+
+    std::vector<std::string> names;
+    bool end = false;
+    minijson::parse_object(
+        context,
+        [&](std::string_view name, value v)
+        {
+            if (name == "end")
+            {
+                v.to(end);
+                return;
+            }
+            minijson::parse_array(
+                context,
+                [&](value)
+                {
+                    int id = -1;
+                    minijson::parse_object(
+                        context,
+                        [&](std::string_view field, value v)
+                        {
+                            if (field == "id")
+                            {
+                                v.to(id);
+                            }
+                            else
+                            {
+                                names.emplace_back(
+                                    v.as<std::string_view>());
+                            }
+                        });
+                    EXPECT_EQ(names.size() - 1, static_cast<std::size_t>(id));
+                });
+        });
+    EXPECT_TRUE(end);
+
+    return names;
+}
+
+} // namespace
+
+TEST(minijson_pipeline, parse)
+{
+    const std::string message = generate_message(1000);
+    std::istringstream reference_stream(message);
+    minijson::istream_context reference_context(reference_stream);
+    const std::vector<std::string> expected =
+        parse_message(reference_context);
+    ASSERT_EQ(1000U, expected.size());
+
+    for (const std::size_t block_size : {0, 1, 2, 7, 4096, 65536})
+    {
+        for (const std::size_t block_count : {0, 1, 2, 8})
+        {
+            SCOPED_TRACE(block_size);
+            SCOPED_TRACE(block_count);
+
+            std::istringstream stream(message);
+            minijson::pipelined_istream_context context(
+                stream,
+                minijson::pipeline_options{block_size, block_count});
+            ASSERT_EQ(expected, parse_message(context));
+            ASSERT_EQ(message.size(), context.read_offset());
+
+            // The end of the input is sticky
+            ASSERT_EQ(0, context.read());
+            ASSERT_EQ(0, context.read());
+            ASSERT_EQ(message.size(), context.read_offset());
+        }
+    }
+}
+
+TEST(minijson_pipeline, parse_error)
+{
+    std::istringstream stream("{\"a\":[1,2,}");
+    minijson::pipelined_istream_context context(
+        stream,
+        minijson::pipeline_options{3, 2});
+    try
+    {
+        minijson::parse_object(
+            context,
+            [&](std::string_view, minijson::value)
+            {
+                minijson::ignore(context);
+            });
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::EXPECTED_VALUE, e.reason());
+        ASSERT_EQ(10U, e.offset());
+    }
+
+    std::istringstream truncated("{\"a\":");
+    minijson::pipelined_istream_context truncated_context(truncated);
+    try
+    {
+        minijson::parse_object(
+            truncated_context,
+            [&](std::string_view, minijson::value)
+            {
+                minijson::ignore(truncated_context);
+            });
+        FAIL();
+    }
+    catch (const minijson::parse_error& e)
+    {
+        ASSERT_EQ(minijson::parse_error::UNTERMINATED_VALUE, e.reason());
+    }
+}
+
+TEST(minijson_pipeline, consumer_stall)
+{
+    std::promise<void> gate;
+    gated_streambuf buffer("[1,2,3]", gate.get_future().share());
+    std::istream stream(&buffer);
+    minijson::pipelined_istream_context context(stream);
+
+    // The parser has to wait for the producer, which waits for the gate
+    std::thread opener(
+        [&]
+        {
+            wait_until([&] { return context.consumer_stalls() > 0; });
+            gate.set_value();
+        });
+
+    std::vector<int> values;
+    minijson::parse_array(
+        context,
+        [&](minijson::value v) { values.push_back(v.as<int>()); });
+    opener.join();
+
+    ASSERT_EQ((std::vector<int>{1, 2, 3}), values);
+    ASSERT_LE(1U, context.consumer_stalls());
+}
+
+TEST(minijson_pipeline, producer_stall)
+{
+    const std::string message = generate_message(100);
+
+    std::istringstream stream(message);
+    minijson::pipelined_istream_context context(
+        stream,
+        minijson::pipeline_options{16, 2});
+
+    // The producer has to wait for the parser to release a block
+    wait_until([&] { return context.producer_stalls() > 0; });
+    ASSERT_EQ(100U, parse_message(context).size());
+    ASSERT_LE(1U, context.producer_stalls());
+}
+
+TEST(minijson_pipeline, destroy_while_producing)
+{
+    const std::string message = generate_message(100);
+
+    std::istringstream stream(message);
+    std::optional<minijson::pipelined_istream_context> context;
+    context.emplace(stream, minijson::pipeline_options{16, 2});
+    wait_until([&] { return context->producer_stalls() > 0; });
+
+    // The producer must give up
+    context.reset();
+}
+
+TEST(minijson_pipeline, stream_error)
+{
+    failing_streambuf buffer("[1,2");
+    std::istream stream(&buffer);
+    stream.exceptions(std::ios::badbit);
+    minijson::pipelined_istream_context context(
+        stream,
+        minijson::pipeline_options{2, 2});
+
+    std::vector<int> values;
+    try
+    {
+        minijson::parse_array(
+            context,
+            [&](minijson::value v) { values.push_back(v.as<int>()); });
+        FAIL();
+    }
+    catch (const std::runtime_error& e)
+    {
+        ASSERT_STREQ("read failure", e.what());
+    }
+    ASSERT_EQ((std::vector<int>{1}), values);
+}
+
+TEST(minijson_pipeline, move)
+{
+    std::istringstream stream1("[1,2]");
+    std::istringstream stream2("[3,4,5]");
+
+    minijson::pipelined_istream_context context1(
+        stream1,
+        minijson::pipeline_options{1, 1});
+    ASSERT_EQ('[', context1.read());
+
+    minijson::pipelined_istream_context context2(std::move(context1));
+    ASSERT_EQ('1', context2.read());
+    ASSERT_EQ(2U, context2.read_offset());
+
+    context1 = minijson::pipelined_istream_context(stream2);
+    std::vector<int> values;
+    minijson::parse_array(
+        context1,
+        [&](minijson::value v) { values.push_back(v.as<int>()); });
+    ASSERT_EQ((std::vector<int>{3, 4, 5}), values);
+
+    context1 = std::move(context2);
+    ASSERT_EQ(',', context1.read());
+    ASSERT_EQ('2', context1.read());
+    ASSERT_EQ(']', context1.read());
+    ASSERT_EQ(0, context1.read());
+
+    // Self-assignment is harmless
+    minijson::pipelined_istream_context& self = context1;
+    context1 = std::move(self);
+    ASSERT_EQ(0, context1.read());
+}
+
+TEST(minijson_pipeline, file_context)
+{
+    const std::string message = generate_message(1000);
+
+    std::FILE* const file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(
+        message.size(),
+        std::fwrite(message.data(), 1, message.size(), file));
+
+    for (const std::size_t block_size : {1, 100, 4096, 1024 * 1024})
+    {
+        SCOPED_TRACE(block_size);
+
+        std::rewind(file);
+        minijson::file_context context(file, block_size);
+        ASSERT_EQ(1000U, parse_message(context).size());
+        ASSERT_EQ(message.size(), context.read_offset());
+        ASSERT_EQ(0, context.read());
+    }
+
+    std::fclose(file);
+}
+
+TEST(minijson_pipeline, file_context_error)
+{
+    const char* const path = "test_pipeline_file_context_error.tmp";
+
+    // Reading from a file open for writing only fails
+    std::FILE* const file = std::fopen(path, "wb");
+    ASSERT_NE(nullptr, file);
+    {
+        minijson::file_context context(file);
+        ASSERT_THROW(context.read(), std::system_error);
+    }
+    std::fclose(file);
+    std::remove(path);
+}
@@ -0,0 +1,560 @@
+// Copyright (c) Giacomo Drago <giacomo@giacomodrago.com>
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+// 3. Neither the name of Giacomo Drago nor the
+//    names of its contributors may be used to endorse or promote products
+//    derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY GIACOMO DRAGO "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL GIACOMO DRAGO BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "minijson_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+minijson::tape parse(const std::string_view json)
+{
+    minijson::const_buffer_context ctx(json.data(), json.size());
+    return minijson::parse_tape(ctx);
+}
+
+// A serialized tape, stored in memory suitably aligned for tape::view()
+struct serialized_tape
+{
+    std::vector<std::uint64_t> words;
+    std::size_t size = 0;
+
+    explicit serialized_tape(const minijson::tape& tape)
+    {
+        std::ostringstream stream;
+        tape.save(stream);
+        const std::string data = stream.str();
+        size = data.size();
+        words.resize((size + 7) / 8);
+        std::memcpy(words.data(), data.data(), size);
+    }
+
+    std::string str() const
+    {
+        return std::string(reinterpret_cast<const char*>(words.data()), size);
+    }
+
+    // Recomputes the checksum after the tape has been tampered with
+    void reseal()
+    {
+        const std::size_t entries_count = words[3];
+        const std::size_t literals_size = words[4];
+        const char* literals =
+            reinterpret_cast<const char*>(words.data() + 6 + entries_count);
+
+        std::uint64_t checksum = 0xcbf29ce484222325;
+        for (std::size_t i = 0; i < entries_count; ++i)
+        {
+            checksum = (checksum ^ words[6 + i]) * 0x100000001b3;
+        }
+        for (std::size_t i = 0; i < literals_size; i += 8)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(
+                &word,
+                literals + i,
+                std::min<std::size_t>(8, literals_size - i));
+            checksum = (checksum ^ word) * 0x100000001b3;
+        }
+        words[5] = checksum;
+    }
+};
+
+void check_tape_error(const serialized_tape& serialized, const char* what)
+{
+    SCOPED_TRACE(what);
+    try
+    {
+        minijson::tape::view(serialized.words.data(), serialized.size);
+        FAIL();
+    }
+    catch (const minijson::tape_error& e)
+    {
+        ASSERT_STREQ(what, e.what());
+    }
+    try
+    {
+        std::istringstream stream(serialized.str());
+        minijson::tape::load(stream);
+        FAIL();
+    }
+    catch (const minijson::tape_error& e)
+    {
+        ASSERT_STREQ(what, e.what());
+    }
+}
+
+std::uint64_t tape_entry(const std::uint64_t tag, const std::uint64_t payload)
+{
+    return (tag << 56) | payload;
+}
+
+std::uint64_t byte_swap(std::uint64_t word)
+{
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i < sizeof(word); ++i)
+    {
+        result = (result << 8) | (word & 0xff);
+        word >>= 8;
+    }
+    return result;
+}
+
+} // namespace {anonymous}
+
+TEST(minijson_tape, object)
+{
+    const minijson::tape tape = parse(
+        R"json({"a":1,"b":"x","c":true,"d":false,"e":null,)json"
+        R"json("f":{"g":[1,2,3]},"h":[],"i":{}})json");
+    const minijson::tape::element root = tape.root();
+
+    ASSERT_EQ(minijson::Object, root.type());
+    ASSERT_EQ(minijson::Object, root.get_value().type());
+    ASSERT_EQ(8U, root.size());
+
+    ASSERT_EQ(minijson::Number, root.find("a")->type());
+    ASSERT_EQ(1, root.find("a")->as<int>());
+    ASSERT_EQ(minijson::String, root.find("b")->type());
+    ASSERT_EQ("x", root.find("b")->as<std::string_view>());
+    ASSERT_EQ(minijson::Boolean, root.find("c")->type());
+    ASSERT_TRUE(root.find("c")->as<bool>());
+    ASSERT_EQ(minijson::Boolean, root.find("d")->type());
+    ASSERT_FALSE(root.find("d")->as<bool>());
+    ASSERT_EQ(minijson::Null, root.find("e")->type());
+    ASSERT_FALSE(root.find("e")->as<std::optional<int>>().has_value());
+    ASSERT_FALSE(root.find("z").has_value());
+
+    const minijson::tape::element f = *root.find("f");
+    ASSERT_EQ(minijson::Object, f.type());
+    ASSERT_EQ(1U, f.size());
+    const minijson::tape::element g = *f.find("g");
+    ASSERT_EQ(minijson::Array, g.type());
+    ASSERT_EQ(minijson::Array, g.get_value().type());
+    ASSERT_EQ(3U, g.size());
+    ASSERT_EQ(3, g.at(2).as<int>());
+    ASSERT_EQ(1, g.at(0).as<int>());
+
+    ASSERT_EQ(0U, root.find("h")->size());
+    ASSERT_EQ(0U, root.find("i")->size());
+    ASSERT_EQ(0U, root.find("a")->size());
+    ASSERT_FALSE(root.find("i")->find("a").has_value());
+
+    // Lookups can be repeated in any order
+    ASSERT_EQ("x", root.find("b")->as<std::string_view>());
+    ASSERT_EQ(1, root.find("a")->as<int>());
+}
+
+TEST(minijson_tape, duplicate_field)
+{
+    const minijson::tape tape = parse(R"json({"a":1,"a":2})json");
+    ASSERT_EQ(1, tape.root().find("a")->as<int>());
+}
+
+TEST(minijson_tape, array)
+{
+    const minijson::tape tape =
+        parse(R"json([1,"à\n",[true,[null]],{"a":[]},false])json");
+    const minijson::tape::element root = tape.root();
+
+    ASSERT_EQ(minijson::Array, root.type());
+    ASSERT_EQ(5U, root.size());
+    ASSERT_EQ(1, root.at(0).as<int>());
+    ASSERT_EQ("\xc3\xa0\n", root.at(1).as<std::string_view>());
+    ASSERT_EQ(2U, root.at(2).size());
+    ASSERT_EQ(minijson::Null, root.at(2).at(1).at(0).type());
+    ASSERT_EQ(minijson::Array, root.at(3).find("a")->type());
+    ASSERT_FALSE(root.at(4).as<bool>());
+
+    try
+    {
+        root.at(5);
+        FAIL();
+    }
+    catch (const std::out_of_range& e)
+    {
+        ASSERT_STREQ(
+            "tape::element::at(): position out of range", e.what());
+    }
+}
+
+TEST(minijson_tape, for_each)
+{
+    const minijson::tape tape =
+        parse(R"json({"a":[1,[2,3],{"b":4}],"c":{"d":5},"e":6})json");
+
+    std::string names;
+    std::size_t elements = 0;
+    tape.root().for_each_field(
+        [&](const std::string_view name, const minijson::tape::element e)
+        {
+            names += name;
+            if (e.type() == minijson::Array)
+            {
+                e.for_each_element(
+                    [&](const minijson::tape::element)
+                    {
+                        ++elements;
+                    });
+            }
+        });
+    ASSERT_EQ("ace", names);
+    ASSERT_EQ(3U, elements);
+}
+
+TEST(minijson_tape, wrong_element_type)
+{
+    const minijson::tape tape = parse(R"json({"a":[1]})json");
+    const minijson::tape::element root = tape.root();
+    const minijson::tape::element a = *root.find("a");
+
+    const auto check = [](const auto& f, const char* what)
+    {
+        try
+        {
+            f();
+            FAIL();
+        }
+        catch (const minijson::bad_value_cast& e)
+        {
+            ASSERT_EQ(std::string(what) + ": wrong element type", e.what());
+        }
+    };
+
+    check([&] {a.find("x");}, "tape::element::find()");
+    check([&] {root.at(0);}, "tape::element::at()");
+    check([&] {a.at(0).at(0);}, "tape::element::at()");
+    check(
+        [&] {a.for_each_field([](std::string_view, auto) {});},
+        "tape::element::for_each_field()");
+    check(
+        [&] {root.for_each_element([](auto) {});},
+        "tape::element::for_each_element()");
+    ASSERT_THROW(root.as<int>(), minijson::bad_value_cast);
+}
+
+TEST(minijson_tape, outlives_context)
+{
+    std::optional<minijson::tape> tape;
+    {
+        char json[] = R"json({"a":"hello","b":[1,2]})json";
+        minijson::buffer_context ctx(json, sizeof(json) - 1);
+        minijson::tape parsed = minijson::parse_tape(ctx);
+        std::fill(std::begin(json), std::end(json), 'x');
+        tape = std::move(parsed);
+    }
+
+    ASSERT_EQ("hello", tape->root().find("a")->as<std::string_view>());
+    ASSERT_EQ(2, tape->root().find("b")->at(1).as<int>());
+}
+
+TEST(minijson_tape, istream_context)
+{
+    std::istringstream json(R"json([{"a":"hello"},2.5])json");
+    minijson::istream_context ctx(json);
+    const minijson::tape tape = minijson::parse_tape(ctx);
+
+    ASSERT_EQ("hello", tape.root().at(0).find("a")->as<std::string_view>());
+    ASSERT_EQ(2.5, tape.root().at(1).as<double>());
+}
+
+TEST(minijson_tape, concurrent_readers)
+{
+    std::string json = "[";
+    for (int i = 0; i < 1000; ++i)
+    {
+        json += (i ? "," : "") + std::string(R"json({"v":)json") +
+            std::to_string(i) + "}";
+    }
+    json += "]";
+    const minijson::tape tape = parse(json);
+
+    std::vector<long> sums(4);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < sums.size(); ++t)
+    {
+        threads.emplace_back(
+            [&, t]
+            {
+                tape.root().for_each_element(
+                    [&](const minijson::tape::element e)
+                    {
+                        sums[t] += e.find("v")->as<long>();
+                    });
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (const long sum : sums)
+    {
+        ASSERT_EQ(499500, sum);
+    }
+}
+
+TEST(minijson_tape, nested)
+{
+    const char json[] = R"json({"a":{"b":[1,2]},"c":3})json";
+    minijson::const_buffer_context ctx(json, sizeof(json) - 1);
+
+    minijson::parse_object(
+        ctx,
+        [&](const std::string_view name, const minijson::value v)
+        {
+            if (name == "a")
+            {
+                ASSERT_EQ(minijson::Object, v.type());
+                const minijson::tape tape = minijson::parse_tape(ctx);
+                ASSERT_EQ(2, tape.root().find("b")->at(1).as<int>());
+            }
+        });
+}
+
+TEST(minijson_tape, invalid)
+{
+    const auto check = [](const std::string_view json,
+                          const minijson::parse_error::error_reason reason)
+    {
+        minijson::const_buffer_context ctx(json.data(), json.size());
+        try
+        {
+            minijson::parse_tape(ctx);
+            FAIL() << json;
+        }
+        catch (const minijson::parse_error& e)
+        {
+            ASSERT_EQ(reason, e.reason()) << json;
+        }
+    };
+
+    check("", minijson::parse_error::EXPECTED_OPENING_BRACKET);
+    check("1", minijson::parse_error::EXPECTED_OPENING_BRACKET);
+    check("{\"a\":1", minijson::parse_error::UNTERMINATED_VALUE);
+    check("[1,]", minijson::parse_error::EXPECTED_VALUE);
+}
+
+TEST(minijson_tape, save_load_view)
+{
+    const auto check = [](const minijson::tape& tape)
+    {
+        const minijson::tape::element root = tape.root();
+        ASSERT_EQ(3U, root.size());
+        ASSERT_EQ("x\ty", root.find("a")->as<std::string_view>());
+        ASSERT_EQ(-2.5, root.find("b")->at(1).as<double>());
+        ASSERT_EQ(minijson::Null, root.find("b")->at(3).at(0).type());
+        ASSERT_TRUE(root.find("c")->find("d")->as<bool>());
+    };
+
+    std::optional<serialized_tape> serialized;
+    {
+        const minijson::tape tape = parse(
+            R"json({"a":"x\ty","b":[1,-2.5,false,[null]],"c":{"d":true}})json");
+        serialized.emplace(tape);
+    }
+
+    std::istringstream stream(serialized->str());
+    const minijson::tape loaded = minijson::tape::load(stream);
+    check(loaded);
+
+    const minijson::tape viewed =
+        minijson::tape::view(serialized->words.data(), serialized->size);
+    check(viewed);
+
+    // A reloaded tape can be saved again
+    ASSERT_EQ(serialized->str(), serialized_tape(loaded).str());
+    ASSERT_EQ(serialized->str(), serialized_tape(viewed).str());
+}
+
+TEST(minijson_tape, copy)
+{
+    serialized_tape serialized(parse(R"json({"a":"hello"})json"));
+
+    std::optional<minijson::tape> owning(parse(R"json(["world"])json"));
+    const minijson::tape viewed =
+        minijson::tape::view(serialized.words.data(), serialized.size);
+
+    minijson::tape copy(*owning);
+    owning.reset();
+    ASSERT_EQ("world", copy.root().at(0).as<std::string_view>());
+
+    minijson::tape view_copy(viewed);
+    ASSERT_EQ("hello", view_copy.root().find("a")->as<std::string_view>());
+
+    view_copy = copy;
+    copy = viewed;
+    ASSERT_EQ("world", view_copy.root().at(0).as<std::string_view>());
+    ASSERT_EQ("hello", copy.root().find("a")->as<std::string_view>());
+}
+
+TEST(minijson_tape, invalid_header)
+{
+    const serialized_tape valid(parse(R"json({"a":[true]})json"));
+
+    {
+        serialized_tape serialized = valid;
+        serialized.words[0] = 0;
+        check_tape_error(serialized, "Not a tape");
+    }
+    {
+        serialized_tape serialized = valid;
+        serialized.words[0] = byte_swap(serialized.words[0]);
+        check_tape_error(
+            serialized,
+            "Tape was saved with a different byte order");
+    }
+    {
+        serialized_tape serialized = valid;
+        serialized.words[1] = 2;
+        check_tape_error(serialized, "Unsupported tape version");
+    }
+    {
+        serialized_tape serialized = valid;
+        serialized.words[2] = 0x0807060504030201;
+        check_tape_error(serialized, "Unsupported tape version");
+    }
+    {
+        serialized_tape serialized = valid;
+        --serialized.size;
+        check_tape_error(serialized, "Truncated tape");
+    }
+    {
+        serialized_tape serialized = valid;
+        serialized.size = 47;
+        check_tape_error(serialized, "Truncated tape");
+    }
+    {
+        serialized_tape serialized = valid;
+        ++serialized.words[3];
+        check_tape_error(serialized, "Truncated tape");
+    }
+    {
+        // Huge counts must not be trusted before the data is read
+        serialized_tape serialized = valid;
+        serialized.words[3] = std::uint64_t(1) << 60;
+        check_tape_error(serialized, "Truncated tape");
+    }
+    {
+        serialized_tape serialized = valid;
+        serialized.words[4] = std::uint64_t(1) << 62;
+        check_tape_error(serialized, "Truncated tape");
+    }
+    {
+        serialized_tape serialized = valid;
+        serialized.words[6] ^= 1;
+        check_tape_error(serialized, "Tape checksum mismatch");
+    }
+
+    try
+    {
+        const char* const data =
+            reinterpret_cast<const char*>(valid.words.data());
+        minijson::tape::view(data + 1, valid.size - 1);
+        FAIL();
+    }
+    catch (const minijson::tape_error& e)
+    {
+        ASSERT_STREQ("Misaligned tape", e.what());
+    }
+}
+
+TEST(minijson_tape, malformed)
+{
+    // {"a":[true]} is stored as:
+    // 6: begin object, 7-8: field name "a", 9: begin array, 10: true,
+    // 11: end array, 12: end object, followed by the literals
+    const serialized_tape valid(parse(R"json({"a":[true]})json"));
+    ASSERT_EQ(7U, valid.words[3]);
+    ASSERT_EQ(2U, valid.words[4]);
+
+    const auto check =
+        [&](const std::size_t index, const std::uint64_t entry)
+    {
+        serialized_tape serialized = valid;
+        serialized.words[index] = entry;
+        serialized.reseal();
+        check_tape_error(serialized, "Malformed tape");
+    };
+
+    check(6, tape_entry(9, 0)); // root is a scalar
+    check(7, tape_entry(7, 0)); // value where a field name is expected
+    check(10, tape_entry(4, 0)); // field name in an array
+    check(10, tape_entry(1, 0)); // end object in an array
+    check(10, tape_entry(7, 1)); // payload for a boolean
+    check(10, tape_entry(10, 0)); // unknown tag
+    check(11, tape_entry(3, 0)); // end array not matching its begin
+    check(11, tape_entry(1, 9)); // end object closing an array
+    check(9, tape_entry(2, 11)); // begin array not matching its end
+    check(8, 2); // literal out of bounds
+    check(7, tape_entry(4, 2)); // literal out of bounds
+    check(13, 0x7878); // literal not null-terminated
+
+    {
+        // Object not closed
+        serialized_tape serialized = valid;
+        serialized.words[3] = 6;
+        serialized.words[4] = 0;
+        serialized.reseal();
+        check_tape_error(serialized, "Malformed tape");
+    }
+    {
+        // Literal length missing
+        serialized_tape serialized = valid;
+        serialized.words[3] = 2;
+        serialized.words[4] = 0;
+        serialized.reseal();
+        check_tape_error(serialized, "Malformed tape");
+    }
+    {
+        // Empty tape
+        serialized_tape serialized = valid;
+        serialized.words[3] = 0;
+        serialized.words[4] = 0;
+        serialized.reseal();
+        check_tape_error(serialized, "Malformed tape");
+    }
+    {
+        // Entries following the root
+        serialized_tape serialized = valid;
+        serialized.words.insert(
+            serialized.words.begin() + 13,
+            tape_entry(9, 0));
+        serialized.words[3] = 8;
+        serialized.size += 8;
+        serialized.reseal();
+        check_tape_error(serialized, "Malformed tape");
+    }
+}